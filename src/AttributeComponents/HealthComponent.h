@@ -4,6 +4,8 @@
 // health component to track and modify health value
 class HealthComponent : public Component {
 public:
+    static constexpr ComponentType type = ComponentType::Health;
+
     HealthComponent(int initialHealth) : health(initialHealth) {} // initialize health with given value
 
     int getHealth() const { return health; } // get current health
@@ -6,6 +6,8 @@
 class LockableComponent : public Component
 {
 public:
+    static constexpr ComponentType type = ComponentType::Lockable;
+
     LockableComponent(const std::string &requiredKey) : key(requiredKey), locked(true) {} // init with key and locked state
 
     bool isLocked() const { return locked; } // check if locked
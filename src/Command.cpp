@@ -1,382 +1,341 @@
 #include "Command.h"
 #include "Game.h"
-#include <sstream>
-#include <algorithm>
-#include <cctype>
 #include "MessageDispatcher.h"
-
-// trims whitespace from both ends of a string
-static std::string trim(const std::string &str)
-{
-    auto start = str.find_first_not_of(" \t\n\r");
-    auto end = str.find_last_not_of(" \t\n\r");
-    return (start == std::string::npos) ? "" : str.substr(start, end - start + 1);
-}
+#include "DispatchStats.h"
+#include "MessageTable.h"
 
 // look in command - display contents of a container
-void LookInCommand::execute(Game &game, const std::string &args)
+bool LookInCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::string entityName = toLowerCase(trim(args));
-
-    // std::cout << "Executing LookInCommand with argument: " << args << "\n";
-
-    // get current location from the player
-    int locationID = game.player.getCurrentLocation();
-    const auto &location = game.graph.locations[locationID];
-
-    // search for the entity by name
-    auto entity = location->findEntityByName(entityName);
-    if (!entity)
+    if (command.object.empty())
     {
-        // std::cout << "Container not in location, checking inventory...\n";
-        entity = game.player.findEntityInInventory(entityName);
+        out << "Invalid look command. Use 'look' for the location, 'look at [entity]', or 'look in [container]'.\n";
+        return false;
     }
 
+    // the parser already looked in the location, then the inventory
+    Entity *entity = command.object.entity;
     if (!entity)
     {
-        std::cout << "You don't see a " << entityName << " here.\n";
-        return;
+        out << "You don't see a " << command.object.text << " here.\n";
+        return false;
     }
 
     // send a "look_in" message to the entity
-    game.dispatcher.sendMessage({"player", entity->getName(), "look_in"});
+    game.dispatcher.sendMessage({game.player.getId(), entity->getId(), Opcode::LookIn});
+    return true;
 }
 
 // go command - change player location
-void GoCommand::execute(Game &game, const std::string &args)
+bool GoCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    if (!args.empty())
+    std::string_view way = direction.empty() ? command.rest : std::string_view(direction);
+    bool moved = false;
+    if (!way.empty())
     {
-        std::string direction = toLowerCase(trim(args));
-        game.player.go(direction);
+        moved = game.player.go(way);
     }
     else
     {
-        std::cout << "Specify a direction to move.\n";
+        out << "Specify a direction to move.\n";
     }
+
+    // shows where the player ended up, even if they didn't move
+    game.player.displayCurrentLocation();
+    return moved;
 }
 
 // help command - display available commands
-void HelpCommand::execute(Game &game, const std::string &args)
+bool HelpCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::cout << "\nAvailable commands:\n";
-    std::cout << "\nDisclaimer: A 'container' is an item that can have other items inside!:\n";
+    out << "\nAvailable commands:\n";
+    out << "\nDisclaimer: A 'container' is an item that can have other items inside!:\n";
 
     // navigation
-    std::cout << "\n--- Navigation Commands ---\n";
-    std::cout << "GO [Compass direction]\n";
+    out << "\n--- Navigation Commands ---\n";
+    out << "GO [Compass direction]\n";
+    out << "NORTH, SOUTH, EAST, WEST (or N, S, E, W)\n";
 
     // inspection
-    std::cout << "\n--- Inspection Commands ---\n";
-    std::cout << "LOOK\n";
-    std::cout << "LOOK AT [entity]\n";
-    std::cout << "LOOK IN [container]\n";
+    out << "\n--- Inspection Commands ---\n";
+    out << "LOOK\n";
+    out << "LOOK AT [entity]\n";
+    out << "LOOK IN [container]\n";
 
     // inventory
-    std::cout << "\n--- Inventory Commands ---\n";
-    std::cout << "INVENTORY\n";
-    std::cout << "TAKE [item] FROM [container]\n";
-    std::cout << "PUT [item] IN [container]\n";
-    std::cout << "OPEN [locked container] WITH [item]\n";
-    std::cout << "USE [item] \n";
+    out << "\n--- Inventory Commands ---\n";
+    out << "INVENTORY\n";
+    out << "TAKE [item] FROM [container]\n";
+    out << "PUT [item] IN [container]\n";
+    out << "OPEN [locked container] WITH [item]\n";
+    out << "USE [item] \n";
     // system
-    std::cout << "\n--- System Commands ---\n";
-    std::cout << "HELP\n";
-    std::cout << "ALIAS [new command] [existing command]\n";
-    std::cout << "DEBUG\n";
-    std::cout << "QUIT\n";
+    out << "\n--- System Commands ---\n";
+    out << "HELP\n";
+    out << "ALIAS [new command] [existing command]\n";
+    out << "DEBUG\n";
+    out << "STATS\n";
+    out << "QUIT\n";
+    out << "\nAny command can be shortened to its first few letters, e.g. INV\n";
+    out << "Several commands can go on one line separated by ';', e.g. TAKE BAG; LOOK IN BAG\n";
+    return true;
 }
 
 // inventory command - display player's inventory
-void InventoryCommand::execute(Game &game, const std::string &args)
+bool InventoryCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
     game.player.viewInventory();
+    return true;
 }
 
 // look command - inspect entities or surroundings
-void LookCommand::execute(Game &game, const std::string &args)
+bool LookCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::string cleanArgs = trim(args);
-
-    if (cleanArgs.empty())
+    if (command.rest.empty())
     {
         game.player.displayCurrentLocation();
-        return;
+        return true;
     }
 
-    if (cleanArgs.rfind("at ", 0) == 0)
+    if (command.preposition == "at" && !command.object.empty())
     {
-        std::string entityName = trim(cleanArgs.substr(3));
-
-        std::shared_ptr<Entity> entity = game.graph.locations[game.player.getCurrentLocation()]->findEntityByName(entityName);
-        if (!entity)
-        {
-            entity = game.player.findEntityInInventory(entityName);
-        }
-
-        if (entity)
+        if (Entity *entity = command.object.entity)
         {
             // send an "inspect" message to the entity
-            game.dispatcher.sendMessage({"player", entity->getName(), "inspect"});
-        }
-        else
-        {
-            std::cout << "You don't see a " << entityName << " here.\n";
+            game.dispatcher.sendMessage({game.player.getId(), entity->getId(), Opcode::Inspect});
+            return true;
         }
+        out << "You don't see a " << command.object.text << " here.\n";
     }
     else
     {
-        std::cout << "Invalid look command. Use 'look' for the location, 'look at [entity]', or 'look in [container]'.\n";
+        out << "Invalid look command. Use 'look' for the location, 'look at [entity]', or 'look in [container]'.\n";
     }
+    return false;
 }
 
 // alias command - creates new command keywords
-void AliasCommand::execute(Game &game, const std::string &args)
+bool AliasCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::istringstream iss(args);
-    std::string newCommand, existingCommand;
-    iss >> newCommand >> existingCommand;
+    std::string_view newCommand = command.object.text, existingCommand = command.target.text;
 
     if (!newCommand.empty() && !existingCommand.empty())
     {
-        game.commandManager.addAlias(newCommand, existingCommand);
-        std::cout << "Alias created: '" << newCommand << "' for '" << existingCommand << "'.\n";
+        if (game.commandManager.addAlias(newCommand, existingCommand))
+        {
+            out << "Alias created: '" << newCommand << "' for '" << existingCommand << "'.\n";
+            return true;
+        }
+        out << "Error: cannot alias nonexistent command '" << existingCommand << "'.\n";
     }
     else
     {
-        std::cout << "Usage: ALIAS [new command] [existing command]\n";
+        out << "Usage: ALIAS [new command] [existing command]\n";
     }
+    return false;
 }
 
 // debug tree command - displays game graph
-void DebugTreeCommand::execute(Game &game, const std::string &args)
+bool DebugTreeCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::cout << "\n--- Game World Debug Tree ---\n";
+    out << "\n--- Game World Debug Tree ---\n";
 
     for (const auto &[locationID, loc] : game.graph.locations)
     {
-        std::cout << "\nLocation ID: " << locationID << "\n";
-        std::cout << "Name: " << loc->name << "\n";
-        std::cout << "Description: " << loc->description << "\n";
+        out << "\nLocation ID: " << locationID << "\n";
+        out << "Name: " << loc->name.str() << "\n";
+        out << "Description: " << loc->description.str() << "\n";
 
         if (game.player.getCurrentLocation() == locationID)
         {
-            std::cout << " -----------------\n | You are here | \n ----------------- \n";
+            out << " -----------------\n | You are here | \n ----------------- \n";
         }
 
-        std::cout << "Connections:\n";
+        out << "Connections:\n";
         for (const auto &[direction, connectedLoc] : loc->connections)
         {
             if (connectedLoc)
             {
-                std::cout << " - " << direction << " (to location " << connectedLoc->number << " - " << connectedLoc->name << ")\n";
+                out << " - " << direction.str() << " (to location " << connectedLoc->number << " - " << connectedLoc->name.str() << ")\n";
             }
             else
             {
-                std::cout << " - " << direction << " (to an Unknown Location)\n";
+                out << " - " << direction.str() << " (to an Unknown Location)\n";
             }
         }
 
-        std::cout << "Entities:\n";
-        for (const auto &entity : loc->getEntities())
+        out << "Entities:\n";
+        for (EntityHandle handle : loc->getEntities())
         {
-            std::cout << " - " << entity->getName() << ": " << entity->getDescription() << "\n";
+            const Entity *entity = game.graph.entities.get(handle);
+            if (!entity)
+                continue;
+            out << " - " << entity->getName() << ": " << entity->getDescription() << "\n";
             if (auto container = entity->getComponent<ContainerComponent>())
             {
                 const auto &contents = container->getContents();
                 if (!contents.empty())
                 {
-                    std::cout << "   Contains:\n";
-                    for (const auto &item : contents)
+                    out << "   Contains:\n";
+                    for (EntityHandle itemHandle : contents)
                     {
-                        std::cout << "   - " << item->getName() << ": " << item->getDescription() << "\n";
+                        const Entity *item = game.graph.entities.get(itemHandle);
+                        if (item)
+                            out << "   - " << item->getName() << ": " << item->getDescription() << "\n";
                     }
                 }
             }
         }
 
-        std::cout << "--------------------------\n";
+        out << "--------------------------\n";
     }
 
-    std::cout << "\n--- End of Debug Tree ---\n";
+    out << "\n--- End of Debug Tree ---\n";
+    return true;
 }
 
 // quit command - exits the game
-void QuitCommand::execute(Game &game, const std::string &args)
+bool QuitCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::cout << "Quitting the game...\n";
-    exit(0);
+    out << "Quitting the game...\n";
+    game.quit();
+    return true;
 }
 
-// take command - picks up an item from location or container
-void TakeCommand::execute(Game &game, const std::string &args)
+// stats command - message counts and handler latencies so far
+bool StatsCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::istringstream iss(args);
-    std::string itemName, containerName;
-    iss >> itemName;
-    itemName = toLowerCase(trim(itemName));
-
-    std::string keyword;
-    if (iss >> keyword && keyword == "from")
-    {
-        iss >> containerName;
-        containerName = toLowerCase(trim(containerName));
-    }
+    game.dispatcher.flushStats();
+    out << "\n" << DispatchStats::snapshot().report();
+    return true;
+}
 
-    if (!itemName.empty())
+// take command - picks up an item from location or container
+bool TakeCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
+{
+    if (!command.object.empty())
     {
-        if (!containerName.empty())
+        // looked up, never interned: typed names must not grow the symbol table.
+        // a name nothing in the world has can't be taken, so that answer is given
+        // here, echoing what was typed, instead of sending a name no handler could find
+        Symbol item = command.object.folded;
+        if (command.preposition == "from" && !command.target.empty())
         {
             // Find container and send take_from message
-            auto container = game.graph.locations[game.player.getCurrentLocation()]->findEntityByName(containerName);
-            if (!container)
-            {
-                container = game.player.findEntityInInventory(containerName);
-            }
-            if (container)
-            {
-                game.dispatcher.sendMessage({"player", container->getId(), "take_from", itemName});
-            }
-            else
+            if (Entity *container = command.target.entity)
             {
-                std::cout << "You don't see " << containerName << " here.\n";
+                if (!item.empty())
+                {
+                    game.dispatcher.sendMessage({game.player.getId(), container->getId(), Opcode::TakeFrom, item});
+                    return true;
+                }
+                // the same answers the container's take_from handler would give
+                if (!container->hasComponent<ContainerComponent>())
+                    out << container->getName() << " is not a container.\n";
+                else if (!isSealed(*container))
+                    out << "You don't see a " << command.object.text << " in there.\n";
+                return false;
             }
+            out << "You don't see " << command.target.text << " here.\n";
+            return false;
         }
-        else
+        if (item.empty())
         {
-            std::string locId = "location_" + std::to_string(game.player.getCurrentLocation());
-            game.dispatcher.sendMessage({"player", locId, "removeItem", itemName});
+            out << "You can't take the " << command.object.text << ".\n";
+            return false;
         }
+        EntityId locId = game.graph.locations.at(game.player.getCurrentLocation())->id;
+        game.dispatcher.sendMessage({game.player.getId(), locId, Opcode::RemoveItem, item});
+        return true;
     }
-    else
-    {
-        std::cout << "What do you want to take?\n";
-    }
+    out << "What do you want to take?\n";
+    return false;
 }
 
 // put command - places an item into a container
-void PutCommand::execute(Game &game, const std::string &args)
+bool PutCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::istringstream iss(args);
-    std::string itemName, containerName;
-    iss >> itemName;
-    itemName = toLowerCase(trim(itemName));
-
-    std::string keyword;
-    if (iss >> keyword && keyword == "in")
+    if (command.preposition != "in")
     {
-        iss >> containerName;
-        containerName = toLowerCase(trim(containerName));
-    }
-    else
-    {
-        std::cout << "Usage: PUT [item] IN [container]\n";
-        return;
+        out << "Usage: PUT [item] IN [container]\n";
+        return false;
     }
 
-    auto item = game.player.findEntityInInventory(itemName);
+    auto item = game.player.findEntityInInventory(command.object.folded);
     if (!item)
     {
-        std::cout << "You don't have a " << itemName << " to put anywhere.\n";
-        return;
-    }
-
-    auto container = game.graph.locations[game.player.getCurrentLocation()]->findEntityByName(containerName);
-    if (!container)
-    {
-        container = game.player.findEntityInInventory(containerName);
+        out << "You don't have a " << command.object.text << " to put anywhere.\n";
+        return false;
     }
 
+    Entity *container = command.target.entity;
     if (!container)
     {
-        std::cout << "You don't see a " << containerName << " here.\n";
-        return;
+        out << "You don't see a " << command.target.text << " here.\n";
+        return false;
     }
 
     // let the container handle all checks and actions via message
-    game.dispatcher.sendMessage({"player", container->getId(), "put_item", item});
+    game.dispatcher.sendMessage({game.player.getId(), container->getId(), Opcode::PutItem, item->getHandle()});
+    return true;
 }
 
-void OpenCommand::execute(Game &game, const std::string &args)
+bool OpenCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::istringstream iss(args);
-    std::string containerName, withKeyword, keyName;
-    iss >> containerName >> withKeyword >> keyName;
-
-    containerName = toLowerCase(trim(containerName));
-    keyName = toLowerCase(trim(keyName));
-
-    if (withKeyword != "with")
+    if (command.preposition != "with")
     {
-        std::cout << "Usage: OPEN [container] WITH [item]\n";
-        return;
+        out << "Usage: OPEN [container] WITH [item]\n";
+        return false;
     }
 
     // check if container exists in loc or inv
-    auto container = game.graph.locations[game.player.getCurrentLocation()]->findEntityByName(containerName);
+    Entity *container = command.object.entity;
     if (!container)
     {
-        container = game.player.findEntityInInventory(containerName);
-    }
-
-    if (!container)
-    {
-        std::cout << "You don't see a " << containerName << " here.\n";
-        return;
+        out << "You don't see a " << command.object.text << " here.\n";
+        return false;
     }
 
     // find the key in player's inventory
-    auto key = game.player.findEntityInInventory(keyName);
+    auto key = game.player.findEntityInInventory(command.target.folded);
     if (!key)
     {
         // else err
-        std::cout << "You don't have a " << keyName << ".\n";
-        return;
+        out << "You don't have a " << command.target.text << ".\n";
+        return false;
     }
 
     // send messages using the entity id's  
-    game.dispatcher.sendMessage({"player", container->getId(), "unlock", key->getName()});
-    game.dispatcher.sendMessage({"player", container->getId(), "open"});
+    game.dispatcher.sendMessage({game.player.getId(), container->getId(), Opcode::Unlock, key->getNameSymbol()});
+    game.dispatcher.sendMessage({game.player.getId(), container->getId(), Opcode::Open});
+    return true;
 }
 
 // applies the effects of an item
-void UseCommand::execute(Game &game, const std::string &args)
+bool UseCommand::execute(Game &game, const ParsedCommand &command, OutputBuffer &out)
 {
-    std::istringstream iss(args);
-    std::string itemName, onKeyword, targetName;
-
-    iss >> itemName;
-    itemName = toLowerCase(trim(itemName));
-
-    if (iss >> onKeyword)
-    {
-        onKeyword = toLowerCase(trim(onKeyword));
-        iss >> targetName;
-        targetName = toLowerCase(trim(targetName));
-    }
-
     // if there is no keyword or target, use the item on the player
     // by sending a "use" message to the item entity
     // defunct: previouus idea had the ability to use on other entities (ignite)
-    if (onKeyword.empty())
+    if (command.preposition.empty() && command.extra.empty())
     {
         // find the entity in the player's inventory
-        auto item = game.player.findEntityInInventory(itemName);
+        auto item = game.player.findEntityInInventory(command.object.folded);
         if (!item)
         {
-            std::cout << "You don't have a " << itemName << " to use.\n";
-            return;
+            out << "You don't have a " << command.object.text << " to use.\n";
+            return false;
         }
         // use the item on the player using the actual entity name
-        game.dispatcher.sendMessage({"player", item->getId(), "use"});
+        game.dispatcher.sendMessage({game.player.getId(), item->getId(), Opcode::Use});
+        return true;
     }
-    else if (onKeyword == "on" && !targetName.empty())
+    else if (command.preposition == "on" && !command.target.empty())
     {
         // use the item on a specific target
-        game.dispatcher.sendMessage({"player", itemName, "use", targetName});
-    }
-    else
-    {
-        std::cout << "Usage: USE [item] ON [target]\n";
+        game.dispatcher.sendMessage({game.player.getId(), game.dispatcher.lookup(command.object.text), Opcode::Use, command.target.folded});
+        return true;
     }
+    out << "Usage: USE [item] ON [target]\n";
+    return false;
 }
\ No newline at end of file
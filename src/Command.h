@@ -3,6 +3,8 @@
 
 #include <string>
 #include <iostream>
+#include "OutputSink.h"
+#include "Parser.h"
 
 class Game; // Forward declaration to avoid circular dependencies
 
@@ -13,78 +15,92 @@ public:
     // https://www.quantstart.com/articles/C-Virtual-Destructors-How-to-Avoid-Memory-Leaks/#:~:text=In%20simple%20terms%2C%20a%20virtual,known%20as%20a%20memory%20leak.
     // the command destructor is virtual to allow derived classes to be destroyed correctly
     virtual ~Command() = default;
-    virtual void execute(Game &game, const std::string &args) = 0;
+    // false if it couldn't do what was asked, e.g. the item isn't there
+    // (the game also counts a handler refusing one of its messages as a failure)
+    virtual bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) = 0;
 };
 
 class GoCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    GoCommand() = default;
+    // always goes this way, for NORTH and friends
+    explicit GoCommand(std::string direction) : direction(std::move(direction)) {}
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
+
+private:
+    std::string direction;
 };
 
 class HelpCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class InventoryCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class LookCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class AliasCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class DebugTreeCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
+};
+
+class StatsCommand : public Command
+{
+public:
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class QuitCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class LookInCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class TakeCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class PutCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 class OpenCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 class UseCommand : public Command
 {
 public:
-    void execute(Game &game, const std::string &args) override;
+    bool execute(Game &game, const ParsedCommand &command, OutputBuffer &out) override;
 };
 
 #endif
\ No newline at end of file
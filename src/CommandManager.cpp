@@ -1,47 +1,168 @@
 #include "CommandManager.h"
 #include "Game.h"
+#include "Log.h"
 
-// registers a command with the manager
-void CommandManager::registerCommand(const std::string &name, std::unique_ptr<Command> command)
+CommandManager::CommandManager()
 {
-    commands[name] = std::move(command);
+    nodes.emplace_back(); // root
+}
+
+// registers a command with the manager, replacing any command or alias of the same name
+void CommandManager::registerCommand(const std::string &name, std::unique_ptr<Command> command, Grammar grammar)
+{
+    entries.push_back(Entry{std::move(command), grammar});
+    bind(name, static_cast<int32_t>(entries.size() - 1));
 }
 
 // maps an alias to an existing command
-void CommandManager::addAlias(const std::string &alias, const std::string &originalCommand)
+bool CommandManager::addAlias(std::string_view alias, std::string_view originalCommand)
 {
-    // check if the original command exists in the command list
-    if (commandExists(originalCommand))
+    // the command the original runs, following any chain of aliases now rather than on every lookup
+    int32_t entry = exact(originalCommand);
+    if (entry != kNone)
     {
-        // if the original command exists, add alias to aliases map
-        aliases[alias] = originalCommand;
-        std::cout << "Alias created: " << alias << " -> " << originalCommand << "\n";
+        bind(alias, entry);
+        ZLOG(Debug, Command, "alias created: " << alias << " -> " << originalCommand);
+        return true;
     }
     else
     {
-        // if the original command does not exist, print an error message
-        std::cerr << "Error: cannot alias nonexistent command '" << originalCommand << "'.\n";
+        // if the original command does not exist, let the caller report it
+        ZLOG(Debug, Command, "cannot alias nonexistent command '" << originalCommand << "'");
+        return false;
     }
 }
 
-// executes a command
-void CommandManager::executeCommand(const std::string &name, Game &game, const std::string &args)
+CommandManager::Match CommandManager::find(std::string_view line) const
 {
-    std::string commandName = name;
+    if (stale)
+        compile();
 
-    // resolves alias if it exists
-    if (aliases.find(commandName) != aliases.end())
+    Match match;
+    int32_t node = 0;
+    size_t words = 0;
+    for (size_t at = 0; at <= line.size(); ++at)
     {
-        commandName = aliases[commandName];
+        // a name can only end where a word does
+        if (at == line.size() || line[at] == ' ')
+        {
+            ++words;
+            int32_t entry = table[node].entry;
+            if (words == 1 && entry == kNone && table[node].only >= 0)
+            {
+                // an abbreviation, carry on from the end of the full word so "l in" still finds LOOK IN
+                node = table[node].only;
+                entry = table[node].entry;
+            }
+            if (entry != kNone)
+                match = Match{&entries[entry], words};
+            if (at == line.size())
+                break;
+        }
+
+        // the children's labels are adjacent, a short scan finds the next one
+        const Compiled &current = table[node];
+        int32_t child = current.first, end = current.first + current.count;
+        while (child != end && labels[child] != line[at])
+            ++child;
+        if (child == end)
+            break;
+        node = child;
     }
+    return match;
+}
+
+void CommandManager::compile() const
+{
+    table.assign(nodes.size(), Compiled{});
+    labels.assign(nodes.size(), 0);
 
-    // executes the resolved command if it exists
-    if (commands.find(commandName) != commands.end())
+    // number the nodes breadth first; order[i] is the node that becomes table[i]
+    std::vector<int32_t> order{0}, index(nodes.size(), kNone);
+    index[0] = 0;
+    for (size_t at = 0; at < order.size(); ++at)
     {
-        commands[commandName]->execute(game, args);
+        Compiled &compiled = table[at];
+        compiled.first = static_cast<int32_t>(order.size());
+        for (int32_t child = nodes[order[at]].child; child != kNone; child = nodes[child].sibling)
+        {
+            index[child] = static_cast<int32_t>(order.size());
+            labels[order.size()] = nodes[child].label;
+            order.push_back(child);
+            ++compiled.count;
+        }
     }
-    else
+    for (size_t at = 0; at < order.size(); ++at)
+    {
+        const Node &node = nodes[order[at]];
+        table[at].entry = node.entry;
+        table[at].only = node.only >= 0 ? index[node.only] : node.only;
+    }
+    stale = false;
+}
+
+int32_t CommandManager::childOf(int32_t node, char label) const
+{
+    for (int32_t child = nodes[node].child; child != kNone; child = nodes[child].sibling)
+    {
+        if (nodes[child].label == label)
+            return child;
+        if (nodes[child].label > label)
+            break;
+    }
+    return kNone;
+}
+
+int32_t CommandManager::insert(std::string_view name)
+{
+    int32_t node = 0;
+    for (char label : name)
+    {
+        int32_t child = childOf(node, label);
+        if (child == kNone)
+        {
+            // keep the children sorted, so a miss stops early
+            child = static_cast<int32_t>(nodes.size());
+            nodes.emplace_back();
+            nodes[child].label = label;
+            int32_t *link = &nodes[node].child;
+            while (*link != kNone && nodes[*link].label < label)
+                link = &nodes[*link].sibling;
+            nodes[child].sibling = *link;
+            *link = child;
+        }
+        node = child;
+    }
+    return node;
+}
+
+int32_t CommandManager::exact(std::string_view name) const
+{
+    int32_t node = 0;
+    for (char label : name)
+    {
+        node = childOf(node, label);
+        if (node == kNone)
+            return kNone;
+    }
+    return nodes[node].entry;
+}
+
+void CommandManager::bind(std::string_view name, int32_t entry)
+{
+    stale = true;
+    int32_t terminal = insert(name);
+    bool added = nodes[terminal].entry == kNone;
+    nodes[terminal].entry = entry;
+    if (!added || name.find(' ') != std::string_view::npos)
+        return; // a name that was already there, or one that's more than a word and never abbreviated
+
+    // tell every node on the way down that this name starts with it
+    int32_t node = 0;
+    for (char label : name)
     {
-        std::cout << "Invalid command.\n";
+        node = childOf(node, label);
+        int32_t &only = nodes[node].only;
+        only = only == kNone ? terminal : kAmbiguous;
     }
 }
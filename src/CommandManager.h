@@ -2,26 +2,89 @@
 #define COMMAND_MANAGER_H
 
 #include "Command.h"
-#include <unordered_map>
+#include "Parser.h"
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class Game;
 
+// the command table, a character trie over every command and alias name
+// a name can be several words ("look in"); the longest one that matches the
+// start of a line wins, so LOOK IN and LOOK are separate entries.
+// the first word can be abbreviated to any prefix that only one command or alias
+// name starts with ("inv" for inventory). an exact name always beats an abbreviation.
+// aliases are resolved when they're added, so an alias of an alias costs the
+// same as the command itself.
 class CommandManager
 {
 public:
-    void registerCommand(const std::string &name, std::unique_ptr<Command> command);
-    void addAlias(const std::string &alias, const std::string &originalCommand);
-    void executeCommand(const std::string &name, Game &game, const std::string &args);
-    bool CommandManager::commandExists(const std::string &name) const
+    // a command and the grammar its arguments are parsed with
+    struct Entry
     {
-        return commands.find(name) != commands.end();
-    }
+        std::unique_ptr<Command> command;
+        Grammar grammar;
+    };
+
+    // what a line starts with: the command and how many words named it
+    struct Match
+    {
+        const Entry *entry = nullptr;
+        size_t words = 0;
+    };
+
+    CommandManager();
+
+    void registerCommand(const std::string &name, std::unique_ptr<Command> command, Grammar grammar = {});
+    // returns false if the original command doesn't exist; original can itself be an alias
+    bool addAlias(std::string_view alias, std::string_view originalCommand);
+    // the command a lowercase, single spaced line starts with; entry is nullptr if none
+    // one walk down the trie, nothing is allocated
+    Match find(std::string_view line) const;
+    bool commandExists(std::string_view name) const { return exact(name) >= 0; }
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<Command>> commands;
-    std::unordered_map<std::string, std::string> aliases;
+    static constexpr int32_t kNone = -1;
+    static constexpr int32_t kAmbiguous = -2;
+
+    // the trie as names are added
+    struct Node
+    {
+        int32_t child = kNone;   // first child, children are kept sorted by label
+        int32_t sibling = kNone; // next child of the same parent
+        int32_t entry = kNone;   // the command a name ending here runs
+        int32_t only = kNone;    // where the one single word name below here ends, or kAmbiguous
+        char label = 0;
+    };
+
+    // the trie as it's searched, laid out breadth first so every node's children
+    // sit next to each other and their labels are one short run of bytes
+    struct Compiled
+    {
+        int32_t first = 0; // first child
+        int32_t count = 0; // children
+        int32_t entry = kNone;
+        int32_t only = kNone;
+    };
+
+    // the node a name ends at, created if missing
+    int32_t insert(std::string_view name);
+    int32_t childOf(int32_t node, char label) const;
+    // the entry an exact name runs, kNone if none
+    int32_t exact(std::string_view name) const;
+    // points name at an entry, and notes it for abbreviations if it's new
+    void bind(std::string_view name, int32_t entry);
+    // lays the trie out for searching, on the first lookup after a change
+    void compile() const;
+
+    std::vector<Node> nodes; // nodes[0] is the root
+    std::vector<Entry> entries;
+
+    mutable std::vector<Compiled> table;
+    mutable std::vector<char> labels; // labels[i] is what leads to table[i]
+    mutable bool stale = true;
 };
 
 #endif
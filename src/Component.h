@@ -1,4 +1,29 @@
 #pragma once
+#include <cstdint>
+
+// compile time ids for every component type
+// each component class exposes its id as `static constexpr ComponentType type`
+// new component types add an entry here (and register a property in ComponentRegistry)
+enum class ComponentType : uint8_t
+{
+    Takeable,
+    Container,
+    Openable,
+    Usable,
+    Lockable,
+    Health,
+    Count
+};
+
+// set of component types an entity has, one bit per ComponentType
+using ComponentSignature = uint32_t;
+
+static_assert(static_cast<unsigned>(ComponentType::Count) <= 32, "ComponentSignature has one bit per component type");
+
+constexpr ComponentSignature componentBit(ComponentType type)
+{
+    return ComponentSignature(1) << static_cast<unsigned>(type);
+}
 
 class Component {
 public:
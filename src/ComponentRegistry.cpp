@@ -0,0 +1,225 @@
+#include "ComponentRegistry.h"
+#include "Entity.h"
+#include "Log.h"
+
+#include <charconv>
+
+// trims spaces and tabs from both ends of a view
+static std::string_view trimView(std::string_view str)
+{
+    size_t start = str.find_first_not_of(" \t\r\n");
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return (start == std::string_view::npos) ? std::string_view() : str.substr(start, end - start + 1);
+}
+
+// parses a signed integer that may carry an explicit '+'
+static bool parseSignedInt(std::string_view str, int &value)
+{
+    if (!str.empty() && str[0] == '+')
+        str.remove_prefix(1);
+    auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+    return result.ec == std::errc();
+}
+
+bool PropertyList::parse(std::string_view text)
+{
+    count = 0;
+    text = trimView(text);
+    if (!text.empty() && text.front() == '[')
+        text.remove_prefix(1);
+    if (!text.empty() && text.back() == ']')
+        text.remove_suffix(1);
+
+    while (!text.empty())
+    {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text = (comma == std::string_view::npos) ? std::string_view() : text.substr(comma + 1);
+
+        item = trimView(item);
+        if (item.empty())
+            continue;
+        if (count == kCapacity)
+            return false;
+
+        size_t equals = item.find('=');
+        Property &property = entries[count++];
+        property.key = trimView(item.substr(0, equals));
+        property.value = (equals == std::string_view::npos) ? std::string_view() : trimView(item.substr(equals + 1));
+    }
+    return true;
+}
+
+const Property *PropertyList::find(std::string_view key) const
+{
+    for (const Property &property : *this)
+    {
+        if (property.key == key)
+            return &property;
+    }
+    return nullptr;
+}
+
+ComponentRegistry &ComponentRegistry::instance()
+{
+    static ComponentRegistry registry;
+    return registry;
+}
+
+// the built-in components of the world format
+ComponentRegistry::ComponentRegistry()
+{
+    registerProperty(
+        "Takeable", [](Entity &entity, const Property &, const PropertyList &)
+        { entity.addComponent<TakeableComponent>(); },
+        [](const Entity &entity, std::string &)
+        { return entity.hasComponent<TakeableComponent>(); });
+
+    registerProperty(
+        "Container", [](Entity &entity, const Property &, const PropertyList &)
+        { entity.addComponent<ContainerComponent>(); },
+        [](const Entity &entity, std::string &)
+        { return entity.hasComponent<ContainerComponent>(); });
+
+    // Openable, or Openable=open for one that starts open
+    registerProperty(
+        "Openable", [](Entity &entity, const Property &property, const PropertyList &)
+        { entity.addComponent<OpenableComponent>(property.value == "open"); },
+        [](const Entity &entity, std::string &value)
+        {
+            auto openable = entity.getComponent<OpenableComponent>();
+            if (openable && openable->isOpen())
+                value = "open";
+            return openable != nullptr;
+        });
+
+    // Lockable=<key name>
+    registerProperty(
+        "Lockable", [](Entity &entity, const Property &property, const PropertyList &)
+        {
+            if (!property.value.empty())
+                entity.addComponent<LockableComponent>(std::string(property.value));
+        },
+        [](const Entity &entity, std::string &value)
+        {
+            auto lockable = entity.getComponent<LockableComponent>();
+            if (lockable)
+                value = lockable->getKey();
+            return lockable != nullptr;
+        });
+
+    // a Lockable that starts unlocked; written after Lockable so it always follows it
+    registerProperty(
+        "Unlocked", [](Entity &entity, const Property &, const PropertyList &)
+        {
+            if (auto lockable = entity.getComponent<LockableComponent>())
+                lockable->unlock(lockable->getKey());
+        },
+        [](const Entity &entity, std::string &)
+        {
+            auto lockable = entity.getComponent<LockableComponent>();
+            return lockable && !lockable->isLocked();
+        });
+
+    // Health=<n>, only positive values describe an entity's own health
+    registerProperty(
+        "Health", [](Entity &entity, const Property &property, const PropertyList &)
+        {
+            int health = 0;
+            if (!property.value.empty() && property.value[0] != '-' && parseSignedInt(property.value, health))
+                entity.addComponent<HealthComponent>(health);
+        },
+        [](const Entity &entity, std::string &value)
+        {
+            auto health = entity.getComponent<HealthComponent>();
+            if (health)
+                value = std::to_string(health->getHealth());
+            return health != nullptr;
+        });
+
+    // Usable takes its effect from its own value, Usable=<+/-n>, or else from a
+    // Health=<+/-n> entry on the same entity
+    registerProperty(
+        "Usable", [](Entity &entity, const Property &property, const PropertyList &all)
+        {
+            int healthEffect = 0;
+            const Property *health = property.value.empty() ? all.find("Health") : &property;
+            if (health && parseSignedInt(health->value, healthEffect))
+            {
+                entity.addComponent<UsableComponent>(
+                    healthEffect > 0 ? UseEffectType::HEAL : UseEffectType::DAMAGE, healthEffect);
+            }
+            else
+            {
+                entity.addComponent<UsableComponent>();
+            }
+        },
+        [](const Entity &entity, std::string &value)
+        {
+            auto usable = entity.getComponent<UsableComponent>();
+            if (usable && usable->getEffectType() != UseEffectType::NONE)
+                value = (usable->getEffectValue() > 0 ? "+" : "") + std::to_string(usable->getEffectValue());
+            return usable != nullptr;
+        });
+}
+
+void ComponentRegistry::registerProperty(const std::string &name, Factory factory, Writer writer)
+{
+    for (auto &entry : entries)
+    {
+        if (entry.name == name)
+        {
+            entry.factory = std::move(factory);
+            entry.writer = std::move(writer);
+            return;
+        }
+    }
+    entries.push_back({name, std::move(factory), std::move(writer)});
+}
+
+const ComponentRegistry::Factory *ComponentRegistry::findFactory(std::string_view name) const
+{
+    for (const auto &entry : entries)
+    {
+        if (entry.name == name)
+            return &entry.factory;
+    }
+    return nullptr;
+}
+
+std::size_t ComponentRegistry::apply(Entity &entity, const PropertyList &properties) const
+{
+    std::size_t applied = 0;
+    for (const Property &property : properties)
+    {
+        if (const Factory *factory = findFactory(property.key))
+        {
+            (*factory)(entity, property, properties);
+            ZLOG(Debug, Loader, "added component for property: " << property.key);
+            ++applied;
+        }
+        else
+        {
+            ZLOG(Warn, Loader, "unknown property '" << property.key << "' on entity " << entity.getName());
+        }
+    }
+    return applied;
+}
+
+std::string ComponentRegistry::describe(const Entity &entity) const
+{
+    std::string text;
+    std::string value;
+    for (const auto &entry : entries)
+    {
+        value.clear();
+        if (!entry.writer || !entry.writer(entity, value))
+            continue;
+        if (!text.empty())
+            text += ", ";
+        text += entry.name;
+        if (!value.empty())
+            text += "=" + value;
+    }
+    return text;
+}
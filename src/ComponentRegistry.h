@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Entity;
+
+// a single "Key" or "Key=Value" entry from an entity's property list
+struct Property
+{
+    std::string_view key;
+    std::string_view value; // empty for flags like Takeable
+};
+
+// the tokenized form of "[A, B=v, ...]"
+// fixed capacity so parsing a line never allocates, views point into the source text
+class PropertyList
+{
+public:
+    static constexpr std::size_t kCapacity = 16;
+
+    // single pass tokenizer, returns false if the list had more than kCapacity entries
+    bool parse(std::string_view text);
+
+    // returns the entry with the given key, or nullptr
+    const Property *find(std::string_view key) const;
+
+    const Property *begin() const { return entries.data(); }
+    const Property *end() const { return entries.data() + count; }
+    std::size_t size() const { return count; }
+
+private:
+    std::array<Property, kCapacity> entries{};
+    std::size_t count = 0;
+};
+
+// maps property names from the world format to the components they create
+// component types register a factory here instead of being added to the loader,
+// and a writer that turns the component back into its property, which is how
+// world images store them
+class ComponentRegistry
+{
+public:
+    // builds the component for one property; the full list is passed so a
+    // factory can read related properties (Usable reads Health)
+    using Factory = std::function<void(Entity &entity, const Property &property, const PropertyList &all)>;
+
+    // false if the entity doesn't have the property, otherwise sets its value
+    // (left empty for flags like Takeable)
+    using Writer = std::function<bool(const Entity &entity, std::string &value)>;
+
+    // the process wide registry, the built-in components are registered on first use
+    static ComponentRegistry &instance();
+
+    // adds or replaces the factory and writer for a property name
+    void registerProperty(const std::string &name, Factory factory, Writer writer);
+
+    // runs the factory for every property in the list, returns how many were recognised
+    std::size_t apply(Entity &entity, const PropertyList &properties) const;
+
+    // the property list that apply turns back into entity's components,
+    // e.g. "Takeable, Lockable=key", in registration order
+    std::string describe(const Entity &entity) const;
+
+    // registers a property during static initialisation, for components defined in their own files
+    struct Registrar
+    {
+        Registrar(const std::string &name, Factory factory, Writer writer)
+        {
+            ComponentRegistry::instance().registerProperty(name, std::move(factory), std::move(writer));
+        }
+    };
+
+private:
+    ComponentRegistry();
+
+    struct Entry
+    {
+        std::string name;
+        Factory factory;
+        Writer writer;
+    };
+
+    const Factory *findFactory(std::string_view name) const;
+
+    // only a handful of component types exist, a flat scan beats hashing here
+    std::vector<Entry> entries;
+};
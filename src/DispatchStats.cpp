@@ -0,0 +1,215 @@
+#include "DispatchStats.h"
+#include "Log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+// every thread's counters; a block is never freed, so totals survive its thread
+struct DispatchStats::CounterList
+{
+    std::mutex lock; // taken once per thread, and by readers
+    std::vector<const Counters *> blocks;
+};
+
+DispatchStats::CounterList &DispatchStats::counterList()
+{
+    static CounterList *list = new CounterList; // never destroyed, the exit dump may run late
+    return *list;
+}
+
+std::atomic<unsigned> DispatchStats::sampleInterval{kDefaultSampleInterval};
+
+void DispatchStats::setSampleInterval(unsigned interval)
+{
+    sampleInterval.store(interval == 0 ? 1 : interval, std::memory_order_relaxed);
+}
+
+namespace
+{
+    std::string exitPath;
+
+    void writeExitReport()
+    {
+        std::ofstream file(exitPath);
+        if (file)
+            file << DispatchStats::snapshot().report();
+    }
+}
+
+DispatchStats::Counters &DispatchStats::create()
+{
+    current = new Counters();
+    CounterList &list = counterList();
+    std::lock_guard<std::mutex> guard(list.lock);
+    list.blocks.push_back(current);
+    return *current;
+}
+
+void DispatchStats::Batch::timed(Opcode opcode, EntityId recipient, Symbol name, uint64_t started)
+{
+#if ZORK_DISPATCH_STATS
+    if (static_cast<size_t>(opcode) < kOpcodeCount)
+        local().recordLatency(opcode, recipient, name, clock() - started);
+#endif
+}
+
+// the only place a batch touches its thread's counters
+void DispatchStats::Batch::flush()
+{
+#if ZORK_DISPATCH_STATS
+    if (pending == 0)
+        return;
+    Counters &counters = local();
+    for (size_t verb = 0; verb < kOpcodeCount; ++verb)
+    {
+        if (counts[verb] != 0)
+            bump(counters.delivered[verb], uint64_t(counts[verb]));
+    }
+    if (maxDepth > counters.maxDepth.load(std::memory_order_relaxed))
+        counters.maxDepth.store(maxDepth, std::memory_order_relaxed);
+    counts.fill(0);
+    maxDepth = 0;
+    pending = 0;
+#endif
+}
+
+// a sampled delivery
+void DispatchStats::Counters::recordLatency(Opcode opcode, EntityId recipient, Symbol name, uint64_t nanos)
+{
+    size_t verb = static_cast<size_t>(opcode);
+    bump(latency[verb][LatencyHistogram::bucketOf(nanos)]);
+    if (nanos > maxNanos[verb].load(std::memory_order_relaxed))
+        maxNanos[verb].store(nanos, std::memory_order_relaxed);
+    if (nanos > slowNanos[kSlowest - 1].load(std::memory_order_relaxed))
+        recordSlow(opcode, recipient, name, nanos);
+}
+
+// insertion into the short sorted list; rare once the list has filled with slow ones
+void DispatchStats::Counters::recordSlow(Opcode opcode, EntityId recipient, Symbol name, uint64_t nanos)
+{
+    size_t at = kSlowest - 1;
+    while (at > 0 && slowNanos[at - 1].load(std::memory_order_relaxed) < nanos)
+    {
+        slowNanos[at].store(slowNanos[at - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slowRecipient[at].store(slowRecipient[at - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slowName[at].store(slowName[at - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slowOpcode[at].store(slowOpcode[at - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        --at;
+    }
+    slowNanos[at].store(nanos, std::memory_order_relaxed);
+    slowRecipient[at].store(recipient, std::memory_order_relaxed);
+    slowName[at].store(name.empty() ? nullptr : &name.str(), std::memory_order_relaxed);
+    slowOpcode[at].store(opcode, std::memory_order_relaxed);
+}
+
+DispatchStats::Snapshot DispatchStats::snapshot()
+{
+    Snapshot result;
+    std::vector<SlowDelivery> slow;
+    CounterList &list = counterList();
+    std::lock_guard<std::mutex> guard(list.lock);
+    for (const Counters *block : list.blocks)
+    {
+        const Counters &counters = *block;
+        for (size_t verb = 0; verb < kOpcodeCount; ++verb)
+        {
+            result.delivered[verb] += counters.delivered[verb].load(std::memory_order_relaxed);
+            result.maxNanos[verb] = std::max(result.maxNanos[verb], counters.maxNanos[verb].load(std::memory_order_relaxed));
+            for (size_t bucket = 0; bucket < LatencyHistogram::kBuckets; ++bucket)
+            {
+                if (uint64_t count = counters.latency[verb][bucket].load(std::memory_order_relaxed))
+                    result.latency[verb].add(bucket, count);
+            }
+        }
+        result.undeliverable += counters.undeliverable.load(std::memory_order_relaxed);
+        result.dropped += counters.dropped.load(std::memory_order_relaxed);
+        result.maxDepth = std::max(result.maxDepth, counters.maxDepth.load(std::memory_order_relaxed));
+        for (size_t i = 0; i < kSlowest; ++i)
+        {
+            SlowDelivery entry;
+            entry.nanos = counters.slowNanos[i].load(std::memory_order_relaxed);
+            entry.recipient = counters.slowRecipient[i].load(std::memory_order_relaxed);
+            entry.name = counters.slowName[i].load(std::memory_order_relaxed);
+            entry.opcode = counters.slowOpcode[i].load(std::memory_order_relaxed);
+            if (entry.nanos != 0)
+                slow.push_back(entry);
+        }
+    }
+
+    std::sort(slow.begin(), slow.end(), [](const SlowDelivery &a, const SlowDelivery &b)
+              { return a.nanos > b.nanos; });
+    for (size_t i = 0; i < slow.size() && i < kSlowest; ++i)
+        result.slowest[i] = slow[i];
+    return result;
+}
+
+uint64_t DispatchStats::Snapshot::totalDelivered() const
+{
+    uint64_t total = 0;
+    for (uint64_t count : delivered)
+        total += count;
+    return total;
+}
+
+// latencies in microseconds with one decimal, wide enough to line up
+static std::string micros(uint64_t nanos)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%9.1f", static_cast<double>(nanos) / 1000.0);
+    return text;
+}
+
+std::string DispatchStats::Snapshot::report() const
+{
+    std::ostringstream out;
+    out << "--- Dispatch Stats ---\n";
+    out << "delivered " << totalDelivered() << ", undeliverable " << undeliverable << ", dropped too deep " << dropped
+        << ", deepest dispatch " << maxDepth << "\n";
+    out << "\nhandler latency by verb (us, sampled)\n";
+    out << "verb           count  sampled      p50      p90      p99      max\n";
+    for (size_t verb = 0; verb < kOpcodeCount; ++verb)
+    {
+        if (delivered[verb] == 0)
+            continue;
+        std::string name(opcodeName(static_cast<Opcode>(verb)));
+        name.resize(10, ' ');
+        char count[16];
+        std::snprintf(count, sizeof(count), "%10llu", static_cast<unsigned long long>(delivered[verb]));
+        char sampled[16];
+        std::snprintf(sampled, sizeof(sampled), "%9llu", static_cast<unsigned long long>(latency[verb].count()));
+        // a percentile is its bucket's upper bound, never report it above the real maximum
+        auto at = [&](double fraction)
+        { return micros(std::min(latency[verb].percentile(fraction), maxNanos[verb])); };
+        out << name << count << sampled << at(0.50) << at(0.90) << at(0.99) << micros(maxNanos[verb]) << "\n";
+    }
+    if (slowest[0].nanos != 0)
+    {
+        out << "\nslowest deliveries (us)\n";
+        for (const SlowDelivery &entry : slowest)
+        {
+            if (entry.nanos == 0)
+                break;
+            out << micros(entry.nanos) << "  " << opcodeName(entry.opcode) << " to ";
+            if (entry.name)
+                out << "'" << *entry.name << "' ";
+            out << "#" << entry.recipient << "\n";
+        }
+    }
+    return out.str();
+}
+
+void DispatchStats::writeOnExit(const std::string &path)
+{
+    if (path.empty())
+        return;
+    bool first = exitPath.empty();
+    exitPath = path;
+    counterList(); // built before the handler is registered
+    if (first)
+        std::atexit(writeExitReport);
+    ZLOG(Debug, Dispatch, "dispatch stats will be written to " << path << " on exit");
+}
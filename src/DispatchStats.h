@@ -0,0 +1,269 @@
+#pragma once
+#include "Message.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// message layer metrics: per verb counts and handler latency, the deepest nested
+// dispatch, and messages that were dropped or had nowhere to go
+//
+// every thread records into its own block of counters, found through a
+// thread_local pointer, so recording is a few relaxed stores with no locks and
+// no shared cache lines. only the owning thread writes a block; readers
+// (snapshot) sum all of them, which is safe at any time but may be mid-update.
+//
+// deliveries don't go to the block one at a time: whatever delivers keeps a
+// Batch of plain counters and adds it to its thread's block every
+// Batch::kFlushEvery deliveries and at the end of each drain, so a snapshot can
+// be that many deliveries behind until the next flush.
+//
+// counts are exact once flushed. reading the clock costs more than a delivery,
+// so latency is sampled: each batch times one delivery in every sampleInterval
+// (see setSampleInterval), and the histograms, maxima and slowest list cover those.
+//
+// build with -DZORK_DISPATCH_STATS=0 to compile recording out entirely
+#ifndef ZORK_DISPATCH_STATS
+#define ZORK_DISPATCH_STATS 1
+#endif
+
+// a log-linear latency histogram in the style of HdrHistogram
+// values below 16 get a bucket each, above that every power of two is split into
+// 16 buckets, so any value is reported to within 1/16 (about 6%) of itself
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr unsigned kSubBuckets = 1u << kSubBits;
+    static constexpr unsigned kMaxMagnitude = 47; // ~39 hours in ns, larger values share the top bucket
+    static constexpr size_t kBuckets = (kMaxMagnitude - kSubBits + 2) * kSubBuckets;
+
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < kSubBuckets)
+            return static_cast<size_t>(value);
+        unsigned magnitude = log2Floor(value);
+        if (magnitude > kMaxMagnitude)
+            return kBuckets - 1;
+        unsigned shift = magnitude - kSubBits;
+        return (magnitude - kSubBits + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+    }
+
+    // the largest value that lands in a bucket
+    static uint64_t highestIn(size_t bucket)
+    {
+        if (bucket < kSubBuckets)
+            return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / kSubBuckets) - 1;
+        uint64_t sub = kSubBuckets + bucket % kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void add(size_t bucket, uint64_t count)
+    {
+        counts[bucket] += count;
+        total += count;
+    }
+
+    uint64_t count() const { return total; }
+
+    // the value below which the given fraction (0..1) of the samples fall
+    uint64_t percentile(double fraction) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(total) + 0.5);
+        if (rank == 0)
+            rank = 1;
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen >= rank)
+                return highestIn(bucket);
+        }
+        return highestIn(kBuckets - 1);
+    }
+
+private:
+    static unsigned log2Floor(uint64_t value)
+    {
+        unsigned bits = 0;
+        for (unsigned step = 32; step != 0; step >>= 1)
+        {
+            if (value >> step)
+            {
+                value >>= step;
+                bits += step;
+            }
+        }
+        return bits;
+    }
+
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t total = 0;
+};
+
+class DispatchStats
+{
+public:
+    // how many of the slowest single deliveries are kept, with their recipient
+    static constexpr size_t kSlowest = 8;
+
+    struct SlowDelivery
+    {
+        EntityId recipient = kNoEntity;
+        const std::string *name = nullptr; // interned, so it outlives the recipient
+        Opcode opcode = Opcode::Count;
+        uint64_t nanos = 0;
+    };
+
+    // the sum of every thread's counters at one point in time
+    struct Snapshot
+    {
+        std::array<uint64_t, kOpcodeCount> delivered{};
+        std::array<uint64_t, kOpcodeCount> maxNanos{};
+        std::array<LatencyHistogram, kOpcodeCount> latency;
+        uint64_t undeliverable = 0;
+        uint64_t dropped = 0;
+        unsigned maxDepth = 0;
+        std::array<SlowDelivery, kSlowest> slowest{}; // slowest first
+
+        uint64_t totalDelivered() const;
+
+        // a human readable table, the same text STATS shows and the exit dump holds
+        std::string report() const;
+    };
+
+    // latency is timed for one delivery in this many per batch, 1 times all of them
+    static constexpr unsigned kDefaultSampleInterval = 256;
+    static void setSampleInterval(unsigned interval);
+
+    // one deliverer's counts since its last flush, in plain fields so a delivery
+    // touches no thread_local and no atomics. only one thread may use a batch at
+    // a time; flush adds it to that thread's counters
+    class Batch
+    {
+    public:
+        static constexpr unsigned kFlushEvery = 256;
+
+        Batch() = default;
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+        ~Batch() { flush(); }
+
+        // call before running a handler, pass the result to delivered()
+        // the clock reading if this delivery is sampled, 0 if it isn't
+        uint64_t startTimer()
+        {
+#if ZORK_DISPATCH_STATS
+            if (--untilSample != 0)
+                return 0;
+            untilSample = sampleInterval.load(std::memory_order_relaxed);
+            return clock();
+#else
+            return 0;
+#endif
+        }
+
+        // a handler returned; depth is how deeply nested the delivery was
+        void delivered(Opcode opcode, unsigned depth)
+        {
+#if ZORK_DISPATCH_STATS
+            size_t verb = static_cast<size_t>(opcode);
+            if (verb >= kOpcodeCount)
+                return;
+            ++counts[verb];
+            if (depth > maxDepth)
+                maxDepth = depth;
+            if (++pending == kFlushEvery)
+                flush();
+#endif
+        }
+
+        // a sampled delivery returned, started is what startTimer gave it
+        // handler time includes anything a Direct mode handler delivered inside itself
+        void timed(Opcode opcode, EntityId recipient, Symbol name, uint64_t started);
+
+        void flush();
+
+    private:
+        std::array<uint32_t, kOpcodeCount> counts{};
+        unsigned maxDepth = 0;
+        unsigned pending = 0;     // deliveries since the last flush
+        unsigned untilSample = 1; // deliveries left until the next timed one
+    };
+
+    // a message for an id nobody has registered
+    static void undeliverable()
+    {
+#if ZORK_DISPATCH_STATS
+        bump(local().undeliverable);
+#endif
+    }
+
+    // a message dropped for being sent too many handlers deep
+    static void dropped(uint64_t count = 1)
+    {
+#if ZORK_DISPATCH_STATS
+        bump(local().dropped, count);
+#endif
+    }
+
+    static Snapshot snapshot();
+
+    // writes snapshot().report() to a file when the process exits, however it exits
+    // call after the world is loaded, the report reads interned recipient names
+    static void writeOnExit(const std::string &path);
+
+private:
+    // nanoseconds on a monotonic clock, never 0
+    static uint64_t clock()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count()) | 1;
+    }
+
+    static std::atomic<unsigned> sampleInterval;
+
+    // one thread's counters, only ever written by that thread
+    struct Counters
+    {
+        std::array<std::atomic<uint64_t>, kOpcodeCount> delivered{};
+        std::array<std::atomic<uint64_t>, kOpcodeCount> maxNanos{};
+        std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets>, kOpcodeCount> latency{};
+        std::atomic<uint64_t> undeliverable{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<unsigned> maxDepth{0};
+
+        // the slowest deliveries, kept sorted slowest first; the fastest of them is
+        // the bar a delivery has to clear, so the common case is one compare
+        std::array<std::atomic<uint64_t>, kSlowest> slowNanos{};
+        std::array<std::atomic<EntityId>, kSlowest> slowRecipient{};
+        std::array<std::atomic<const std::string *>, kSlowest> slowName{};
+        std::array<std::atomic<Opcode>, kSlowest> slowOpcode{};
+
+        void recordLatency(Opcode opcode, EntityId recipient, Symbol name, uint64_t nanos);
+        void recordSlow(Opcode opcode, EntityId recipient, Symbol name, uint64_t nanos);
+    };
+
+    // the owner is the only writer, so a load and a store is enough; no locked add
+    template <typename T>
+    static void bump(std::atomic<T> &counter, T by = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    // this thread's counters, created and listed on first use
+    static Counters &local()
+    {
+        return current ? *current : create();
+    }
+    static Counters &create();
+    inline static thread_local Counters *current = nullptr;
+
+    struct CounterList;
+    static CounterList &counterList();
+};
@@ -6,306 +6,124 @@
 #include "./FunctionalComponents/UseableComponent.h"
 #include "./AttributeComponents/LockableComponent.h"
 #include "./AttributeComponents/HealthComponent.h"
-#include "ComponentManager.h"
+#include "Registry.h"
 #include "MessageDispatcher.h"
+#include "Symbol.h"
+#include "MessageTable.h"
+#include "Log.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <iostream>
 
-class Entity : public std::enable_shared_from_this<Entity>
+class Entity
 {
 public:
     // constructor with basic properties
-    Entity(const std::string &name, const std::string &description, MessageDispatcher &dispatcher)
-        : name(name), description(description), dispatcher(dispatcher), id(name) 
+    // entities are built by an EntityPool, which passes in the slot it reserved;
+    // components are stored in the world's registry rather than on the entity
+    // name and description are interned, so duplicates across the world share one string
+    Entity(Symbol name, Symbol description, MessageDispatcher &dispatcher, Registry &registry, EntityHandle handle)
+        : name(name), description(description), dispatcher(dispatcher), registry(registry), handle(handle)
     {
-        // create a unique ID via timestamp and random number
-        // using the 'time'  and 'rand' function from Standard C++ Library 
-        std::string uniqueId = name + "_" + std::to_string(std::time(nullptr));
-        while (!dispatcher.registerRecipient(uniqueId, [this](const Message &msg)
-                                             { handleMessage(msg); }))
-        {
-            uniqueId = name + "_" + std::to_string(std::time(nullptr)) + "_" + std::to_string(rand());
-        }
-        id = uniqueId; // on success store id as the uniqueID
+        // the dispatcher hands out the next id, so there's no collision to retry on
+        // the registration is ours, so the handler goes away with the entity
+        registration = MessageDispatcher::Registration(dispatcher, dispatcher.registerRecipient([this](const Message &msg)
+                                                                                                { handleMessage(msg); }));
     }
 
-    static std::string toLowerCase(const std::string &str)
+    // getters
+    const std::string &getName() const { return name.str(); }
+    const std::string &getDescription() const { return description.str(); }
+    Symbol getNameSymbol() const { return name; }
+    EntityId getId() const { return registration.id(); }
+    EntityHandle getHandle() const { return handle; }
+    MessageDispatcher &getDispatcher() const { return dispatcher; }
+    ComponentSignature getSignature() const { return registry.signature(handle.index()); }
+
+    // looks up another entity of the same world, nullptr if the handle is stale
+    Entity *resolve(EntityHandle other) const { return registry.resolve(other); }
+
+    // display name of another entity, the empty symbol if the handle is stale
+    Symbol nameOf(EntityHandle other) const
     {
-        std::string result = str;
-        std::transform(result.begin(), result.end(), result.begin(),
-                       [](unsigned char c)
-                       { return std::tolower(c); });
-        return result;
+        const Entity *entity = resolve(other);
+        return entity ? entity->name : Symbol();
     }
 
-    // getters
-    std::string getName() const { return name; }
-    std::string getDescription() const { return description; }
-    std::string getId() const { return id; } 
-
     // template method to retrieve a component
+    // returns a non-owning pointer, or nullptr if the entity lacks the component
     template <typename T>
-    std::shared_ptr<T> getComponent() const
+    T *getComponent() const
     {
-        return componentManager.getComponent<T>();
+        return registry.get<T>(handle.index());
     }
 
-    // template method to add a component to the entity
+    // template method to add a component to the entity, constructed in place
+    template <typename T, typename... Args>
+    T &addComponent(Args &&...args)
+    {
+        return registry.emplace<T>(handle.index(), std::forward<Args>(args)...);
+    }
+
+    // O(1) signature check
     template <typename T>
-    void addComponent(std::shared_ptr<T> component)
+    bool hasComponent() const
     {
-        componentManager.addComponent(component);
+        return registry.has<T>(handle.index());
     }
 
     // adds an entity to another entity if it's a container
-    void addContainedEntity(std::shared_ptr<Entity> entity)
+    void addContainedEntity(EntityHandle entity)
     {
         if (auto container = getComponent<ContainerComponent>())
         {
-            container->addItem(entity);
+            container->addItem(entity, nameOf(entity));
         }
     }
 
     // retrieves entities within this container, if any
-    const std::vector<std::shared_ptr<Entity>> &getContainedEntities() const
+    const std::vector<EntityHandle> &getContainedEntities() const
     {
         if (auto container = getComponent<ContainerComponent>())
         {
             return container->getContents();
         }
-        static const std::vector<std::shared_ptr<Entity>> empty; // return empty if not a container
+        static const std::vector<EntityHandle> empty; // return empty if not a container
         return empty;
     }
 
     // removes a contained entity from this container
-    void removeContainedEntity(std::shared_ptr<Entity> entity)
+    void removeContainedEntity(EntityHandle entity)
     {
         if (auto container = getComponent<ContainerComponent>())
         {
-            container->removeItem(entity);
+            container->removeItem(entity, nameOf(entity));
         }
     }
 
     // sends a message via the dispatcher
-    void sendMessage(const std::string &to, const std::string &message, std::any data = {})
+    void sendMessage(EntityId to, Opcode opcode, Payload data = {})
     {
-        std::cout << "Entity '" << name << "' sending message to '" << to << "' with message: '" << message << "'\n";
-        dispatcher.sendMessage({id, to, message, data});
+        ZLOG(Trace, Entity, "entity '" << name.str() << "' sending message to " << to << " with message: '" << opcodeName(opcode) << "'");
+        dispatcher.sendMessage({getId(), to, opcode, data});
     }
 
     // handles incoming messages
-    // adaptation of existing methods 
+    // the behaviour for each opcode lives in the MessageTable, keyed by component
     void handleMessage(const Message &msg)
     {
-        std::cout << "Entity '" << name << "' received message from '" << msg.from << "' with message: '" << msg.message << "'\n";
-        if (msg.message == "inspect")
-        {
-            std::cout << "The " << name << " is inspected: " << description << "\n";
-        }
-        else if (msg.message == "use")
-        {
-            if (auto usable = getComponent<UsableComponent>())
-            {
-                if (usable->getEffectType() == UseEffectType::HEAL)
-                {
-                    std::cout << "You feel rejuvenated after using the " << name << ".\n";
-                    dispatcher.sendMessage({id, "player", "heal", usable->getEffectValue()});
-                }
-                else if (usable->getEffectType() == UseEffectType::DAMAGE)
-                {
-                    std::cout << "You feel a burning sensation as you consume the " << name << ".\n";
-                    dispatcher.sendMessage({id, "player", "damage", std::abs(usable->getEffectValue())});
-                }
-                dispatcher.sendMessage({id, "player", "removeItem", shared_from_this()});
-            }
-            else
-            {
-                std::cout << "You can't use " << name << ".\n";
-            }
-        }
-        else if (msg.message == "unlock")
-        {
-            if (auto lockable = getComponent<LockableComponent>())
-            {
-                try
-                {
-                    lockable->unlock(std::any_cast<std::string>(msg.data));
-                    std::cout << name << " has been unlocked.\n";
-                }
-                catch (const std::bad_any_cast &)
-                {
-                    std::cerr << "Invalid key data for unlocking " << name << ".\n";
-                }
-            }
-        }
-        else if (msg.message == "open")
-        {
-            if (auto openable = getComponent<OpenableComponent>())
-            {
-                if (!openable->isOpen())
-                {
-                    openable->setOpen();
-                    std::cout << name << " is now open.\n";
-                }
-                else
-                {
-                    std::cout << name << " is already open.\n";
-                }
-            }
-        }
-        else if (msg.message == "close")
-        {
-            if (auto openable = getComponent<OpenableComponent>())
-            {
-                if (openable->isOpen())
-                {
-                    openable->setClosed();
-                    std::cout << name << " is now closed.\n";
-                }
-                else
-                {
-                    std::cout << name << " is already closed.\n";
-                }
-            }
-        }
-        else if (msg.message == "addItem")
-        {
-            if (auto container = getComponent<ContainerComponent>())
-            {
-                container->addItem(std::any_cast<std::shared_ptr<Entity>>(msg.data));
-                std::cout << "Item added to " << name << ".\n";
-            }
-        }
-        else if (msg.message == "removeItem")
-        {
-            if (auto container = getComponent<ContainerComponent>())
-            {
-                container->removeItem(std::any_cast<std::shared_ptr<Entity>>(msg.data));
-                std::cout << "Item removed from " << name << ".\n";
-            }
-        }
-        else if (msg.message == "look_in")
-        {
-            if (auto container = getComponent<ContainerComponent>())
-            {
-                if (auto openable = getComponent<OpenableComponent>())
-                {
-                    if (!openable->isOpen())
-                    {
-                        std::cout << name << " is closed.\n";
-                        return;
-                    }
-                }
-
-                const auto &contents = container->getContents();
-                if (contents.empty())
-                {
-                    std::cout << "The " << name << " is empty.\n";
-                }
-                else
-                {
-                    std::cout << "Inside the " << name << " you find:\n";
-                    for (const auto &item : contents)
-                    {
-                        std::cout << " - " << item->getName() << ": " << item->getDescription() << "\n";
-                    }
-                }
-            }
-            else
-            {
-                std::cout << "You can't look inside " << name << ".\n";
-            }
-        }
-        else if (msg.message == "take_from")
-        {
-            if (auto container = getComponent<ContainerComponent>())
-            {
-                if (auto lockable = getComponent<LockableComponent>())
-                {
-                    if (lockable->isLocked())
-                    {
-                        std::cout << name << " is locked.\n";
-                        return;
-                    }
-                }
-
-                if (auto openable = getComponent<OpenableComponent>())
-                {
-                    if (!openable->isOpen())
-                    {
-                        std::cout << "The " << name << " is closed.\n";
-                        return;
-                    }
-                }
-
-                std::string itemName = std::any_cast<std::string>(msg.data);
-                const auto &contents = container->getContents();
-                for (const auto &item : contents)
-                {
-                    if (toLowerCase(item->getName()) == toLowerCase(itemName))
-                    {
-                        if (!item->getComponent<TakeableComponent>())
-                        {
-                            std::cout << "You can't take that.\n";
-                            return;
-                        }
-                        container->removeItem(item);
-                        dispatcher.sendMessage({id, "player", "addItem", item});
-                        std::cout << "Taken " << item->getName() << " from " << name << ".\n";
-                        return;
-                    }
-                }
-                std::cout << "You don't see a " << itemName << " in there.\n";
-            }
-            else
-            {
-                std::cout << name << " is not a container.\n";
-            }
-        }
-        else if (msg.message == "put_item")
-        {
-            if (auto container = getComponent<ContainerComponent>())
-            {
-                if (auto lockable = getComponent<LockableComponent>())
-                {
-                    if (lockable->isLocked())
-                    {
-                        std::cout << name << " is locked.\n";
-                        return;
-                    }
-                }
-
-                if (auto openable = getComponent<OpenableComponent>())
-                {
-                    if (!openable->isOpen())
-                    {
-                        std::cout << "The " << name << " is closed.\n";
-                        return;
-                    }
-                }
-
-                auto item = std::any_cast<std::shared_ptr<Entity>>(msg.data);
-                container->addItem(item);
-                dispatcher.sendMessage({id, "player", "removeItem", item});
-                std::cout << "You put the " << item->getName() << " in the " << name << ".\n";
-            }
-            else
-            {
-                std::cout << "The " << name << " is not a container.\n";
-            }
-        }
+        ZLOG(Trace, Entity, "entity '" << name.str() << "' received message from " << msg.from << " with message: '" << opcodeName(msg.opcode) << "'");
+        MessageTable::instance().dispatch(*this, msg);
     }
 
 private:
-    std::string id;                    // unique identifier for the entity
-    std::string name;                  // display name of the entity
-    std::string description;           // description of the entity
-    ComponentManager componentManager; // manages components of the entity
+    Symbol name;                       // display name of the entity
+    Symbol description;                // description of the entity
     MessageDispatcher &dispatcher;     // reference to the global dispatcher
-    bool takeable;
-    bool flammable;
+    Registry &registry;                // world registry holding this entity's components
+    EntityHandle handle;               // this entity's slot in the registry
+    MessageDispatcher::Registration registration; // unique identifier, handed out by the dispatcher; declared last so it unregisters first
 };
 
 #endif
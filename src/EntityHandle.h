@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+// 32-bit generational reference to an entity
+// the low bits index the entity's slot, the high bits hold the slot's generation
+// at the time the handle was made; once the entity is destroyed the slot's
+// generation moves on and every old handle to it resolves to nullptr
+class EntityHandle
+{
+public:
+    static constexpr uint32_t kIndexBits = 22; // ~4 million live entities
+    static constexpr uint32_t kGenerationBits = 32 - kIndexBits;
+    static constexpr uint32_t kIndexMask = (1u << kIndexBits) - 1;
+    static constexpr uint32_t kMaxIndex = kIndexMask;
+    static constexpr uint32_t kMaxGeneration = (1u << kGenerationBits) - 1;
+
+    // the null handle, generations start at 1 so it never matches a live entity
+    constexpr EntityHandle() = default;
+    constexpr EntityHandle(uint32_t index, uint32_t generation)
+        : value((generation << kIndexBits) | (index & kIndexMask)) {}
+
+    constexpr uint32_t index() const { return value & kIndexMask; }
+    constexpr uint32_t generation() const { return value >> kIndexBits; }
+    constexpr uint32_t raw() const { return value; }
+
+    constexpr bool isNull() const { return value == 0; }
+    constexpr explicit operator bool() const { return value != 0; }
+
+    constexpr bool operator==(const EntityHandle &other) const { return value == other.value; }
+    constexpr bool operator!=(const EntityHandle &other) const { return value != other.value; }
+
+private:
+    uint32_t value = 0;
+};
+
+template <>
+struct std::hash<EntityHandle>
+{
+    size_t operator()(const EntityHandle &handle) const noexcept { return std::hash<uint32_t>()(handle.raw()); }
+};
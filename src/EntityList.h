@@ -0,0 +1,65 @@
+#pragma once
+#include "EntityHandle.h"
+#include "Symbol.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+// an ordered list of entity handles plus an index by case-folded name
+// used for location contents, container contents and the player's inventory.
+// the index is kept up to date by add/remove so a name lookup is one hash probe;
+// entities sharing a name are kept in insertion order, so find returns the same
+// entity a front-to-back scan of the list would have
+class EntityList
+{
+public:
+    // name is the entity's display name, folded here
+    void add(EntityHandle entity, Symbol name)
+    {
+        items.push_back(entity);
+        byName[name.folded()].push_back(entity);
+    }
+
+    // returns false if the entity wasn't in the list
+    bool remove(EntityHandle entity, Symbol name)
+    {
+        auto it = std::find(items.begin(), items.end(), entity);
+        if (it == items.end())
+            return false;
+        items.erase(it);
+
+        auto bucket = byName.find(name.folded());
+        if (bucket != byName.end())
+        {
+            auto &sameName = bucket->second;
+            auto entry = std::find(sameName.begin(), sameName.end(), entity);
+            if (entry != sameName.end())
+                sameName.erase(entry);
+            // an emptied bucket is kept for the next entity of that name, so moving
+            // an item back and forth doesn't free and allocate a node every time
+        }
+        return true;
+    }
+
+    // first entity whose name folds to folded, or a null handle
+    // folded must already be a folded symbol, e.g. from Symbol::findFolded
+    EntityHandle find(Symbol folded) const
+    {
+        auto bucket = byName.find(folded);
+        return bucket != byName.end() && !bucket->second.empty() ? bucket->second.front() : EntityHandle();
+    }
+
+    const std::vector<EntityHandle> &handles() const { return items; }
+    bool empty() const { return items.empty(); }
+    size_t size() const { return items.size(); }
+
+private:
+    // symbols are already unique ids, no need to hash the text again
+    struct SymbolIdHash
+    {
+        size_t operator()(Symbol symbol) const noexcept { return symbol.id(); }
+    };
+
+    std::vector<EntityHandle> items;                                                 // in insertion order
+    std::unordered_map<Symbol, std::vector<EntityHandle>, SymbolIdHash> byName;      // folded name -> entities
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include "Entity.h"
+#include "Registry.h"
+#include <memory>
+#include <new>
+#include <vector>
+
+// slab storage for the entities of one world
+// entities are constructed in place in fixed size chunks, so creating one is a
+// slot reuse rather than a heap allocation and an entity never moves once
+// built. everything else refers to entities through EntityHandles.
+class EntityPool
+{
+public:
+    explicit EntityPool(Registry &registry) : registry(registry) {}
+    ~EntityPool() { clear(); }
+
+    EntityPool(const EntityPool &) = delete;
+    EntityPool &operator=(const EntityPool &) = delete;
+
+    // builds an entity in the slab, returns a null handle if the world is full
+    EntityHandle create(Symbol name, Symbol description, MessageDispatcher &dispatcher)
+    {
+        EntityHandle handle = registry.allocate();
+        if (handle.isNull())
+            return handle;
+        Entity *entity = new (slot(handle.index())) Entity(name, description, dispatcher, registry, handle);
+        registry.bind(handle, entity);
+        return handle;
+    }
+
+    // destroys the entity; the handle and every copy of it go stale
+    void destroy(EntityHandle handle)
+    {
+        if (Entity *entity = registry.resolve(handle))
+        {
+            entity->~Entity();
+            registry.release(handle);
+        }
+    }
+
+    // the entity behind a handle, or nullptr if the handle is stale
+    Entity *get(EntityHandle handle) const { return registry.resolve(handle); }
+
+    // destroys every live entity
+    void clear()
+    {
+        for (uint32_t index = 0; index < registry.slotCount(); ++index)
+        {
+            if (Entity *entity = registry.owner(index))
+                destroy(entity->getHandle());
+        }
+    }
+
+    size_t size() const { return registry.size(); }
+    Registry &getRegistry() { return registry; }
+
+private:
+    static constexpr size_t kChunkSize = 1024; // entities per chunk
+
+    struct alignas(Entity) Slot
+    {
+        unsigned char bytes[sizeof(Entity)];
+    };
+
+    uint32_t capacity() const { return static_cast<uint32_t>(chunks.size() * kChunkSize); }
+
+    // raw storage for an index, growing the slab a chunk at a time
+    void *slot(uint32_t index)
+    {
+        while (index >= capacity())
+            chunks.emplace_back(new Slot[kChunkSize]);
+        return chunks[index / kChunkSize][index % kChunkSize].bytes;
+    }
+
+    Registry &registry;
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+};
@@ -1,25 +1,30 @@
 #pragma once
 #include "../Component.h"
+#include "../EntityList.h"
 #include <vector>
-#include <memory>
-
-class Entity;  // crcluar depednecies
 
 class ContainerComponent : public Component {
 public:
-    // adds an item to the container
-    void addItem(std::shared_ptr<Entity> item) {
-        contents.push_back(item);
+    static constexpr ComponentType type = ComponentType::Container;
+
+    // adds an item to the container, indexed under its display name
+    void addItem(EntityHandle item, Symbol name) {
+        contents.add(item, name);
     }
 
     // removes an item from the container
-    void removeItem(std::shared_ptr<Entity> item) {
-        contents.erase(std::remove(contents.begin(), contents.end(), item), contents.end());
+    void removeItem(EntityHandle item, Symbol name) {
+        contents.remove(item, name);
+    }
+
+    // first item whose name matches case-insensitively, or a null handle
+    EntityHandle findItem(Symbol folded) const {
+        return contents.find(folded);
     }
 
     // retrieves the container's contents
-    const std::vector<std::shared_ptr<Entity>>& getContents() const {
-        return contents;
+    const std::vector<EntityHandle>& getContents() const {
+        return contents.handles();
     }
 
     // checks if the container has items
@@ -28,5 +33,5 @@ public:
     }
 
 private:
-    std::vector<std::shared_ptr<Entity>> contents; // stores items in the container
+    EntityList contents; // handles of the items in the container, indexed by name
 };
@@ -4,6 +4,8 @@
 class OpenableComponent : public Component
 {
 public:
+    static constexpr ComponentType type = ComponentType::Openable;
+
     // init
     OpenableComponent(bool initiallyOpen = false) : open(initiallyOpen) {}
 
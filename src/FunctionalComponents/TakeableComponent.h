@@ -3,6 +3,8 @@
 
 class TakeableComponent : public Component {
 public:
+    static constexpr ComponentType type = ComponentType::Takeable;
+
     TakeableComponent() = default;
     bool isTakeable() const { return true; }
 };
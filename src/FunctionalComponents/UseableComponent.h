@@ -11,6 +11,8 @@ enum class UseEffectType
 class UsableComponent : public Component
 {
 public:
+    static constexpr ComponentType type = ComponentType::Usable;
+
     // init with type and value
     UsableComponent(UseEffectType effectType = UseEffectType::NONE, int effectValue = 0)
         : effectType(effectType), effectValue(effectValue) {}
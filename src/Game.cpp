@@ -1,109 +1,455 @@
 #include "Game.h"
 #include "Command.h"
-#include "filesystem"
+#include "Log.h"
 #include <iostream>
-#include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
 
-// helper func to trim whitespace from a string
-static std::string trim(const std::string &str)
+// init game with commands, loads adventure file
+Game::Game(const std::string &filename, unsigned loaderThreads)
+    : Game(std::make_unique<World>(), nullptr, std::make_unique<StreamSink>(std::cout))
 {
-    auto start = str.find_first_not_of(" \t\n\r");
-    auto end = str.find_last_not_of(" \t\n\r");
-    return (start == std::string::npos) ? "" : str.substr(start, end - start + 1);
+    // loaded after the player registered, so the player keeps the first id
+    ownedWorld->load(filename, loaderThreads);
+    worldName = ownedWorld->name;
+    worldFile = ownedWorld->file;
 }
 
-// init game with commands, loads adventure file
-Game::Game(const std::string &filename)
-    : graph(dispatcher), player(1, graph, dispatcher), worldName(extractWorldName(filename)), dispatcher()
+Game::Game(World &shared, std::unique_ptr<OutputSink> sink)
+    : Game(nullptr, &shared, std::move(sink))
 {
-    std::cout << "Game constructor called." << std::endl;
+    worldName = shared.name;
+    worldFile = shared.file;
+}
 
-    // registers commands
-    commandManager.registerCommand("go", std::make_unique<GoCommand>());
+Game::Game(std::unique_ptr<World> owned, World *shared, std::unique_ptr<OutputSink> sink)
+    : ownedWorld(std::move(owned)), outputSink(std::move(sink)), output(*outputSink),
+      dispatcher(shared ? shared->dispatcher : ownedWorld->dispatcher), graph(shared ? shared->graph : ownedWorld->graph),
+      player(1, graph, dispatcher),
+      parser([this](Symbol name)
+             { return findInReach(name); })
+{
+    dispatcher.setOutput(&output);
+    queue.reserve(16);
+
+    // registers commands, with how each one reads the words after it
+    commandManager.registerCommand("go", std::make_unique<GoCommand>(), Grammar::words());
     commandManager.registerCommand("help", std::make_unique<HelpCommand>());
     commandManager.registerCommand("inventory", std::make_unique<InventoryCommand>());
-    commandManager.registerCommand("look", std::make_unique<LookCommand>());
-    commandManager.registerCommand("take", std::make_unique<TakeCommand>());
-    commandManager.registerCommand("alias", std::make_unique<AliasCommand>());
-    commandManager.registerCommand("debug", std::make_unique<DebugTreeCommand>());
+    commandManager.registerCommand("look", std::make_unique<LookCommand>(), Grammar{"", "at"});
     commandManager.registerCommand("look in", std::make_unique<LookInCommand>());
+    commandManager.registerCommand("take", std::make_unique<TakeCommand>(), Grammar{"from"});
+    commandManager.registerCommand("alias", std::make_unique<AliasCommand>(), Grammar::words());
+    commandManager.registerCommand("debug", std::make_unique<DebugTreeCommand>());
+    commandManager.registerCommand("stats", std::make_unique<StatsCommand>());
     commandManager.registerCommand("quit", std::make_unique<QuitCommand>());
-    commandManager.registerCommand("put", std::make_unique<PutCommand>());
-    commandManager.registerCommand("open", std::make_unique<OpenCommand>());
-    commandManager.registerCommand("use", std::make_unique<UseCommand>());
+    commandManager.registerCommand("put", std::make_unique<PutCommand>(), Grammar{"in"});
+    commandManager.registerCommand("open", std::make_unique<OpenCommand>(), Grammar{"with"});
+    commandManager.registerCommand("use", std::make_unique<UseCommand>(), Grammar{"on"});
+
+    // compass directions work on their own, and as their first letter
+    // exact names beat abbreviations, so S is south even though STATS starts with it too
+    for (const char *direction : {"north", "south", "east", "west"})
+    {
+        commandManager.registerCommand(direction, std::make_unique<GoCommand>(direction), Grammar::words());
+        commandManager.addAlias(std::string_view(direction, 1), direction);
+    }
+    commandManager.addAlias("move", "go");
+}
+
+Game::~Game()
+{
+    endTrace();
+    if (!ownedWorld)
+    {
+        // the world carries on without this player: what they carried stays behind,
+        // and their text buffer is about to go
+        player.dropInventory();
+        dispatcher.setOutput(nullptr);
+    }
+}
 
-    // loads adventure file and displays welcome message
-    std::cout << "Loading adventure file: " << filename << std::endl;
-    graph.loadFromFile(filename);
-    std::cout << "Adventure file loaded." << std::endl;
-    std::cout << "-- Welcome Player!! --\n\n ---------------------------------------------------- \n | Currently you're in the world of: " << worldName << "! |\n ----------------------------------------------------\n";
+void Game::welcome()
+{
+    output << "-- Welcome Player!! --\n\n ---------------------------------------------------- \n | Currently you're in the world of: " << worldName << "! |\n ----------------------------------------------------\n";
+    output.flush();
 }
 
-// helper func to grab world name from path
-std::string Game::extractWorldName(const std::string &filename)
+void Game::start()
 {
-    return std::filesystem::path(filename).stem().string();
+    dispatcher.setOutput(&output);
+    player.displayCurrentLocation();
+    output.flush();
+}
+
+// swaps the destination of game text, anything already buffered goes to the old sink first
+void Game::setOutputSink(std::unique_ptr<OutputSink> sink)
+{
+    output.flush();
+    outputSink = std::move(sink);
+    output.setSink(*outputSink);
 }
 
 // main game loop
-void Game::run()
+Game::Status Game::run()
 {
     std::string command;
 
-    // shows initial location to player
-    player.displayCurrentLocation();
+    // greets the player and shows where they are
+    welcome();
+    start();
 
     // continuously reads player input
     while (true)
     {
-        std::cout << "\n> ";
-        std::getline(std::cin, command);
+        output << "\n> ";
+        output.flush();
+        if (!std::getline(std::cin, command))
+        {
+            break; // end of input
+        }
+
+        processUInput(command);
+        if (isOver())
+            break;
+    }
+    endTrace();
+
+    if (status == Status::GameOver)
+    {
+        // leave the last words on screen until the player has read them
+        output << "Press enter to exit...\n";
+        output.flush();
+        std::cin.get();
+    }
+    return status;
+}
 
+Game::BatchResult Game::runBatch(std::istream &script)
+{
+    BatchResult result;
+    std::string command;
+    command.reserve(256);
+
+    uint64_t commandsBefore = commandsRun;
+    auto started = std::chrono::steady_clock::now();
+    while (!isOver() && std::getline(script, command))
+    {
+        auto before = std::chrono::steady_clock::now();
         processUInput(command);
+        auto nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                               std::chrono::steady_clock::now() - before)
+                                               .count());
+        result.latency.add(LatencyHistogram::bucketOf(nanos), 1);
+        result.maxNanos = std::max(result.maxNanos, nanos);
+        ++result.lines;
     }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.commands = commandsRun - commandsBefore;
+    result.status = status;
+    endTrace();
+    return result;
+}
+
+void Game::BatchResult::report(std::ostream &out) const
+{
+    static const char *const endings[] = {"end of input", "quit", "game over"};
+    // a percentile is its bucket's upper bound, never report it above the real maximum
+    auto micros = [&](double fraction)
+    { return static_cast<double>(std::min(latency.percentile(fraction), maxNanos)) / 1000.0; };
+
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "batch: %llu lines, %llu commands in %.3f s (%.0f commands/s), latency per line us p50 %.1f p90 %.1f p99 %.1f max %.1f, ended by %s\n",
+                  static_cast<unsigned long long>(lines), static_cast<unsigned long long>(commands), seconds,
+                  seconds > 0 ? commands / seconds : 0.0,
+                  micros(0.50), micros(0.90), micros(0.99), static_cast<double>(maxNanos) / 1000.0,
+                  endings[static_cast<int>(status)]);
+    out << line;
 }
 
-void Game::processUInput(const std::string &command)
+void Game::processUInput(const std::string &line)
 {
-    std::istringstream iss(command);
-    std::string cmd, args;
-    iss >> cmd;
-    std::getline(iss, args);
+    if (trace)
+        trace->input(line);
+    dispatcher.setOutput(&output); // handlers write to whichever player is acting
 
-    // case insensitivity
-    cmd = toLowerCase(cmd);
-    args = trim(args);
+    // a line can hold several commands separated by ';', queued and run back to back
+    queue.clear();
+    std::string_view rest(line);
+    while (true)
+    {
+        size_t end = rest.find(';');
+        std::string_view command = rest.substr(0, end);
+        if (command.find_first_not_of(" \t\r\n") != std::string_view::npos)
+            queue.push_back(command);
+        if (end == std::string_view::npos)
+            break;
+        rest.remove_prefix(end + 1);
+    }
+    if (queue.empty() && line.find(';') == std::string::npos)
+        queue.push_back(line); // a blank line is still an (invalid) command
 
-    if (cmd == "look")
+    for (size_t next = 0; next < queue.size() && !isOver(); ++next)
     {
-        if (args.empty()) // if arguments (anything after look) is empty then
+        if (!runCommand(queue[next]) && stopOnFailure && next + 1 < queue.size())
         {
-            commandManager.executeCommand("look", *this, args); // exec look command
+            size_t skipped = queue.size() - next - 1;
+            output << "(skipped " << skipped << (skipped == 1 ? " command" : " commands") << " after that failed)\n";
+            break;
         }
-        else if (args.rfind("at ", 0) == 0) // if followed by "at"
-        {
-            commandManager.executeCommand("look", *this, args); // pass "look" command with "at [the argument or in this case; entity]"
-        }
-        else if (args.rfind("in ", 0) == 0) // starts with "in " then
+    }
+
+    if (digestOutput)
+    {
+        outputDigest = ztr::digest(output.view());
+        if (trace)
+            trace->output(outputDigest);
+    }
+
+    // one write per line no matter how many commands or pieces of text it produced
+    output.flush();
+}
+
+bool Game::runCommand(std::string_view command)
+{
+    dispatcher.clearRefusal();
+    ++commandsRun;
+
+    // one pass over the command, one walk down the command table, then the command's grammar reads the rest
+    bool done = false;
+    CommandManager::Match match = commandManager.find(parser.tokenize(command));
+    if (match.entry)
+    {
+        done = match.entry->command->execute(*this, parser.parse(match.entry->grammar, match.words), output);
+    }
+    else
+    {
+        output << "Invalid command.\n";
+    }
+
+    // run everything the command sent, and everything that sent in turn,
+    // before the next command sees the world
+    dispatcher.drain();
+
+    if (status == Status::Playing && player.isDead())
+        status = Status::GameOver;
+    return done && !dispatcher.wasRefused();
+}
+
+// what a name refers to where the player is, or failing that in their inventory
+Entity *Game::findInReach(Symbol name) const
+{
+    auto location = graph.locations.find(player.getCurrentLocation());
+    if (location != graph.locations.end())
+    {
+        if (Entity *entity = location->second->findEntityByName(name))
+            return entity;
+    }
+    return player.findEntityInInventory(name);
+}
+
+// the game being traced, so a session that ends in exit() still gets its world digest
+static Game *tracedGame = nullptr;
+
+bool Game::startTrace(const std::string &filename)
+{
+    endTrace();
+    auto writer = std::make_unique<TraceWriter>(filename, worldFile, static_cast<uint8_t>(dispatcher.getMode()),
+                                                stopOnFailure ? ztr::kStopOnFailure : 0);
+    if (!writer->isOpen())
+        return false;
+    trace = std::move(writer);
+    digestOutput = true;
+    dispatcher.setTap([this](const Message &message)
+                      { trace->message(message); });
+
+    static bool hooked = false;
+    if (!hooked)
+    {
+        hooked = true;
+        std::atexit([]
+                    { if (tracedGame) tracedGame->endTrace(); });
+    }
+    tracedGame = this;
+    ZLOG(Info, General, "recording trace to " << filename);
+    return true;
+}
+
+void Game::endTrace()
+{
+    if (!trace)
+        return;
+    dispatcher.setTap(nullptr);
+    trace->world(stateDigest());
+    trace.reset();
+    digestOutput = false;
+    if (tracedGame == this)
+        tracedGame = nullptr;
+}
+
+// two messages are the same if they would have the same effect; symbols are
+// compared by text, since the trace stores text rather than symbol ids
+static bool sameMessage(const Message &sent, const TraceRecord &recorded)
+{
+    const Message &expected = recorded.message;
+    if (sent.from != expected.from || sent.to != expected.to || sent.opcode != expected.opcode)
+        return false;
+    if (sent.data.getKind() == Payload::Kind::Symbol)
+        return recorded.text == sent.data.asSymbol().str();
+    if (sent.data.getKind() != expected.data.getKind())
+        return false;
+    switch (sent.data.getKind())
+    {
+    case Payload::Kind::Int:
+        return sent.data.asInt() == expected.data.asInt();
+    case Payload::Kind::Entity:
+        return sent.data.asEntity() == expected.data.asEntity();
+    default:
+        return true;
+    }
+}
+
+// reads records one ahead: an input line is run, and the messages it sends are
+// matched against the message records that follow it as they are sent
+bool Game::replay(TraceReader &reader, std::ostream &report)
+{
+    auto previousSink = std::move(outputSink);
+    setOutputSink(std::make_unique<NullSink>());
+    digestOutput = true;
+
+    uint64_t lines = 0, sent = 0, recorded = 0, differences = 0;
+    bool worldChecked = false;
+    std::string firstDifference;
+    auto differs = [&](const std::string &what)
+    {
+        if (differences++ == 0)
+            firstDifference = what;
+    };
+
+    TraceRecord ahead;
+    bool more = reader.next(ahead);
+    dispatcher.setTap([&](const Message &message)
+                      {
+        ++sent;
+        if (more && ahead.tag == ztr::Tag::Message)
         {
-            commandManager.executeCommand("look in", *this, args.substr(3)); // pass "look in" command with the argument after "in "
-            // subtracting 3 to remove "in " from the string (ie. "in chest" -> "chest")
+            ++recorded;
+            if (!sameMessage(message, ahead))
+                differs("message " + std::to_string(sent) + " (" + std::string(opcodeName(message.opcode)) + " on line " +
+                        std::to_string(lines) + ") differs from the trace");
+            more = reader.next(ahead);
         }
         else
         {
-            std::cout << "Invalid look command. Use 'look' for the location, 'look at [entity]', or 'look in [container]'.\n";
+            differs("line " + std::to_string(lines) + " sent message " + std::to_string(sent) + " (" +
+                    std::string(opcodeName(message.opcode)) + "), which isn't in the trace");
+        } });
+
+    auto started = std::chrono::steady_clock::now();
+    while (more)
+    {
+        TraceRecord record = ahead;
+        switch (record.tag)
+        {
+        case ztr::Tag::Input:
+        {
+            std::string line(record.text);
+            more = reader.next(ahead);
+            ++lines;
+            if (isOver())
+                differs("the trace goes on after the session ended, at line " + std::to_string(lines));
+            else
+                processUInput(line);
+            break;
+        }
+        case ztr::Tag::Message:
+            ++recorded;
+            differs("message " + std::to_string(recorded) + " (" + std::string(opcodeName(record.message.opcode)) +
+                    ") is in the trace but line " + std::to_string(lines) + " didn't send it");
+            more = reader.next(ahead);
+            break;
+        case ztr::Tag::Output:
+            if (record.digest != outputDigest)
+                differs("the output of line " + std::to_string(lines) + " differs");
+            more = reader.next(ahead);
+            break;
+        case ztr::Tag::World:
+            worldChecked = true;
+            if (record.digest != stateDigest())
+                differs("the world state at the end differs");
+            more = reader.next(ahead);
+            break;
         }
     }
-    // handles 'go' or 'move' command with location display after
-    else if (cmd == "go" || cmd == "move")
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    dispatcher.setTap(nullptr);
+    digestOutput = false;
+    setOutputSink(std::move(previousSink));
+
+    if (!reader.error().empty())
+        differs(reader.error());
+    else if (reader.position() != reader.size())
+        differs("the trace is cut short at byte " + std::to_string(reader.position()));
+    if (!worldChecked)
+        differs("the trace has no final world state, the recording didn't finish");
+
+    report << "replayed " << lines << " lines and " << sent << " messages in " << seconds * 1000.0 << " ms";
+    if (seconds > 0)
+        report << " (" << static_cast<uint64_t>(lines / seconds) << " lines/s, " << static_cast<uint64_t>(sent / seconds)
+               << " messages/s)";
+    report << "\n";
+    if (differences == 0)
+        report << "identical: every message, every line's output and the final world state match\n";
+    else
+        report << differences << " difference(s), the first: " << firstDifference << "\n";
+    return differences == 0;
+}
+
+uint64_t Game::stateDigest() const
+{
+    using ztr::digest;
+    uint64_t hash = digest(static_cast<uint64_t>(player.getCurrentLocation()));
+    hash = digest(static_cast<uint64_t>(player.getHealth()), hash);
+    for (EntityHandle item : player.getInventory().handles())
+        hash = digest(item.raw(), hash);
+
+    // locations by number, so the digest doesn't depend on hash order
+    std::vector<int> numbers;
+    numbers.reserve(graph.locations.size());
+    for (const auto &entry : graph.locations)
+        numbers.push_back(entry.first);
+    std::sort(numbers.begin(), numbers.end());
+    for (int number : numbers)
     {
-        commandManager.executeCommand(cmd, *this, args);
-        player.displayCurrentLocation();
+        hash = digest(static_cast<uint64_t>(number), hash);
+        for (EntityHandle handle : graph.locations.at(number)->getEntities())
+            hash = digest(handle.raw(), hash);
     }
-    else
+
+    const Registry &registry = graph.registry;
+    for (size_t index = 0; index < registry.slotCount(); ++index)
     {
-        // executes other commands
-        commandManager.executeCommand(cmd, *this, args);
+        const Entity *entity = registry.owner(static_cast<EntityIndex>(index));
+        if (!entity)
+            continue;
+        hash = digest(entity->getHandle().raw(), hash);
+        hash = digest(entity->getSignature(), hash);
+        if (auto openable = entity->getComponent<OpenableComponent>())
+            hash = digest(openable->isOpen(), hash);
+        if (auto lockable = entity->getComponent<LockableComponent>())
+            hash = digest(lockable->isLocked(), hash);
+        if (auto health = entity->getComponent<HealthComponent>())
+            hash = digest(static_cast<uint64_t>(health->getHealth()), hash);
+        if (auto container = entity->getComponent<ContainerComponent>())
+        {
+            for (EntityHandle item : container->getContents())
+                hash = digest(item.raw(), hash);
+        }
     }
+    return hash;
 }
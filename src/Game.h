@@ -1,27 +1,122 @@
 #ifndef GAME_H
 #define GAME_H
 
-#include "Graph.h"
+#include "World.h"
 #include "Player.h"
 #include "CommandManager.h"
+#include "Parser.h"
 #include "MessageDispatcher.h"
+#include "OutputSink.h"
+#include "Trace.h"
+#include "DispatchStats.h"
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class Game
 {
+    // the world a single player game loaded for itself, null for a player in a shared one
+    // first, so it is built before and outlives everything below that points into it
+    std::unique_ptr<World> ownedWorld;
+
 public:
-    Game(const std::string &filename); 
-    void run();
-    void processUInput(const std::string &command); 
+    // how a session stands; the game never exits the process itself
+    enum class Status
+    {
+        Playing,  // still going, or the input ran out
+        Quit,     // the player typed QUIT
+        GameOver  // the player died
+    };
+
+    // what a headless run did, see runBatch
+    struct BatchResult
+    {
+        Status status = Status::Playing;
+        uint64_t lines = 0;
+        uint64_t commands = 0; // a line can hold several
+        double seconds = 0;
+        LatencyHistogram latency; // per input line, in ns
+        uint64_t maxNanos = 0;
+
+        // one summary line: lines and commands per second, latency percentiles and how it ended
+        void report(std::ostream &out) const;
+    };
+
+    // loaderThreads > 1 tokenizes text worlds in parallel (0 = one thread per core)
+    Game(const std::string &filename, unsigned loaderThreads = 1);
+    // another player in a world loaded elsewhere, e.g. one connection to a server, writing to its own sink
+    // a world can hold any number of them as long as one thread runs them all, one input line at a time
+    Game(World &world, std::unique_ptr<OutputSink> sink);
+    ~Game();
+    // the banner naming the world, for sessions someone is watching: run() and network
+    // players get it, batch runs, replays and the tools don't
+    void welcome();
+    // shows where the player stands, the first thing run() does after the banner
+    void start();
+    // plays interactively on std::cin until the input ends, the player quits or dies
+    Status run();
+    // runs every line of a script or pipe with no prompts and no opening location,
+    // until it ends, the player quits or dies, timing each line
+    BatchResult runBatch(std::istream &script);
+    // runs one input line, its text is flushed to the output sink in a single write
+    // commands separated by ';' run in order, each once everything the one before sent is done
+    void processUInput(const std::string &line);
+
+    // stops the rest of a line's commands once one fails, e.g. "take bag; open chest with key"
+    // doesn't try the key if there was no bag; off by default
+    void setStopOnFailure(bool stop) { stopOnFailure = stop; }
+
+    // redirects game text, e.g. to a FileSink to capture a session
+    void setOutputSink(std::unique_ptr<OutputSink> sink);
 
-    MessageDispatcher dispatcher; 
-    Graph graph;
+    // ends the session once the current input line has been handled
+    void quit() { status = Status::Quit; }
+    Status getStatus() const { return status; }
+    bool isOver() const { return status != Status::Playing; }
+    uint64_t getCommandsRun() const { return commandsRun; }
+
+    // records input lines, messages and digests of the output and the final world
+    // to a trace file until the session ends, however it ends
+    bool startTrace(const std::string &filename);
+    void endTrace();
+
+    // re-runs a traced session without printing anything and checks it plays out
+    // the same: every message, every line's output and the final world state.
+    // writes a summary to report, returns true if nothing differed
+    // (STATS prints timings, so a line running it never matches its recorded output)
+    bool replay(TraceReader &reader, std::ostream &report);
+
+    // a digest of everything a session can change: the player, where every entity
+    // is and the state of its components
+    uint64_t stateDigest() const;
+
+    std::unique_ptr<OutputSink> outputSink; // where game text goes, the terminal by default
+    OutputBuffer output;                    // reusable buffer handed to each command
+    MessageDispatcher &dispatcher; // the world's, shared with every other player in it
+    Graph &graph;
     Player player;
     std::string worldName;
     CommandManager commandManager;
+    Parser parser; // reused for every input line
 
 private:
-    std::string extractWorldName(const std::string &filename);
+    Game(std::unique_ptr<World> owned, World *shared, std::unique_ptr<OutputSink> sink);
+    Entity *findInReach(Symbol name) const;
+    // runs one command of a line, false if it failed
+    bool runCommand(std::string_view command);
+
+    std::string worldFile;               // the world this game was loaded from, named in traces
+    Status status = Status::Playing;
+    bool stopOnFailure = false;          // see setStopOnFailure
+    uint64_t commandsRun = 0;            // over the whole session
+    std::vector<std::string_view> queue; // the current line's commands, views into it
+    std::unique_ptr<TraceWriter> trace;  // set while recording
+    bool digestOutput = false;           // set while recording or replaying
+    uint64_t outputDigest = 0;           // of the last input line's output
 };
 
 #endif
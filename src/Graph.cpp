@@ -7,15 +7,23 @@
 #include "./AttributeComponents/LockableComponent.h"
 #include "./AttributeComponents/HealthComponent.h"
 #include "MessageDispatcher.h" // include dispatcher
+#include "MappedFile.h"
+#include "WorldImage.h"
+#include "ComponentRegistry.h"
+#include "Log.h"
+#include "Symbol.h"
 
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <algorithm>
-#include <regex>
+#include <charconv>
+#include <string_view>
+#include <atomic>
+#include <thread>
 
 // we love to trim whitespace from a string
-static std::string trim(const std::string &str)
+// works on a view so trimming never copies the underlying characters
+static std::string_view trim(std::string_view str)
 {
     // find the first and last non-whitespace characters
     // thanks to https://stackoverflow.com/questions/25829143/trim-whitespace-from-a-string
@@ -23,11 +31,31 @@ static std::string trim(const std::string &str)
     size_t start = str.find_first_not_of(" \t\n\r");
     // https://cplusplus.com/reference/string/string/find_last_not_of/
     size_t end = str.find_last_not_of(" \t\n\r");
-    return (start == std::string::npos) ? "" : str.substr(start, end - start + 1);
+    return (start == std::string_view::npos) ? std::string_view() : str.substr(start, end - start + 1);
+}
+
+// splits off everything up to the next delimiter and advances str past it
+// if there is no delimiter the rest of str is returned and str becomes empty
+static std::string_view nextField(std::string_view &str, char delim)
+{
+    size_t pos = str.find(delim);
+    std::string_view field = str.substr(0, pos);
+    str = (pos == std::string_view::npos) ? std::string_view() : str.substr(pos + 1);
+    return field;
+}
+
+// parses a leading signed integer like std::stoi, ignoring anything after the digits
+static bool parseInt(std::string_view str, int &value)
+{
+    str = trim(str);
+    if (!str.empty() && str[0] == '+')
+        str.remove_prefix(1);
+    auto result = std::from_chars(str.data(), str.data() + str.size(), value);
+    return result.ec == std::errc();
 }
 
 // helper function to count leading spaces or tabs for indentation level
-int countIndentation(const std::string &line)
+int countIndentation(std::string_view line)
 {
     int count = 0;
     for (char c : line)
@@ -40,225 +68,515 @@ int countIndentation(const std::string &line)
     return count;
 }
 
-// load location and connection data from the single-line world file
-// rewrote to handle nested entities
-void Graph::loadFromFile(const std::string &filename)
+// reports how much the symbol table deduplicated while loading
+static void logSymbolStats()
 {
-    std::cout << "Opening file: " << filename << std::endl;
-    std::ifstream file(filename);
-    if (!file.is_open())
-    {
-        std::cerr << "Error: Could not open file " << filename << std::endl;
-        return;
-    }
-    std::cout << "File opened successfully." << std::endl;
+    SymbolTable::Stats stats = SymbolTable::instance().stats();
+    ZLOG(Info, Loader, "interned " << stats.requests << " strings (" << stats.requestedBytes << " bytes) into "
+                                   << stats.symbols << " symbols (" << stats.storedBytes << " bytes)");
+}
 
-    std::cout << "loading world from file: " << filename << std::endl;
+// locations point at each other through their connections, which would keep
+// every one of them alive after the graph is gone
+Graph::~Graph()
+{
+    for (auto &entry : locations)
+        entry.second->connections.clear();
+}
 
-    std::string line;
-    std::shared_ptr<Location> currentLocation = nullptr;
-    std::shared_ptr<Entity> currentContainer = nullptr;
-    int containerIndentationLevel = -1;
-    
-    // stores connections to be processed later (hierarchy)
-    std::vector<std::tuple<int, std::string, int>> pendingConnections;
+// registres location with dispatcher; commands send to location->id, the name labels it in logs and stats
+void Graph::registerLocation(const std::shared_ptr<Location> &location)
+{
+    Symbol locId("location_" + std::to_string(location->number));
+    EntityId id = dispatcher.registerRecipient(locId, [location, this](const Message &msg) {
+        // handnles location-specific messages here
+        if (msg.opcode == Opcode::RemoveItem) {
+            Symbol itemName = msg.data.asSymbol();
+            auto entity = location->findEntityByName(itemName);
+            if (entity && entity->hasComponent<TakeableComponent>()) {
+                EntityHandle handle = entity->getHandle();
+                location->removeEntity(handle);
+                // Send the item back to whoever asked for it
+                dispatcher.sendMessage({msg.to, msg.from, Opcode::AddItem, handle});
+            } else {
+                dispatcher.output() << "You can't take the " << itemName.str() << ".\n";
+                dispatcher.refuse();
+            }
+        }
+    });
+    location->id = id;
+    registrations.emplace_back(dispatcher, id);
+}
+
+// indexes an entity under its display name so commands can address it
+// the entity registered its id when it was built; the first entity to use a name keeps it
+void Graph::registerEntity(EntityHandle handle)
+{
+    Entity *entity = entities.get(handle);
+    dispatcher.addName(entity->getNameSymbol(), entity->getId());
+    ZLOG(Debug, Loader, "registered entity: " << entity->getName() << " as " << entity->getId());
+}
 
-    while (std::getline(file, line))
+namespace
+{
+    // a connection token from a location line
+    struct ParsedConnection
     {
-        int currentIndentationLevel = countIndentation(line);
-        std::string trimmedLine = trim(line);
+        std::string_view direction;
+        uint32_t directionString; // into ParsedChunk::strings
+        int target;
+        bool valid; // false if the target id didn't parse
+    };
 
-        if (trimmedLine.empty())
+    // one non-blank line of the world file, tokenized but not yet turned into objects
+    // every view points into the mapped file
+    struct ParsedLine
+    {
+        enum Kind
         {
-            std::cout << "skipping blank line\n";
-            continue; 
-        }
+            LocationLine,
+            EntityLine,
+            BadLocationId,  // starts with a digit but the id doesn't parse
+            MissingFields   // entity line without a name or description
+        };
 
-        try
-        {
-            std::cout << "processing line: " << trimmedLine << std::endl;
+        Kind kind;
+        std::string_view text; // trimmed line, kept for diagnostics
+        int indentation;
+        int id;                // location id
+        std::string_view name;
+        std::string_view description;
+        uint32_t nameString;           // name and description in ParsedChunk::strings
+        uint32_t descriptionString;
+        std::string_view properties;   // entity property list, still unparsed
+        uint32_t firstConnection;      // range into ParsedChunk::connections
+        uint32_t connectionCount;
+    };
 
-            // handles location parsing
-            if (isdigit(trimmedLine[0]))
-            {
-                std::stringstream ss(trimmedLine);
-                std::string idStr, name, description, connectionsStr;
+    // roughly how much of the file is tokenized into one slice
+    constexpr size_t kChunkBytes = 1 << 20;
 
-                std::getline(ss, idStr, ';');
-                int locID = std::stoi(trim(idStr));
-                std::getline(ss, name, ';');
-                name = trim(name);
-                std::getline(ss, description, ';');
-                description = trim(description);
+    // per-thread output buffer for one slice of the file
+    struct ParsedChunk
+    {
+        std::string_view text;
+        std::vector<ParsedLine> lines;
+        std::vector<ParsedConnection> connections;
+        // every distinct name, description and direction of the slice, in the order
+        // they first appear; interning a string costs a probe of the big shared table,
+        // so the build pass interns each of these once instead of once per use
+        std::vector<std::string_view> strings;
+        std::unordered_map<std::string_view, uint32_t> seen; // strings -> index, only while tokenizing
+        std::vector<Symbol> symbols;                          // strings, interned by the build pass
+    };
 
-                std::cout << "creating location: id=" << locID << ", name=" << name
-                          << ", description=" << description << std::endl;
+    // numbers a string within its slice, the same string always getting the same number
+    uint32_t localString(ParsedChunk &chunk, std::string_view text)
+    {
+        auto [it, added] = chunk.seen.emplace(text, static_cast<uint32_t>(chunk.strings.size()));
+        if (added)
+            chunk.strings.push_back(text);
+        return it->second;
+    }
 
-                currentLocation = std::make_shared<Location>(locID, name, description);
-                locations[locID] = currentLocation;
+    // tokenizes a slice of the file; touches nothing shared so it can run on any thread
+    void parseChunk(ParsedChunk &chunk)
+    {
+        std::string_view remaining = chunk.text;
+        while (!remaining.empty())
+        {
+            std::string_view line = nextField(remaining, '\n');
+            std::string_view trimmedLine = trim(line);
+            if (trimmedLine.empty())
+                continue;
 
-                // stores connections for later processing
-                std::getline(ss, connectionsStr, ';');
-                std::stringstream connectionsStream(connectionsStr);
-                std::string connection;
+            ParsedLine parsed{};
+            parsed.text = trimmedLine;
+            parsed.indentation = countIndentation(line);
+            std::string_view fields = trimmedLine;
 
-                while (std::getline(connectionsStream, connection, ','))
+            // handles location parsing
+            if (isdigit(static_cast<unsigned char>(trimmedLine[0])))
+            {
+                parsed.kind = ParsedLine::LocationLine;
+                if (!parseInt(nextField(fields, ';'), parsed.id))
                 {
-                    std::stringstream connectionStream(connection);
-                    std::string direction, connectedLocIDStr;
-
-                    std::getline(connectionStream, direction, '=');
-                    std::getline(connectionStream, connectedLocIDStr);
-
-                    direction = trim(direction);
-                    int connectedLocID = std::stoi(trim(connectedLocIDStr));
-                    pendingConnections.emplace_back(locID, direction, connectedLocID);
+                    parsed.kind = ParsedLine::BadLocationId;
+                    chunk.lines.push_back(parsed);
+                    continue;
                 }
+                parsed.name = trim(nextField(fields, ';'));
+                parsed.description = trim(nextField(fields, ';'));
+                parsed.nameString = localString(chunk, parsed.name);
+                parsed.descriptionString = localString(chunk, parsed.description);
 
-                // registres location with dispatcher using unique ID
-                std::string locId = "location_" + std::to_string(locID);
-                dispatcher.registerRecipient(locId, [currentLocation, this](const Message &msg) {
-                    // handnles location-specific messages here
-                    if (msg.message == "removeItem") {
-                        std::string itemName = std::any_cast<std::string>(msg.data);
-                        auto entity = currentLocation->findEntityByName(itemName);
-                        if (entity && entity->getComponent<TakeableComponent>()) {
-                            currentLocation->removeEntity(entity);
-                            // Send the item to the player
-                            dispatcher.sendMessage({"location", "player", "addItem", entity});
-                        } else {
-                            std::cout << "You can't take the " << itemName << ".\n";
-                        }
-                    }
-                });
-
-                currentContainer = nullptr;
-                containerIndentationLevel = -1;
+                std::string_view connectionsStr = nextField(fields, ';');
+                parsed.firstConnection = static_cast<uint32_t>(chunk.connections.size());
+                while (!connectionsStr.empty())
+                {
+                    std::string_view connection = nextField(connectionsStr, ',');
+                    ParsedConnection parsedConnection{};
+                    parsedConnection.direction = trim(nextField(connection, '='));
+                    parsedConnection.valid = parseInt(connection, parsedConnection.target);
+                    parsedConnection.directionString = localString(chunk, parsedConnection.direction);
+                    chunk.connections.push_back(parsedConnection);
+                }
+                parsed.connectionCount = static_cast<uint32_t>(chunk.connections.size()) - parsed.firstConnection;
             }
             // handlse entity parsing
-            else if (currentLocation)
+            else
             {
-                std::stringstream ss(trimmedLine);
-                std::string entityName, entityDescription, propertiesStr;
-
-                std::getline(ss, entityName, ':');
-                entityName = trim(entityName);
-                std::getline(ss, entityDescription, ';');
-                entityDescription = trim(entityDescription);
+                parsed.kind = ParsedLine::EntityLine;
+                parsed.name = trim(nextField(fields, ':'));
+                parsed.description = trim(nextField(fields, ';'));
+                parsed.properties = trim(fields);
+                if (parsed.name.empty() || parsed.description.empty())
+                    parsed.kind = ParsedLine::MissingFields;
+                else
+                {
+                    parsed.nameString = localString(chunk, parsed.name);
+                    parsed.descriptionString = localString(chunk, parsed.description);
+                }
+            }
+            chunk.lines.push_back(parsed);
+        }
+        chunk.seen = {}; // freed here, on the worker
+    }
 
-                if (entityName.empty() || entityDescription.empty())
+    // cuts the file into roughly equal slices that each start on a location record
+    // (a digit in column 0), so every slice can be tokenized independently
+    std::vector<ParsedChunk> splitIntoChunks(std::string_view text, size_t count)
+    {
+        std::vector<ParsedChunk> chunks;
+        size_t start = 0;
+        for (size_t i = 1; i < count && start < text.size(); ++i)
+        {
+            size_t cut = std::max(start, text.size() * i / count);
+            // move forward to the next line that begins a location record
+            while (cut < text.size())
+            {
+                cut = text.find('\n', cut);
+                if (cut == std::string_view::npos)
                 {
-                    std::cerr << "warning: skipped entity due to missing name or description: " << trimmedLine << std::endl;
-                    continue; // skip invalid entities
+                    cut = text.size();
+                    break;
                 }
+                ++cut;
+                if (cut < text.size() && isdigit(static_cast<unsigned char>(text[cut])))
+                    break;
+            }
+            if (cut >= text.size())
+                break;
+            chunks.emplace_back();
+            chunks.back().text = text.substr(start, cut - start);
+            start = cut;
+        }
+        chunks.emplace_back();
+        chunks.back().text = text.substr(start);
+        return chunks;
+    }
+
+    // tokenizes count chunks from first, spreading the work over a small pool of threads
+    void parseChunks(ParsedChunk *first, size_t count, unsigned threadCount)
+    {
+        threadCount = std::min<unsigned>(threadCount, static_cast<unsigned>(count));
+        if (threadCount <= 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+                parseChunk(first[i]);
+            return;
+        }
+
+        // workers pull chunks off a shared counter so uneven slices still balance out
+        std::atomic<size_t> next{0};
+        auto worker = [first, count, &next]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+                parseChunk(first[i]);
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(threadCount - 1);
+        for (unsigned i = 1; i < threadCount; ++i)
+            pool.emplace_back(worker);
+        worker();
+        for (auto &thread : pool)
+            thread.join();
+    }
+}
+
+// chooses how many threads tokenize the world file, 0 picks one per core
+void Graph::setLoaderThreads(unsigned threads)
+{
+    loaderThreads = threads;
+}
+
+// load location and connection data from the single-line world file
+// rewrote to handle nested entities
+// the file is memory mapped and tokenized in place, only the final objects allocate
+// tokenizing runs on loaderThreads threads, which also number the distinct names,
+// descriptions and directions of their slice; objects are then built and registered
+// with the dispatcher serially in file order so ids stay deterministic. the entity
+// pool, the dispatcher and the symbol table all belong to the loading thread, so
+// the workers hand over strings instead of finished objects, and the build pass
+// interns each distinct string of a slice once instead of once per use
+//
+// the file is cut into slices of about kChunkBytes that are tokenized a batch at a
+// time, and each batch is built before the next is read: only one batch's tokens
+// are ever held, and the file pages behind a built batch are dropped, so peak
+// memory is the world itself rather than the world plus every token of the file
+void Graph::loadFromFile(const std::string &filename)
+{
+    ZLOG(Info, Loader, "opening file: " << filename);
+    MappedFile file(filename);
+    if (!file.isOpen())
+    {
+        ZLOG(Error, Loader, "could not open file " << filename);
+        return;
+    }
+    ZLOG(Info, Loader, "loading world from file: " << filename);
+
+    std::string_view text = file.view();
+    unsigned threads = loaderThreads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : loaderThreads;
+    // a small world is cut finer so every thread asked for gets a slice
+    std::vector<ParsedChunk> chunks = splitIntoChunks(text, std::max<size_t>(threads, text.size() / kChunkBytes));
+    if (chunks.size() < threads)
+    {
+        // a slice must start on a location record, so there can't be more slices than locations
+        ZLOG(Info, Loader, "only " << chunks.size() << " slice(s) to tokenize, using " << chunks.size() << " of " << threads << " threads");
+        threads = static_cast<unsigned>(chunks.size());
+    }
+    ZLOG(Info, Loader, "tokenizing " << chunks.size() << " slice(s) on " << threads << " thread(s)");
+    // a few chunks per thread keeps the pool busy when record sizes vary
+    size_t batch = threads > 1 ? threads * 4 : 1;
 
-                std::cout << "creating entity: name=" << entityName
-                          << ", description=" << entityDescription << std::endl;
+    std::shared_ptr<Location> currentLocation = nullptr;
+    Entity *currentContainer = nullptr;
+    int containerIndentationLevel = -1;
 
-                auto entity = std::make_shared<Entity>(entityName, entityDescription, dispatcher);
-                bool isContainer = false;
+    // stores connections to be processed later (hierarchy)
+    std::vector<std::tuple<int, Symbol, int>> pendingConnections;
 
-                if (std::getline(ss, propertiesStr))
+    for (size_t first = 0; first < chunks.size(); first += batch)
+    {
+        size_t count = std::min(batch, chunks.size() - first);
+        parseChunks(&chunks[first], count, threads);
+        for (size_t c = first; c < first + count; ++c)
+        {
+            ParsedChunk &chunk = chunks[c];
+            // the symbol table belongs to this thread, so the interning happens here,
+            // once per distinct string of the slice
+            chunk.symbols.reserve(chunk.strings.size());
+            for (std::string_view string : chunk.strings)
+                chunk.symbols.emplace_back(string);
+            for (const auto &parsed : chunk.lines)
+            {
+                try
                 {
-                    propertiesStr = trim(propertiesStr);
-                    std::cout << "parsing properties for entity: " << propertiesStr << std::endl;
+                    ZLOG(Debug, Loader, "processing line: " << parsed.text);
 
-                    if (propertiesStr.find("Takeable") != std::string::npos)
+                    if (parsed.kind == ParsedLine::BadLocationId)
                     {
-                        entity->addComponent(std::make_shared<TakeableComponent>());
-                        std::cout << "added component: TakeableComponent\n";
+                        ZLOG(Warn, Loader, "error processing line: " << parsed.text << " - invalid location id");
                     }
-                    if (propertiesStr.find("Container") != std::string::npos)
+                    else if (parsed.kind == ParsedLine::LocationLine)
                     {
-                        entity->addComponent(std::make_shared<ContainerComponent>());
-                        isContainer = true;
-                        std::cout << "added component: ContainerComponent\n";
+                        ZLOG(Debug, Loader, "creating location: id=" << parsed.id << ", name=" << parsed.name
+                                                                     << ", description=" << parsed.description);
+
+                        currentLocation = std::make_shared<Location>(parsed.id, chunk.symbols[parsed.nameString], chunk.symbols[parsed.descriptionString], registry);
+                        locations[parsed.id] = currentLocation;
+
+                        for (uint32_t i = parsed.firstConnection; i < parsed.firstConnection + parsed.connectionCount; ++i)
+                        {
+                            const ParsedConnection &connection = chunk.connections[i];
+                            if (connection.valid)
+                                pendingConnections.emplace_back(parsed.id, chunk.symbols[connection.directionString], connection.target);
+                            else
+                                ZLOG(Warn, Loader, "error processing line: " << parsed.text << " - invalid connection '" << connection.direction << "'");
+                        }
+
+                        registerLocation(currentLocation);
+
+                        currentContainer = nullptr;
+                        containerIndentationLevel = -1;
                     }
-                    if (propertiesStr.find("Openable") != std::string::npos)
+                    else if (currentLocation && parsed.kind == ParsedLine::MissingFields)
                     {
-                        entity->addComponent(std::make_shared<OpenableComponent>());
-                        std::cout << "added component: OpenableComponent\n";
+                        ZLOG(Warn, Loader, "skipped entity due to missing name or description: " << parsed.text);
                     }
-                    if (propertiesStr.find("Lockable=") != std::string::npos)
+                    else if (currentLocation)
                     {
-                        std::regex lockRegex(R"(Lockable=([^,\]]+))");
-                        std::smatch match;
-                        if (std::regex_search(propertiesStr, match, lockRegex))
+                        ZLOG(Debug, Loader, "creating entity: name=" << parsed.name
+                                                                     << ", description=" << parsed.description);
+
+                        EntityHandle handle = entities.create(chunk.symbols[parsed.nameString], chunk.symbols[parsed.descriptionString], dispatcher);
+                        Entity *entity = entities.get(handle);
+                        if (!entity)
                         {
-                            entity->addComponent(std::make_shared<LockableComponent>(match[1]));
-                            std::cout << "added component: LockableComponent with key=" << match[1] << "\n";
+                            ZLOG(Error, Loader, "entity limit reached, skipped: " << parsed.text);
+                            continue;
                         }
-                    }
-                    if (propertiesStr.find("Health=") != std::string::npos)
-                    {
-                        std::regex healthRegex(R"(Health=\+?(\d+))");
-                        std::smatch match;
-                        if (std::regex_search(propertiesStr, match, healthRegex))
+                        if (!parsed.properties.empty())
                         {
-                            entity->addComponent(std::make_shared<HealthComponent>(std::stoi(match[1])));
-                            std::cout << "added component: HealthComponent with health=" << match[1] << "\n";
+                            ZLOG(Debug, Loader, "parsing properties for entity: " << parsed.properties);
+
+                            PropertyList properties;
+                            if (!properties.parse(parsed.properties))
+                                ZLOG(Warn, Loader, "too many properties, extra entries ignored: " << parsed.text);
+                            ComponentRegistry::instance().apply(*entity, properties);
                         }
-                    }
-                    if (propertiesStr.find("Usable") != std::string::npos)
-                    {
-                        if (propertiesStr.find("Health=") != std::string::npos)
+                        bool isContainer = entity->getComponent<ContainerComponent>() != nullptr;
+
+                        registerEntity(handle);
+
+                        if (parsed.indentation > containerIndentationLevel && currentContainer && currentContainer->getComponent<ContainerComponent>())
                         {
-                            size_t pos = propertiesStr.find("Health=");
-                            int healthEffect = std::stoi(trim(propertiesStr.substr(pos + 7)));
-                            entity->addComponent(std::make_shared<UsableComponent>(
-                                healthEffect > 0 ? UseEffectType::HEAL : UseEffectType::DAMAGE, healthEffect));
-                            std::cout << "added component: UsableComponent with healthEffect=" << healthEffect << "\n";
+                            currentContainer->getComponent<ContainerComponent>()->addItem(handle, entity->getNameSymbol());
+                            ZLOG(Debug, Loader, "added entity: " << entity->getName() << " to container: " << currentContainer->getName());
                         }
                         else
                         {
-                            entity->addComponent(std::make_shared<UsableComponent>());
-                            std::cout << "added component: UsableComponent\n";
+                            currentLocation->addEntity(handle);
+                            ZLOG(Debug, Loader, "added entity: " << entity->getName() << " to location: " << currentLocation->name.str());
+
+                            if (isContainer)
+                            {
+                                currentContainer = entity;
+                                containerIndentationLevel = parsed.indentation;
+                            }
+                            else
+                            {
+                                currentContainer = nullptr;
+                            }
                         }
                     }
                 }
-
-                dispatcher.registerRecipient(entity->getName(), [entity](const Message &msg)
-                                             { entity->handleMessage(msg); });
-                std::cout << "registered entity: " << entity->getName() << " with dispatcher\n";
-
-                if (currentIndentationLevel > containerIndentationLevel && currentContainer && currentContainer->getComponent<ContainerComponent>())
+                catch (const std::exception &e)
                 {
-                    currentContainer->getComponent<ContainerComponent>()->addItem(entity);
-                    std::cout << "added entity: " << entity->getName() << " to container: " << currentContainer->getName() << "\n";
+                    ZLOG(Warn, Loader, "error processing line: " << parsed.text << " - " << e.what());
                 }
-                else
-                {
-                    currentLocation->addEntity(entity);
-                    std::cout << "added entity: " << entity->getName() << " to location: " << currentLocation->name << "\n";
+            }
+            // everything built from this slice has its own copies now
+            file.release(chunk.text);
+            chunk = ParsedChunk{};
+        }
+    }
 
-                    if (isContainer)
-                    {
-                        currentContainer = entity;
-                        containerIndentationLevel = currentIndentationLevel;
-                    }
-                    else
-                    {
-                        currentContainer = nullptr;
-                    }
-                }
+    // process all connections after all locations are loaded
+    for (const auto &[fromID, direction, toID] : pendingConnections)
+    {
+        auto from = locations.find(fromID);
+        auto to = locations.find(toID);
+        if (from != locations.end() && to != locations.end())
+        {
+            from->second->addConnection(direction, to->second);
+            ZLOG(Debug, Loader, "added connection from location " << fromID << " to location "
+                                                                  << toID << " in direction " << direction.str());
+        }
+    }
+
+    ZLOG(Info, Loader, "finished loading world from file: " << filename);
+    logSymbolStats();
+}
+// checks that a [first, first + count) range fits inside a section of size total
+static bool rangeFits(uint32_t first, uint32_t count, uint32_t total)
+{
+    return first <= total && total - first >= count;
+}
+
+// builds an entity and, for containers, its contents from the image records
+static EntityHandle buildEntity(const WorldImage &image, uint32_t index, MessageDispatcher &dispatcher,
+                                EntityPool &entities, std::vector<EntityHandle> &created)
+{
+    const zwb::EntityRecord &record = image.entity(index);
+    EntityHandle handle = entities.create(Symbol(image.string(record.name)), Symbol(image.string(record.description)), dispatcher);
+    Entity *entity = entities.get(handle);
+    if (!entity)
+    {
+        ZLOG(Error, Loader, "entity limit reached while loading world image");
+        return handle;
+    }
+
+    // the same factories the text loader runs, so registered components need nothing here
+    PropertyList properties;
+    if (!properties.parse(image.string(record.properties)))
+        ZLOG(Warn, Loader, "too many properties on entity " << entity->getName() << ", extra ones are ignored");
+    ComponentRegistry::instance().apply(*entity, properties);
+    created.push_back(handle);
+
+    if (entity->hasComponent<ContainerComponent>() && rangeFits(record.firstChild, record.childCount, image.getHeader().childCount))
+    {
+        for (uint32_t i = record.firstChild; i < record.firstChild + record.childCount; ++i)
+        {
+            // children are always written after their parent, which also rules out cycles
+            uint32_t child = image.child(i);
+            if (child > index && child < image.getHeader().entityCount)
+            {
+                EntityHandle childHandle = buildEntity(image, child, dispatcher, entities, created);
+                if (childHandle)
+                    entity->addContainedEntity(childHandle);
             }
         }
-        catch (const std::exception &e)
+    }
+    return handle;
+}
+
+// load a compiled world image produced by zorkc
+// records are read straight out of the mapping, so no text is parsed at all
+void Graph::loadFromBinary(const std::string &filename)
+{
+    WorldImage image(filename);
+    if (!image.isValid())
+    {
+        ZLOG(Error, Loader, "could not load world image " << filename << ": " << image.error());
+        return;
+    }
+
+    const zwb::Header &header = image.getHeader();
+    locations.reserve(locations.size() + header.locationCount);
+
+    // entities in creation order, registered once the whole tree is built
+    std::vector<EntityHandle> created;
+    created.reserve(header.entityCount);
+
+    for (uint32_t i = 0; i < header.locationCount; ++i)
+    {
+        const zwb::LocationRecord &record = image.location(i);
+        auto location = std::make_shared<Location>(record.id, Symbol(image.string(record.name)), Symbol(image.string(record.description)), registry);
+        locations[record.id] = location;
+        registerLocation(location);
+
+        if (!rangeFits(record.firstChild, record.childCount, header.childCount))
+            continue;
+        for (uint32_t c = record.firstChild; c < record.firstChild + record.childCount; ++c)
         {
-            std::cerr << "error processing line: " << trimmedLine << " - " << e.what() << std::endl;
+            if (image.child(c) >= header.entityCount)
+                continue;
+            EntityHandle handle = buildEntity(image, image.child(c), dispatcher, entities, created);
+            if (handle)
+                location->addEntity(handle);
         }
     }
 
-    // process all connections after all locations are loaded
-    for (const auto &[fromID, direction, toID] : pendingConnections)
+    for (EntityHandle handle : created)
+        registerEntity(handle);
+
+    // connections can point forward so they are resolved after every location exists
+    for (uint32_t i = 0; i < header.locationCount; ++i)
     {
-        if (locations.find(fromID) != locations.end() && locations.find(toID) != locations.end())
+        const zwb::LocationRecord &record = image.location(i);
+        if (!rangeFits(record.firstConnection, record.connectionCount, header.connectionCount))
+            continue;
+        auto &from = locations[record.id];
+        for (uint32_t c = record.firstConnection; c < record.firstConnection + record.connectionCount; ++c)
         {
-            locations[fromID]->addConnection(direction, locations[toID]);
-            std::cout << "Added connection from location " << fromID << " to location " 
-                     << toID << " in direction " << direction << std::endl;
+            const zwb::ConnectionRecord &connection = image.connection(c);
+            auto to = locations.find(connection.target);
+            if (to != locations.end())
+                from->addConnection(Symbol(image.string(connection.direction)), to->second);
         }
     }
 
-    std::cout << "finished loading world from file: " << filename << std::endl;
-}
\ No newline at end of file
+    ZLOG(Info, Loader, "finished loading world image: " << filename);
+    logSymbolStats();
+}
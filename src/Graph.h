@@ -3,26 +3,44 @@
 
 #include "Location.h"
 #include "MessageDispatcher.h"
+#include "Registry.h"
+#include "EntityPool.h"
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <vector>
 
 class Graph
 {
 public:
     // constructor passing dispatcher
     Graph(MessageDispatcher &dispatcher) : dispatcher(dispatcher) {}
+    ~Graph();
+
+    // number of threads used to tokenize text worlds (1 = serial, 0 = one per core)
+    void setLoaderThreads(unsigned threads);
 
     // loads graph data from file
     void loadFromFile(const std::string &filename);
 
+    // loads graph data from a compiled .zwb world image (see WorldImage.h)
+    void loadFromBinary(const std::string &filename);
+
     // displays location details
     void displayLocation(int locationID) const;
 
+    Registry registry;                                            // component storage for every entity in the world
+    EntityPool entities{registry};                                // owns every entity in the world
     std::unordered_map<int, std::shared_ptr<Location>> locations; // stores locations by id
+    std::vector<MessageDispatcher::Registration> registrations;   // the locations' handlers, dropped with the graph
 
 private:
+    // hooks a freshly created location or entity up to the dispatcher
+    void registerLocation(const std::shared_ptr<Location> &location);
+    void registerEntity(EntityHandle entity);
+
     MessageDispatcher &dispatcher; // dispatcher reference for message handling
+    unsigned loaderThreads = 1;    // threads used by loadFromFile, 0 = one per core
 };
 
 #endif
@@ -8,6 +8,8 @@
 #include <vector>
 #include <sstream>
 #include "Entity.h"
+#include "Symbol.h"
+#include "EntityList.h"
 
 // util
 inline std::string toLowerCase(const std::string &input)
@@ -22,31 +24,33 @@ class Location
 {
 public:
     // as per design
-    int number;                                                             // location id
-    std::string name;                                                       // location name
-    std::string description;                                                // description of the location
-    std::unordered_map<std::string, std::shared_ptr<Location>> connections; // map of connections by direction
+    int number;                                                        // location id
+    Symbol name;                                                       // location name
+    Symbol description;                                                // description of the location
+    std::unordered_map<Symbol, std::shared_ptr<Location>> connections; // map of connections by direction
+    EntityId id = kNoEntity;                                           // dispatcher id, set when the graph registers it
 
     // init the location with an id, name, and description
-    Location(int num, const std::string &nm, const std::string &desc)
-        : number(num), name(nm), description(desc) {}
+    // the registry resolves the handles of the entities placed here
+    Location(int num, Symbol nm, Symbol desc, const Registry &registry)
+        : number(num), name(nm), description(desc), registry(registry) {}
 
     // method to add a connection in a specific direction
-    void addConnection(const std::string &direction, std::shared_ptr<Location> connectedLocation)
+    void addConnection(Symbol direction, std::shared_ptr<Location> connectedLocation)
     {
         connections[direction] = connectedLocation;
     }
 
     // add an entity to the location
-    void addEntity(std::shared_ptr<Entity> entity)
+    void addEntity(EntityHandle entity)
     {
-        entities.push_back(entity);
+        entities.add(entity, nameOf(entity));
     }
 
     // retrieve all entities in the location
-    const std::vector<std::shared_ptr<Entity>> &getEntities() const
+    const std::vector<EntityHandle> &getEntities() const
     {
-        return entities;
+        return entities.handles();
     }
 
     // generate a visual description of all top-level entities in the location for LOOK
@@ -61,8 +65,11 @@ public:
         // iterate over all entities and append
         // their names to the output stream so that 
         // it can be displayed to the player
-        for (const auto &entity : entities)
+        for (EntityHandle handle : entities.handles())
         {
+            const Entity *entity = registry.resolve(handle);
+            if (!entity)
+                continue;
             if (first)
             {
                 oss << entity->getName();
@@ -77,28 +84,32 @@ public:
         return oss.str();
     }
 
-    // find an entity by name for LOOK AT
-    std::shared_ptr<Entity> findEntityByName(const std::string &name) const
+    // find an entity by name for LOOK AT, case-insensitive
+    // returns a non-owning pointer, nullptr if nothing here has that name
+    Entity *findEntityByName(const std::string &name) const
     {
-        for (const auto &entity : entities)
-        {
-            if (toLowerCase(entity->getName()) == toLowerCase(name))
-                return entity;
-        }
-        return nullptr; 
+        return registry.resolve(entities.find(Symbol::findFolded(name)));
     }
 
-    void removeEntity(std::shared_ptr<Entity> entity)
+    Entity *findEntityByName(Symbol name) const
     {
-        auto it = std::find(entities.begin(), entities.end(), entity);
-        if (it != entities.end())
-        {
-            entities.erase(it);
-        }
+        return registry.resolve(entities.find(name.folded()));
+    }
+
+    void removeEntity(EntityHandle entity)
+    {
+        entities.remove(entity, nameOf(entity));
     }
 
 private:
-    std::vector<std::shared_ptr<Entity>> entities; // collection of entities within the location
+    Symbol nameOf(EntityHandle entity) const
+    {
+        const Entity *resolved = registry.resolve(entity);
+        return resolved ? resolved->getNameSymbol() : Symbol();
+    }
+
+    EntityList entities;                // entities within the location, indexed by name
+    const Registry &registry;           // resolves entity handles
 };
 
 #endif
@@ -0,0 +1,90 @@
+#include "Log.h"
+#include <iostream>
+#include <mutex>
+
+// warnings and errors only unless asked for more
+LogLevel Log::levels[static_cast<int>(LogCategory::Count)] = {
+    LogLevel::Warn, LogLevel::Warn, LogLevel::Warn, LogLevel::Warn, LogLevel::Warn};
+
+namespace
+{
+    std::ostream *output = &std::clog;
+    std::mutex outputMutex; // the parallel loader may log from several threads
+
+    const char *const levelNames[] = {"trace", "debug", "info", "warn", "error", "off"};
+    const char *const categoryNames[] = {"general", "loader", "dispatch", "entity", "command"};
+
+    bool parseLevel(const std::string &name, LogLevel &level)
+    {
+        for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i)
+        {
+            if (name == levelNames[i])
+            {
+                level = static_cast<LogLevel>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void Log::setLevel(LogCategory category, LogLevel level)
+{
+    levels[static_cast<int>(category)] = level;
+}
+
+void Log::setLevel(LogLevel level)
+{
+    for (auto &categoryLevel : levels)
+        categoryLevel = level;
+}
+
+bool Log::configure(const std::string &setting)
+{
+    LogLevel level;
+    size_t equals = setting.find('=');
+    if (equals == std::string::npos)
+    {
+        if (!parseLevel(setting, level))
+            return false;
+        setLevel(level);
+        return true;
+    }
+
+    std::string category = setting.substr(0, equals);
+    if (!parseLevel(setting.substr(equals + 1), level))
+        return false;
+    for (int i = 0; i < static_cast<int>(LogCategory::Count); ++i)
+    {
+        if (category == categoryNames[i])
+        {
+            setLevel(static_cast<LogCategory>(i), level);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Log::setOutput(std::ostream &stream)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    output = &stream;
+}
+
+// each thread reuses one stream rather than constructing one per line
+Log::Line::Line(LogLevel level, LogCategory category) : buffer([]() -> std::ostringstream & {
+      thread_local std::ostringstream lineBuffer;
+      return lineBuffer;
+  }())
+{
+    buffer.str(std::string());
+    buffer.clear();
+    buffer << "[" << levelNames[static_cast<int>(level)] << "][" << categoryNames[static_cast<int>(category)] << "] ";
+}
+
+Log::Line::~Line()
+{
+    buffer << '\n';
+    std::lock_guard<std::mutex> lock(outputMutex);
+    *output << buffer.str();
+}
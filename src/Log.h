@@ -0,0 +1,90 @@
+#pragma once
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// diagnostic logging, kept separate from the player facing game text
+//
+// levels below ZORK_LOG_LEVEL are compiled out entirely: the ZLOG arguments
+// are never evaluated and no code is emitted for them. anything compiled in
+// is filtered again at runtime per category (see Log::setLevel).
+//
+// build with -DZORK_LOG_LEVEL=0 to keep trace output, or 5 to strip all logging
+#ifndef ZORK_LOG_LEVEL
+#define ZORK_LOG_LEVEL 1 // debug and above
+#endif
+
+enum class LogLevel
+{
+    Trace = 0, // per message / per receive
+    Debug = 1, // per input line, per command
+    Info = 2,  // start-up milestones
+    Warn = 3,
+    Error = 4,
+    Off = 5
+};
+
+enum class LogCategory
+{
+    General,
+    Loader,   // world loading
+    Dispatch, // message dispatcher
+    Entity,   // entity send/receive
+    Command,  // command parsing and execution
+    Count
+};
+
+class Log
+{
+public:
+    // true if a level survives the build time threshold
+    static constexpr bool compiledIn(LogLevel level)
+    {
+        return static_cast<int>(level) >= ZORK_LOG_LEVEL;
+    }
+
+    // runtime check, cheap enough to call before formatting anything
+    static bool enabled(LogLevel level, LogCategory category)
+    {
+        return static_cast<int>(level) >= static_cast<int>(levels[static_cast<int>(category)]);
+    }
+
+    // sets the runtime threshold for one category or for all of them
+    static void setLevel(LogCategory category, LogLevel level);
+    static void setLevel(LogLevel level);
+
+    // applies a setting like "debug" or "loader=trace", returns false if it isn't understood
+    static bool configure(const std::string &setting);
+
+    // redirects log output (defaults to std::clog), the stream must outlive all logging
+    static void setOutput(std::ostream &stream);
+
+    // collects one log line and writes it out in a single call when destroyed
+    class Line
+    {
+    public:
+        Line(LogLevel level, LogCategory category);
+        ~Line();
+        std::ostream &stream() { return buffer; }
+
+    private:
+        std::ostringstream &buffer;
+    };
+
+private:
+    static LogLevel levels[static_cast<int>(LogCategory::Count)];
+};
+
+// ZLOG(Debug, Loader, "creating location " << id);
+#define ZLOG(level, category, expr)                                                \
+    do                                                                             \
+    {                                                                              \
+        if constexpr (Log::compiledIn(LogLevel::level))                            \
+        {                                                                          \
+            if (Log::enabled(LogLevel::level, LogCategory::category))              \
+            {                                                                      \
+                Log::Line zlogLine(LogLevel::level, LogCategory::category);        \
+                zlogLine.stream() << expr;                                         \
+            }                                                                      \
+        }                                                                          \
+    } while (0)
@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+// maps the file via CreateFileMapping/MapViewOfFile
+MappedFile::MappedFile(const std::string &filename)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    fileHandle = file;
+    opened = true;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        return; // empty files can't be mapped, leave the view empty
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        opened = false;
+        return;
+    }
+    mappingHandle = mapping;
+
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data)
+    {
+        opened = false;
+        return;
+    }
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+}
+
+// unlocking pages that were never locked takes them out of the working set
+void MappedFile::release(std::string_view part) const
+{
+    if (!part.empty())
+        VirtualUnlock(const_cast<char *>(part.data()), part.size());
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+}
+
+#else
+
+// maps the file via mmap
+MappedFile::MappedFile(const std::string &filename)
+{
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    opened = true;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        opened = false;
+        return;
+    }
+    if (st.st_size == 0)
+        return; // empty files can't be mapped, leave the view empty
+
+    void *mapped = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        opened = false;
+        return;
+    }
+    // the loader walks the file front to back exactly once
+    ::madvise(mapped, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(mapped);
+    size = static_cast<std::size_t>(st.st_size);
+}
+
+// only whole pages inside the part go, a page shared with what comes next stays
+void MappedFile::release(std::string_view part) const
+{
+    uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(part.data()) + page - 1) & ~(page - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(part.data()) + part.size()) & ~(page - 1);
+    if (last > first)
+        ::madvise(reinterpret_cast<void *>(first), last - first, MADV_DONTNEED);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        ::munmap(const_cast<char *>(data), size);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// read-only memory mapping of a whole file
+// the contents are exposed as a string_view so callers can tokenize in place
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &filename);
+    ~MappedFile();
+
+    // a mapping owns os handles so it can't be copied
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // true if the file was opened (an empty file is open but has no data)
+    bool isOpen() const { return opened; }
+
+    // view over the mapped bytes, valid for the lifetime of this object
+    std::string_view view() const { return std::string_view(data, size); }
+
+    // drops the pages of a part of view() that has been read from memory, so a
+    // long file read front to back doesn't stay resident behind the reader;
+    // reading the part again faults it back in from the file
+    void release(std::string_view part) const;
+
+private:
+    bool opened = false;
+    const char *data = nullptr; // start of the mapped bytes
+    std::size_t size = 0;       // length of the mapping
+#ifdef _WIN32
+    void *fileHandle = nullptr;    // HANDLE from CreateFile
+    void *mappingHandle = nullptr; // HANDLE from CreateFileMapping
+#else
+    int fd = -1; // posix file descriptor
+#endif
+};
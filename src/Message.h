@@ -1,11 +1,62 @@
 #pragma once
-#include <string>
-#include <any>
+#include "EntityHandle.h"
+#include "Opcode.h"
+#include "Symbol.h"
+#include <cstdint>
+#include <type_traits>
+
+// recipients are addressed by a 64-bit id handed out by the dispatcher
+// the low half is a slot in its table and the high half that slot's generation, which moves
+// on when the slot is freed, so a stale id never reaches the slot's next owner;
+// slot 0 is never handed out, so 0 always means "nobody" (a standalone MessageBus
+// simply counts up from 1)
+using EntityId = std::uint64_t;
+constexpr EntityId kNoEntity = 0;
+
+// the optional value carried by a message
+// a tagged union of the few types messages actually carry, all 32 bits wide,
+// so a payload is copied as two words and never allocates
+class Payload
+{
+public:
+    enum class Kind : uint8_t
+    {
+        None,
+        Int,    // heal / damage amounts
+        Entity, // the item being moved
+        Symbol  // a name, e.g. the item to take or the key used
+    };
+
+    constexpr Payload() : number(0) {}
+    constexpr Payload(int value) : kind(Kind::Int), number(value) {}
+    constexpr Payload(EntityHandle value) : kind(Kind::Entity), entity(value) {}
+    constexpr Payload(Symbol value) : kind(Kind::Symbol), symbol(value) {}
+
+    constexpr Kind getKind() const { return kind; }
+
+    // the value if the payload holds that type, otherwise 0 / a null handle / the empty symbol
+    // a mismatch is a sender bug, but receivers stay well defined instead of throwing
+    constexpr int asInt() const { return kind == Kind::Int ? number : 0; }
+    constexpr EntityHandle asEntity() const { return kind == Kind::Entity ? entity : EntityHandle(); }
+    constexpr Symbol asSymbol() const { return kind == Kind::Symbol ? symbol : Symbol(); }
+
+private:
+    Kind kind = Kind::None;
+    union
+    {
+        int number;
+        EntityHandle entity;
+        Symbol symbol;
+    };
+};
 
 // represents a single message in the messaging system
 struct Message {
-    std::string from;  // sender's unique id
-    std::string to;    // recipient's unique id
-    std::string message; // action or type of message
-    std::any data;     // optional payload for additional information
+    EntityId from;       // sender's unique id
+    EntityId to;         // recipient's unique id
+    Opcode opcode;       // action or type of message
+    Payload data;        // optional payload for additional information
 };
+
+// messages are passed and queued by value, keep them plain data
+static_assert(std::is_trivially_copyable_v<Message>, "Message must stay trivially copyable");
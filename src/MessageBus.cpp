@@ -0,0 +1,182 @@
+#include "MessageBus.h"
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+
+// the shard a thread consumes, so send() can tell when it would wait on itself
+static thread_local const MessageBus *ownerBus = nullptr;
+static thread_local unsigned ownerShard = 0;
+
+MessageBus::MessageBus(unsigned shardCount, size_t queueCapacity)
+{
+    if (shardCount == 0)
+        shardCount = std::max(1u, std::thread::hardware_concurrency());
+    shards.reserve(shardCount);
+    for (unsigned i = 0; i < shardCount; ++i)
+        shards.push_back(std::make_unique<Shard>(queueCapacity));
+}
+
+MessageBus::~MessageBus()
+{
+    stop();
+    for (auto &chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+// appends to the table and publishes the new id once its handler is in place
+EntityId MessageBus::registerRecipient(MessageHandler handler)
+{
+    std::lock_guard<std::mutex> lock(registration);
+    EntityId id = published.load(std::memory_order_relaxed);
+    size_t chunk = id >> kChunkBits;
+    if (chunk >= kMaxChunks)
+    {
+        ZLOG(Error, Dispatch, "message bus is full, recipient not registered");
+        return kNoEntity;
+    }
+
+    MessageHandler *slots = chunks[chunk].load(std::memory_order_relaxed);
+    if (!slots)
+    {
+        slots = new MessageHandler[kChunkSize];
+        chunks[chunk].store(slots, std::memory_order_release);
+    }
+    slots[id & (kChunkSize - 1)] = std::move(handler);
+    published.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+// lock free: ids below the published count have a handler that will never move
+const MessageBus::MessageHandler *MessageBus::find(EntityId id) const
+{
+    if (id == kNoEntity || id >= published.load(std::memory_order_acquire))
+        return nullptr;
+    const MessageHandler *slots = chunks[id >> kChunkBits].load(std::memory_order_acquire);
+    return &slots[id & (kChunkSize - 1)];
+}
+
+bool MessageBus::trySend(const Message &message)
+{
+    return !isClosed() && shards[shardOf(message.to)]->queue.push(message);
+}
+
+bool MessageBus::send(const Message &message)
+{
+    if (isClosed())
+        return false;
+    unsigned shard = shardOf(message.to);
+    if (shards[shard]->queue.push(message))
+        return true;
+
+    if (ownerBus == this && ownerShard == shard)
+    {
+        ZLOG(Warn, Dispatch, "shard " << shard << " is full and the sender is its consumer, dropping '"
+                                      << opcodeName(message.opcode) << "' to " << message.to);
+        return false;
+    }
+    // stop() drains on its own thread once the consumers are gone, and not again
+    // after, so a sender still waiting then would wait forever
+    while (!shards[shard]->queue.push(message))
+    {
+        if (isClosed())
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+bool MessageBus::receive(unsigned shard, Message &message)
+{
+    return shards[shard]->queue.pop(message);
+}
+
+size_t MessageBus::drain(unsigned shard, size_t max)
+{
+    Shard &owned = *shards[shard];
+    size_t count = 0;
+    Message message;
+    while (count < max && owned.queue.pop(message))
+    {
+        if (const MessageHandler *handler = find(message.to))
+        {
+            uint64_t started = owned.stats.startTimer();
+            (*handler)(message);
+            owned.stats.delivered(message.opcode, 0);
+            if (started != 0)
+                owned.stats.timed(message.opcode, message.to, Symbol(), started);
+            owned.delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            DispatchStats::undeliverable();
+            owned.undeliverable.fetch_add(1, std::memory_order_relaxed);
+        }
+        ++count;
+    }
+    owned.stats.flush();
+    return count;
+}
+
+// a shard's consumer: drain in batches, back off while idle
+void MessageBus::consume(unsigned shard)
+{
+    ownerBus = this;
+    ownerShard = shard;
+    unsigned idle = 0;
+    while (running.load(std::memory_order_acquire))
+    {
+        if (drain(shard, 256) != 0)
+        {
+            idle = 0;
+        }
+        else if (++idle < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    ownerBus = nullptr;
+}
+
+void MessageBus::start()
+{
+    if (running.exchange(true))
+        return;
+    open();
+    for (unsigned i = 0; i < shards.size(); ++i)
+        shards[i]->consumer = std::thread(&MessageBus::consume, this, i);
+}
+
+void MessageBus::stop()
+{
+    close();
+    if (!running.exchange(false))
+        return;
+    for (auto &shard : shards)
+    {
+        if (shard->consumer.joinable())
+            shard->consumer.join();
+    }
+    // the consumers are gone, this thread owns every shard now
+    for (unsigned i = 0; i < shards.size(); ++i)
+        drain(i);
+}
+
+uint64_t MessageBus::delivered() const
+{
+    uint64_t total = 0;
+    for (const auto &shard : shards)
+        total += shard->delivered.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t MessageBus::undeliverable() const
+{
+    uint64_t total = 0;
+    for (const auto &shard : shards)
+        total += shard->undeliverable.load(std::memory_order_relaxed);
+    return total;
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "DispatchStats.h"
+#include "Message.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// bounded lock-free queue, many producers, one consumer
+// each cell carries a sequence number saying whose turn it is: producers claim a
+// cell with one CAS on the tail, the consumer owns the head outright. push
+// fails instead of blocking when the queue is full.
+template <typename T>
+class MpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // any thread
+    bool push(const T &value)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // the consumer hasn't freed this cell yet: full
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed); // another producer took it
+            }
+        }
+    }
+
+    // the owning consumer only
+    bool pop(T &value)
+    {
+        Cell &cell = cells[head & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(sequence - (head + 1)) < 0)
+            return false; // empty, or a producer is still writing the cell
+        value = cell.value;
+        cell.sequence.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> tail{0}; // producers
+    alignas(64) size_t head = 0;             // consumer
+};
+
+// a dispatcher backend for sending from many threads
+// recipients are spread over shards by id; each shard has an MpscQueue and is
+// drained by exactly one consumer thread, so a recipient's handler never runs
+// on two threads at once and sees its messages in the order they were queued.
+//
+// the recipient table is append-only and read without locks: a new handler is
+// written into a chunk that never moves, then published by bumping the
+// recipient count with a release store. readers acquire the count and index
+// straight in. registering takes a mutex, but only against other registrations.
+//
+// it is used two ways:
+// - on its own, start() gives every shard a consumer thread that runs the
+//   handlers registered here
+// - as MessageDispatcher's Bus mode, where nothing is started or registered here:
+//   the dispatcher's thread owns every shard and pops them itself with receive(),
+//   so handlers keep running on the one thread the game state belongs to
+//
+// threads: send, trySend and registerRecipient are safe from any thread. a
+// shard has one owner, its consumer thread once started, and only the owner may
+// drain or receive from it. handlers run on consumer threads, so they must not
+// touch anything that isn't thread safe: the SymbolTable (interning or finding
+// a name), a MessageDispatcher or a Game belong to the thread that made them.
+// once close() or stop() has begun every send fails, senders must be finished
+// before the bus is destroyed.
+class MessageBus
+{
+public:
+    using MessageHandler = std::function<void(const Message &)>;
+
+    // shardCount 0 = one per core
+    explicit MessageBus(unsigned shardCount = 0, size_t queueCapacity = 4096);
+    ~MessageBus();
+
+    MessageBus(const MessageBus &) = delete;
+    MessageBus &operator=(const MessageBus &) = delete;
+
+    // any thread; the handler runs on the recipient's shard thread
+    EntityId registerRecipient(MessageHandler handler);
+
+    // any thread; false if the recipient's queue is full or the bus is closed
+    bool trySend(const Message &message);
+
+    // any thread; waits for room, but gives up (returns false) if called from the
+    // recipient's own shard, which would otherwise wait on itself, or once the bus
+    // closes, since nobody may be left to make room
+    bool send(const Message &message);
+
+    // delivers up to max queued messages of one shard, returns how many
+    // only the shard's owner may call this: its thread after start(), anyone before
+    size_t drain(unsigned shard, size_t max = SIZE_MAX);
+
+    // takes the oldest message of a shard without delivering it, false if there is none
+    // for an owner that delivers through its own table; same rules as drain
+    bool receive(unsigned shard, Message &message);
+
+    // one consumer thread per shard; stop() closes the bus, joins them and
+    // delivers what's left on the calling thread
+    void start();
+    void stop();
+
+    // makes every send fail from now on, so nothing waits on shards nobody drains
+    // what is already queued stays there; open() takes messages again
+    void close() { closed.store(true, std::memory_order_release); }
+    void open() { closed.store(false, std::memory_order_release); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+    unsigned shardCount() const { return static_cast<unsigned>(shards.size()); }
+    unsigned shardOf(EntityId id) const { return static_cast<unsigned>(id % shards.size()); }
+
+    uint64_t delivered() const;     // messages handed to a handler
+    uint64_t undeliverable() const; // messages for ids nobody registered
+
+private:
+    static constexpr size_t kChunkBits = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    static constexpr size_t kMaxChunks = 4096; // 16M recipients
+
+    struct alignas(64) Shard
+    {
+        explicit Shard(size_t capacity) : queue(capacity) {}
+        MpscQueue<Message> queue;
+        std::thread consumer;
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> undeliverable{0};
+        DispatchStats::Batch stats; // the owner's, flushed at the end of each drain
+    };
+
+    const MessageHandler *find(EntityId id) const;
+    void consume(unsigned shard);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::array<std::atomic<MessageHandler *>, kMaxChunks> chunks{};
+    std::atomic<EntityId> published{1}; // ids below this are readable, 0 is kNoEntity
+    std::mutex registration;             // writers only
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> closed{false};
+};
@@ -1,25 +1,379 @@
 #include "MessageDispatcher.h"
-#include <iostream> 
+#include "MessageBus.h"
+#include "Log.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
 
-// registers a recipient with a unique id and its message handler
-bool MessageDispatcher::registerRecipient(const std::string& id, MessageHandler handler) {
-    if (recipients.find(id) != recipients.end()) {
-        // err
-        std::cerr << "Recipient with ID '" << id << "' is already registered.\n";
+// delivering counts the handlers on the stack; when the outermost one returns or
+// throws, what was unregistered under it is released
+struct MessageDispatcher::DeliveryScope {
+    explicit DeliveryScope(MessageDispatcher& dispatcher) : dispatcher(dispatcher) { ++dispatcher.delivering; }
+    ~DeliveryScope() {
+        if (--dispatcher.delivering == 0 && !dispatcher.pendingRelease.empty()) {
+            for (uint32_t slot : dispatcher.pendingRelease)
+                dispatcher.release(slot);
+            dispatcher.pendingRelease.clear();
+        }
+    }
+    MessageDispatcher& dispatcher;
+};
+
+// a handler that throws out of a drain leaves the rest of the queue for the next one
+// what the drain delivered is counted either way
+struct MessageDispatcher::DrainScope {
+    explicit DrainScope(MessageDispatcher& dispatcher) : dispatcher(dispatcher) { dispatcher.draining = true; }
+    ~DrainScope() {
+        dispatcher.draining = false;
+        dispatcher.currentDepth = 0;
+        dispatcher.stats.flush();
+    }
+    MessageDispatcher& dispatcher;
+};
+
+MessageDispatcher::MessageDispatcher() {
+    handlerChunks.push_back(std::make_unique<MessageHandler[]>(kHandlerChunkSize));
+}
+
+// other threads must have stopped posting by now, see postFromAnyThread
+MessageDispatcher::~MessageDispatcher() = default;
+
+void MessageDispatcher::throwNotOwner() {
+    throw std::logic_error("the message dispatcher is only used from the thread that owns it");
+}
+
+// the bus is kept once made, closed while in another mode, so a thread still
+// posting gets false instead of a dangling bus
+void MessageDispatcher::setMode(Mode newMode) {
+    checkOwner();
+    if (newMode == Mode::Bus) {
+        if (!bus)
+            bus = std::make_unique<MessageBus>(0, kBusQueueCapacity);
+        bus->open();
+        owner = std::this_thread::get_id();
+    } else if (bus && mode == Mode::Bus) {
+        bus->close();
+        takeFromBus(); // what was posted before closing still arrives
+        owner = std::thread::id();
+    }
+    mode = newMode;
+}
+
+// registers a recipient in the lowest free slot, or a new one at the end
+// the low half of an id is the table index, so there is nothing to probe
+EntityId MessageDispatcher::registerRecipient(MessageHandler handler) {
+    checkOwner();
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(recipients.size());
+        recipients.emplace_back();
+        recipients.back().generation = retiredGeneration;
+        if ((slot >> kHandlerChunkBits) == handlerChunks.size())
+            handlerChunks.push_back(std::make_unique<MessageHandler[]>(kHandlerChunkSize));
+    }
+    handlerOf(slot) = std::move(handler);
+    return (static_cast<EntityId>(recipients[slot].generation) << 32) | slot;
+}
+
+// registers a recipient and indexes it by name for command lookups
+EntityId MessageDispatcher::registerRecipient(Symbol name, MessageHandler handler) {
+    if (names.find(name) != names.end()) {
+        ZLOG(Warn, Dispatch, "recipient with name '" << name.str() << "' is already registered");
+        return kNoEntity;
+    }
+    EntityId id = registerRecipient(std::move(handler));
+    names.emplace(name, id);
+    recipients[slotOf(id)].name = name;
+    return id;
+}
+
+bool MessageDispatcher::isRegistered(EntityId id) const {
+    uint32_t slot = slotOf(id);
+    return slot != 0 && slot < recipients.size() && recipients[slot].generation == generationOf(id)
+        && handlerOf(slot);
+}
+
+// the id goes stale straight away; the handler itself is released once no handler is running,
+// so a recipient can unregister from inside its own handler
+bool MessageDispatcher::unregisterRecipient(EntityId id) {
+    checkOwner();
+    if (!isRegistered(id))
+        return false;
+    uint32_t slot = slotOf(id);
+    Recipient& recipient = recipients[slot];
+    ++recipient.generation;
+    ++unregistrations;
+    if (!recipient.name.empty()) {
+        names.erase(recipient.name);
+        recipient.name = Symbol();
+    }
+    if (delivering != 0)
+        pendingRelease.push_back(slot);
+    else
+        release(slot);
+    return true;
+}
+
+void MessageDispatcher::release(uint32_t slot) {
+    handlerOf(slot) = nullptr; // drops whatever the handler captured
+    freeSlots.push_back(slot);
+    if (freeSlots.size() >= compactAt && freeSlots.size() * 2 > recipients.size())
+        compact();
+}
+
+// trims free slots off the end (their generations live on in retiredGeneration) and
+// rebuilds the free list lowest first, so reuse stays dense and deterministic
+// the next compaction waits for the free list to double, which keeps the cost amortized
+void MessageDispatcher::compact() {
+    while (recipients.size() > 1 && !handlerOf(static_cast<uint32_t>(recipients.size() - 1))) {
+        retiredGeneration = std::max(retiredGeneration, recipients.back().generation);
+        recipients.pop_back();
+    }
+    if (recipients.capacity() > 2 * recipients.size())
+        recipients.shrink_to_fit();
+    // no handler runs during a compaction, so chunks past the end can go
+    handlerChunks.resize(((recipients.size() - 1) >> kHandlerChunkBits) + 1);
+
+    freeSlots.clear();
+    for (size_t slot = recipients.size() - 1; slot > 0; --slot) {
+        if (!handlerOf(static_cast<uint32_t>(slot)))
+            freeSlots.push_back(static_cast<uint32_t>(slot));
+    }
+    freeSlots.shrink_to_fit();
+    compactAt = std::max(kCompactThreshold, freeSlots.size() * 2);
+    ZLOG(Debug, Dispatch, "compacted recipient table to " << recipients.size() << " slots, " << freeSlots.size() << " free");
+}
+
+// gives an existing recipient a name
+bool MessageDispatcher::addName(Symbol name, EntityId id) {
+    if (!isRegistered(id) || !recipients[slotOf(id)].name.empty())
+        return false;
+    // duplicates are expected, several entities may share a display name
+    if (!names.emplace(name, id).second) {
+        ZLOG(Debug, Dispatch, "name '" << name.str() << "' is already taken, recipient " << id << " stays unnamed");
         return false;
     }
-    recipients[id] = handler;
+    recipients[slotOf(id)].name = name;
     return true;
 }
 
-// sends a message directly to the recipient
+// id registered under a name, or kNoEntity
+EntityId MessageDispatcher::lookup(Symbol name) const {
+    auto it = names.find(name);
+    return it != names.end() ? it->second : kNoEntity;
+}
+
+// sends a message to the recipient, now or on the next drain depending on the mode
 void MessageDispatcher::sendMessage(const Message& message) {
-    std::cout << "Sending message from '" << message.from << "' to '" << message.to << "' with message: '" << message.message << "'\n";
-    auto it = recipients.find(message.to);
-    if (it != recipients.end()) {
-        it->second(message); // call the recipient's handler
+    checkOwner();
+    if (tap)
+        tap(message);
+    if (mode != Mode::Direct) {
+        post(message);
+        return;
+    }
+    deliver(message);
+}
+
+// queues a message whatever the mode
+void MessageDispatcher::post(const Message& message) {
+    checkOwner();
+    unsigned depth = draining ? currentDepth + 1 : 0;
+    if (depth > maxDepth) {
+        ZLOG(Warn, Dispatch, "dropping '" << opcodeName(message.opcode) << "' to " << message.to << ", sent " << depth << " handlers deep");
+        DispatchStats::dropped();
+        return;
+    }
+
+    reserve(1);
+    enqueue(message, depth);
+}
+
+// the owner's own messages keep to the ring, only other threads go through the bus
+bool MessageDispatcher::postFromAnyThread(const Message& message) {
+    if (!bus || bus->isClosed())
+        return false;
+    if (std::this_thread::get_id() == owner) {
+        post(message);
+        return true;
+    }
+    return bus->send(message);
+}
+
+// shards are taken in turn, each one oldest first, so a sender's messages to
+// one recipient arrive in the order it posted them. a pass takes at most a
+// queue's worth from each shard, so busy senders can't keep a drain going forever
+bool MessageDispatcher::takeFromBus() {
+    bool took = false;
+    Message message;
+    for (unsigned shard = 0; shard < bus->shardCount(); ++shard) {
+        for (size_t taken = 0; taken < kBusQueueCapacity && bus->receive(shard, message); ++taken) {
+            if (tap)
+                tap(message);
+            reserve(1);
+            enqueue(message, 0);
+            took = true;
+        }
+    }
+    return took;
+}
+
+// grows the ring until it can take extra more messages
+void MessageDispatcher::reserve(size_t extra) {
+    if (queued + extra <= ring.size())
+        return;
+    size_t size = ring.empty() ? 64 : ring.size();
+    while (size < queued + extra)
+        size *= 2;
+    // unroll into the bigger buffer, oldest first
+    std::vector<QueuedMessage> grown(size);
+    for (size_t i = 0; i < queued; ++i)
+        grown[i] = ring[(head + i) & (ring.size() - 1)];
+    ring.swap(grown);
+    head = 0;
+}
+
+void MessageDispatcher::enqueue(const Message& message, unsigned depth) {
+    ring[(head + queued) & (ring.size() - 1)] = {message, depth};
+    ++queued;
+}
+
+// a full array is pruned before it grows, so unregistered subscribers can't pile up
+void MessageDispatcher::subscribe(Topic topic, EntityId id) {
+    checkOwner();
+    if (!isRegistered(id))
+        return; // prune only looks for recipients that left after they joined
+    Subscribers& subscribers = topics[topic.key()];
+    if (subscribers.members.size() == subscribers.members.capacity())
+        prune(subscribers);
+    subscribers.members.push_back(id);
+}
+
+// a pass over every member, so it is skipped unless someone unregistered since the last one
+void MessageDispatcher::prune(Subscribers& topic) const {
+    if (topic.prunedAt == unregistrations)
+        return;
+    std::vector<EntityId>& members = topic.members;
+    members.erase(std::remove_if(members.begin(), members.end(),
+                                 [this](EntityId id) { return !isRegistered(id); }),
+                  members.end());
+    topic.prunedAt = unregistrations;
+}
+
+bool MessageDispatcher::unsubscribe(Topic topic, EntityId id) {
+    auto it = topics.find(topic.key());
+    if (it == topics.end())
+        return false;
+    std::vector<EntityId>& members = it->second.members;
+    auto member = std::find(members.begin(), members.end(), id);
+    if (member == members.end())
+        return false;
+    members.erase(member); // keeps delivery in subscription order
+    if (members.empty())
+        topics.erase(it);
+    return true;
+}
+
+const std::vector<EntityId>& MessageDispatcher::subscribers(Topic topic) const {
+    static const std::vector<EntityId> none;
+    auto it = topics.find(topic.key());
+    return it != topics.end() ? it->second.members : none;
+}
+
+// one batch: room for every subscriber is made once, then they are queued back to back
+size_t MessageDispatcher::publish(Topic topic, EntityId from, Opcode opcode, Payload data) {
+    checkOwner();
+    auto it = topics.find(topic.key());
+    if (it == topics.end())
+        return 0;
+    prune(it->second);
+    std::vector<EntityId>& members = it->second.members;
+
+    unsigned depth = draining ? currentDepth + 1 : 0;
+    if (depth > maxDepth) {
+        ZLOG(Warn, Dispatch, "dropping '" << opcodeName(opcode) << "' broadcast, sent " << depth << " handlers deep");
+        DispatchStats::dropped(members.size());
+        return 0;
+    }
+    ZLOG(Trace, Dispatch, "publishing '" << opcodeName(opcode) << "' from " << from << " to " << members.size() << " subscribers");
+
+    size_t count = members.size();
+    reserve(count);
+    for (EntityId id : members) {
+        Message message{from, id, opcode, data};
+        if (tap)
+            tap(message);
+        enqueue(message, depth);
+    }
+
+    if (mode == Mode::Direct)
+        drain();
+    return count;
+}
+
+// delivers queued messages oldest first
+// anything a handler sends is appended behind what is already queued, so the
+// order only depends on the order messages were sent in
+size_t MessageDispatcher::drain() {
+    checkOwner();
+    if (draining)
+        return 0; // a handler asked; the outer drain will get to everything
+    DrainScope scope(*this);
+    size_t delivered = 0;
+    // in Bus mode, what other threads posted comes once the owner's own are done,
+    // one pass over the bus per drain
+    bool busTaken = mode != Mode::Bus;
+    while (queued != 0 || !busTaken) {
+        if (queued == 0) {
+            busTaken = true;
+            if (!takeFromBus())
+                break;
+        }
+        QueuedMessage next = ring[head];
+        head = (head + 1) & (ring.size() - 1);
+        --queued;
+        currentDepth = next.depth;
+        deliver(next.message);
+        ++delivered;
+    }
+    return delivered;
+}
+
+// calls the recipient's handler
+void MessageDispatcher::deliver(const Message& message) {
+    ZLOG(Trace, Dispatch, "sending message from " << message.from << " to " << message.to << " with message: '" << opcodeName(message.opcode) << "'");
+    if (isRegistered(message.to)) {
+        // queued messages carry their depth, direct ones are as deep as the handlers already running
+        unsigned depth = draining ? currentDepth : delivering;
+        uint32_t slot = slotOf(message.to);
+        // by reference: the handler's chunk doesn't move when it registers recipients, and
+        // a slot it unregisters waits for the handlers to finish, see unregisterRecipient
+        const MessageHandler& handler = handlerOf(slot);
+        DeliveryScope scope(*this);
+        uint64_t started = stats.startTimer();
+        // the name is read before the handler runs, which may unregister it
+        Symbol name = started != 0 ? recipients[slot].name : Symbol();
+        handler(message);
+        stats.delivered(message.opcode, depth);
+        if (started != 0)
+            stats.timed(message.opcode, message.to, name, started);
     } else {
         // err
-        std::cerr << "No recipient found for ID '" << message.to << "'.\n";
+        ZLOG(Warn, Dispatch, "no recipient found for id " << message.to);
+        DispatchStats::undeliverable();
+    }
+}
+
+// handlers always have somewhere to write; outside a game text goes straight to stdout
+OutputBuffer& MessageDispatcher::output() {
+    if (!outputBuffer) {
+        static StreamSink console(std::cout);
+        static OutputBuffer fallback(console);
+        fallback.flush();
+        return fallback;
     }
+    return *outputBuffer;
 }
@@ -1,19 +1,258 @@
 #pragma once
+#include "DispatchStats.h"
 #include "Message.h"
+#include "Symbol.h"
+#include "Topic.h"
+#include "OutputSink.h"
 #include <unordered_map>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class MessageBus;
 
 // central hub for sending and receiving messages
+// single threaded: everything below belongs to the thread that runs the game. that
+// is only checked in Bus mode, where a call from any other thread throws
+// std::logic_error; in Direct and Queued mode a second thread isn't stopped, just
+// not allowed. the one exception is postFromAnyThread, the way in for other threads.
+// Bus mode starts no consumer threads: what other threads post waits on the bus
+// until the owner drains, and every handler runs on the owner's thread
 class MessageDispatcher {
 public:
     using MessageHandler = std::function<void(const Message&)>;
 
-    // registers a recipient with a unique id and its message handler
-    bool registerRecipient(const std::string& id, MessageHandler handler);
+    // how sendMessage delivers
+    // Direct runs the handler before sendMessage returns, so a handler that sends
+    // runs the next handler inside itself. Queued appends to a ring buffer that
+    // the game drains at fixed points, so every handler runs to completion first.
+    // Bus is Queued plus a MessageBus other threads can post into; the dispatcher's
+    // thread takes their messages off the bus when it drains, after its own
+    enum class Mode { Direct, Queued, Bus };
+
+    // messages sent by a handler are one level deeper than the message it handles;
+    // past this depth they are dropped, so two handlers can't ping-pong forever
+    static constexpr unsigned kDefaultMaxDepth = 8;
+
+    MessageDispatcher();
+    ~MessageDispatcher();
+    MessageDispatcher(const MessageDispatcher&) = delete;
+    MessageDispatcher& operator=(const MessageDispatcher&) = delete;
+
+    class Registration;
+
+    // registers a recipient and returns its id
+    // an id is a slot in the recipient table plus the slot's generation: slots are
+    // recycled once their recipient unregisters, the generation makes sure the old
+    // id never reaches the new recipient
+    EntityId registerRecipient(MessageHandler handler);
+
+    // registers a recipient and indexes it by name for command lookups
+    // returns kNoEntity (and registers nothing) if the name is already taken
+    EntityId registerRecipient(Symbol name, MessageHandler handler);
 
-    // sends a message directly to the recipient
+    // removes a recipient and its name; false if the id is stale
+    // messages already queued for it are dropped when they come up. safe from
+    // inside a handler, even the recipient's own: the handler is released once
+    // the delivery in progress returns
+    bool unregisterRecipient(EntityId id);
+    bool isRegistered(EntityId id) const;
+    size_t recipientCount() const { return recipients.size() - 1 - freeSlots.size() - pendingRelease.size(); }
+
+    // gives an existing recipient a name, the first recipient to claim a name keeps it
+    // a recipient has at most one name, it goes away when the recipient does
+    bool addName(Symbol name, EntityId id);
+
+    // id registered under a name, or kNoEntity
+    EntityId lookup(Symbol name) const;
+    EntityId lookup(std::string_view name) const { return lookup(Symbol::find(name)); }
+
+    // sends a message to the recipient, now or on the next drain depending on the mode
     void sendMessage(const Message& message);
 
+    // queues a message whatever the mode
+    void post(const Message& message);
+
+    // any thread, Bus mode only: queues a message for the next drain on the
+    // dispatcher's thread. waits while the bus is full; false if the dispatcher
+    // isn't in Bus mode or is leaving it. other threads must be done posting
+    // before the dispatcher leaves Bus mode or is destroyed
+    bool postFromAnyThread(const Message& message);
+
+    // delivers queued messages oldest first, including ones queued while draining,
+    // and returns how many were delivered. does nothing if called from a handler
+    size_t drain();
+    bool hasPending() const { return queued != 0; }
+
+    // topics: recipients subscribe, one publish reaches all of them
+    // subscribers are kept in one array per topic, in the order they joined;
+    // subscribe ignores stale ids but not duplicates, callers track their own membership.
+    // recipients that unregister drop out of their topics lazily, when the topic
+    // is next published or grows
+    void subscribe(Topic topic, EntityId id);
+    bool unsubscribe(Topic topic, EntityId id);
+    const std::vector<EntityId>& subscribers(Topic topic) const;
+
+    // sends opcode to every subscriber of topic as one batch and returns how many
+    // the batch is queued together, so subscribers joining or leaving while it is
+    // delivered don't change who gets it; in Direct mode it is delivered before returning
+    size_t publish(Topic topic, EntityId from, Opcode opcode, Payload data = {});
+
+    // sees every message as it is sent, before it is queued or delivered
+    // one observer at a time, used to record and check traces; nullptr removes it
+    void setTap(MessageHandler observer) { tap = std::move(observer); }
+
+    // entering Bus mode makes the calling thread the dispatcher's owner
+    void setMode(Mode newMode);
+    Mode getMode() const { return mode; }
+    void setMaxDepth(unsigned depth) { maxDepth = depth; }
+
+    // delivery counts are added to DispatchStats in batches, at the end of each
+    // drain and every DispatchStats::Batch::kFlushEvery deliveries; this adds the
+    // rest now, for a snapshot that has to be exact
+    void flushStats() { stats.flush(); }
+
+    // buffer that handlers write player facing text into
+    // the game points this at its per-command buffer
+    void setOutput(OutputBuffer* buffer) { outputBuffer = buffer; }
+    OutputBuffer& output();
+
+    // a handler turned its message down ("the chest is locked"), so whatever
+    // command sent it failed; the game clears this before each command
+    void refuse() { refused = true; }
+    bool wasRefused() const { return refused; }
+    void clearRefusal() { refused = false; }
+
+private:
+    // calls the recipient's handler
+    void deliver(const Message& message);
+
+    // throws if a thread other than the owner calls in while the bus is open
+    void checkOwner() const {
+        if (owner != std::thread::id() && std::this_thread::get_id() != owner)
+            throwNotOwner();
+    }
+    [[noreturn]] static void throwNotOwner();
+    // moves what other threads posted into the ring, false if there was nothing
+    bool takeFromBus();
+
+    static uint32_t slotOf(EntityId id) { return static_cast<uint32_t>(id); }
+    static uint32_t generationOf(EntityId id) { return static_cast<uint32_t>(id >> 32); }
+
+    // frees an unregistered slot for reuse, compacting the table once enough are free
+    void release(uint32_t slot);
+    // drops free slots off the end of the table and gives back unused capacity
+    void compact();
+    struct Subscribers;
+    // removes unregistered recipients from a topic's subscribers
+    void prune(Subscribers& topic) const;
+
+    // appends to the ring, which must have room
+    void enqueue(const Message& message, unsigned depth);
+    // grows the ring until it can take extra more messages
+    void reserve(size_t extra);
+
+    struct QueuedMessage {
+        Message message;
+        unsigned depth; // how many handlers deep it was sent from
+    };
+
+    struct Subscribers {
+        std::vector<EntityId> members;
+        uint64_t prunedAt = 0; // unregistrations as of the last prune, nothing to drop while it matches
+    };
+
+    struct Recipient {
+        uint32_t generation = 0; // bumped when the recipient unregisters
+        Symbol name;             // the name indexed for it, if any
+    };
+
+    // a slot's handler; handlers live in fixed size chunks that never move, so one
+    // can be called by reference while it registers recipients and grows the table
+    static constexpr uint32_t kHandlerChunkBits = 10;
+    static constexpr uint32_t kHandlerChunkSize = 1u << kHandlerChunkBits;
+    MessageHandler& handlerOf(uint32_t slot) {
+        return handlerChunks[slot >> kHandlerChunkBits][slot & (kHandlerChunkSize - 1)];
+    }
+    const MessageHandler& handlerOf(uint32_t slot) const {
+        return handlerChunks[slot >> kHandlerChunkBits][slot & (kHandlerChunkSize - 1)];
+    }
+
+    // count a handler or a drain in for as long as it runs, however it leaves
+    struct DeliveryScope;
+    struct DrainScope;
+
+    // messages each of the bus's queues holds, see postFromAnyThread
+    static constexpr size_t kBusQueueCapacity = 4096;
+
+    // slots below this many free ones are never worth compacting
+    static constexpr size_t kCompactThreshold = 1024;
+
+    std::vector<Recipient> recipients{1};              // indexed by slot, slot 0 is kNoEntity
+    std::vector<std::unique_ptr<MessageHandler[]>> handlerChunks; // see handlerOf, empty handler = free slot
+    std::vector<uint32_t> freeSlots;                   // lowest slot at the back, reused first
+    std::vector<uint32_t> pendingRelease;              // unregistered while a handler was running
+    uint32_t retiredGeneration = 0;                    // newer than any id of a slot compaction removed
+    size_t compactAt = kCompactThreshold;              // free slot count that triggers the next compaction
+    unsigned delivering = 0;                           // handlers currently on the stack
+    std::unordered_map<Symbol, EntityId> names;        // name -> id, only used at the edges
+    OutputBuffer* outputBuffer = nullptr;              // current command's output
+    MessageHandler tap;                                // see setTap
+    std::unordered_map<uint64_t, Subscribers> topics;  // Topic::key() -> subscribers
+    uint64_t unregistrations = 0;                      // ever, so topics know when to prune
+
+    Mode mode = Mode::Direct;
+    unsigned maxDepth = kDefaultMaxDepth;
+    std::vector<QueuedMessage> ring;                   // capacity is a power of two, grows when full
+    size_t head = 0;                                   // oldest queued message
+    size_t queued = 0;
+    unsigned currentDepth = 0;                         // depth of the message being delivered
+    bool draining = false;
+    bool refused = false;                              // see refuse
+    DispatchStats::Batch stats;                        // counts not yet flushed, see flushStats
+    std::unique_ptr<MessageBus> bus;                   // made on entering Bus mode, closed on leaving it
+    std::thread::id owner;                             // set while in Bus mode
+};
+
+// owns a recipient's registration and unregisters it when destroyed
+// move only; a default constructed one owns nothing. the dispatcher must outlive it
+class MessageDispatcher::Registration {
+public:
+    Registration() = default;
+    Registration(MessageDispatcher& dispatcher, EntityId id) : dispatcher(&dispatcher), recipient(id) {}
+    ~Registration() { reset(); }
+
+    Registration(Registration&& other) noexcept : dispatcher(other.dispatcher), recipient(other.release()) {}
+    Registration& operator=(Registration&& other) noexcept {
+        if (this != &other) {
+            reset();
+            dispatcher = other.dispatcher;
+            recipient = other.release();
+        }
+        return *this;
+    }
+    Registration(const Registration&) = delete;
+    Registration& operator=(const Registration&) = delete;
+
+    EntityId id() const { return recipient; }
+    explicit operator bool() const { return recipient != kNoEntity; }
+
+    // unregisters now
+    void reset() {
+        if (recipient != kNoEntity)
+            dispatcher->unregisterRecipient(recipient);
+        recipient = kNoEntity;
+    }
+
+    // gives up ownership without unregistering
+    EntityId release() {
+        EntityId id = recipient;
+        recipient = kNoEntity;
+        return id;
+    }
+
 private:
-    std::unordered_map<std::string, MessageHandler> recipients; // registered recipients
+    MessageDispatcher* dispatcher = nullptr;
+    EntityId recipient = kNoEntity;
 };
@@ -0,0 +1,265 @@
+#include "MessageTable.h"
+#include "Entity.h"
+#include "Log.h"
+
+// each handler below is one branch of what used to be Entity::handleMessage,
+// filed under the component that gives the entity that behaviour
+
+// any entity can be inspected
+static void inspect(Entity &entity, const Message &)
+{
+    entity.getDispatcher().output() << "The " << entity.getName() << " is inspected: " << entity.getDescription() << "\n";
+}
+
+// Usable
+
+static void use(Entity &entity, const Message &msg)
+{
+    MessageDispatcher &dispatcher = entity.getDispatcher();
+    auto usable = entity.getComponent<UsableComponent>();
+    if (usable->getEffectType() == UseEffectType::HEAL)
+    {
+        dispatcher.output() << "You feel rejuvenated after using the " << entity.getName() << ".\n";
+        dispatcher.sendMessage({entity.getId(), msg.from, Opcode::Heal, usable->getEffectValue()});
+    }
+    else if (usable->getEffectType() == UseEffectType::DAMAGE)
+    {
+        dispatcher.output() << "You feel a burning sensation as you consume the " << entity.getName() << ".\n";
+        dispatcher.sendMessage({entity.getId(), msg.from, Opcode::Damage, std::abs(usable->getEffectValue())});
+    }
+    dispatcher.sendMessage({entity.getId(), msg.from, Opcode::RemoveItem, entity.getHandle()});
+}
+
+static void cannotUse(Entity &entity, const Message &)
+{
+    entity.getDispatcher().output() << "You can't use " << entity.getName() << ".\n";
+    entity.getDispatcher().refuse();
+}
+
+// Lockable
+
+static void unlock(Entity &entity, const Message &msg)
+{
+    if (msg.data.getKind() != Payload::Kind::Symbol)
+    {
+        ZLOG(Warn, Entity, "invalid key data for unlocking " << entity.getName());
+        entity.getDispatcher().refuse();
+        return;
+    }
+    entity.getComponent<LockableComponent>()->unlock(msg.data.asSymbol().str());
+    entity.getDispatcher().output() << entity.getName() << " has been unlocked.\n";
+}
+
+// Openable
+
+static void open(Entity &entity, const Message &)
+{
+    auto openable = entity.getComponent<OpenableComponent>();
+    if (!openable->isOpen())
+    {
+        openable->setOpen();
+        entity.getDispatcher().output() << entity.getName() << " is now open.\n";
+    }
+    else
+    {
+        entity.getDispatcher().output() << entity.getName() << " is already open.\n";
+    }
+}
+
+static void close(Entity &entity, const Message &)
+{
+    auto openable = entity.getComponent<OpenableComponent>();
+    if (openable->isOpen())
+    {
+        openable->setClosed();
+        entity.getDispatcher().output() << entity.getName() << " is now closed.\n";
+    }
+    else
+    {
+        entity.getDispatcher().output() << entity.getName() << " is already closed.\n";
+    }
+}
+
+// Container
+
+// a locked or closed container refuses to be reached into
+bool isSealed(Entity &entity)
+{
+    if (auto lockable = entity.getComponent<LockableComponent>())
+    {
+        if (lockable->isLocked())
+        {
+            entity.getDispatcher().output() << entity.getName() << " is locked.\n";
+            entity.getDispatcher().refuse();
+            return true;
+        }
+    }
+    if (auto openable = entity.getComponent<OpenableComponent>())
+    {
+        if (!openable->isOpen())
+        {
+            entity.getDispatcher().output() << "The " << entity.getName() << " is closed.\n";
+            entity.getDispatcher().refuse();
+            return true;
+        }
+    }
+    return false;
+}
+
+static void addItem(Entity &entity, const Message &msg)
+{
+    EntityHandle itemHandle = msg.data.asEntity();
+    entity.getComponent<ContainerComponent>()->addItem(itemHandle, entity.nameOf(itemHandle));
+    entity.getDispatcher().output() << "Item added to " << entity.getName() << ".\n";
+}
+
+static void removeItem(Entity &entity, const Message &msg)
+{
+    EntityHandle itemHandle = msg.data.asEntity();
+    entity.getComponent<ContainerComponent>()->removeItem(itemHandle, entity.nameOf(itemHandle));
+    entity.getDispatcher().output() << "Item removed from " << entity.getName() << ".\n";
+}
+
+static void lookIn(Entity &entity, const Message &)
+{
+    OutputBuffer &out = entity.getDispatcher().output();
+    if (auto openable = entity.getComponent<OpenableComponent>())
+    {
+        if (!openable->isOpen())
+        {
+            out << entity.getName() << " is closed.\n";
+            entity.getDispatcher().refuse();
+            return;
+        }
+    }
+
+    const auto &contents = entity.getComponent<ContainerComponent>()->getContents();
+    if (contents.empty())
+    {
+        out << "The " << entity.getName() << " is empty.\n";
+    }
+    else
+    {
+        out << "Inside the " << entity.getName() << " you find:\n";
+        for (EntityHandle itemHandle : contents)
+        {
+            if (Entity *item = entity.resolve(itemHandle))
+                out << " - " << item->getName() << ": " << item->getDescription() << "\n";
+        }
+    }
+}
+
+static void cannotLookIn(Entity &entity, const Message &)
+{
+    entity.getDispatcher().output() << "You can't look inside " << entity.getName() << ".\n";
+    entity.getDispatcher().refuse();
+}
+
+static void takeFrom(Entity &entity, const Message &msg)
+{
+    if (isSealed(entity))
+        return;
+
+    MessageDispatcher &dispatcher = entity.getDispatcher();
+    auto container = entity.getComponent<ContainerComponent>();
+    Symbol itemName = msg.data.asSymbol();
+    EntityHandle itemHandle = container->findItem(itemName.folded());
+    if (Entity *item = entity.resolve(itemHandle))
+    {
+        if (!item->hasComponent<TakeableComponent>())
+        {
+            dispatcher.output() << "You can't take that.\n";
+            dispatcher.refuse();
+            return;
+        }
+        container->removeItem(itemHandle, item->getNameSymbol());
+        dispatcher.sendMessage({entity.getId(), msg.from, Opcode::AddItem, itemHandle});
+        dispatcher.output() << "Taken " << item->getName() << " from " << entity.getName() << ".\n";
+        return;
+    }
+    dispatcher.output() << "You don't see a " << itemName.str() << " in there.\n";
+    dispatcher.refuse();
+}
+
+static void takeFromNonContainer(Entity &entity, const Message &)
+{
+    entity.getDispatcher().output() << entity.getName() << " is not a container.\n";
+    entity.getDispatcher().refuse();
+}
+
+static void putItem(Entity &entity, const Message &msg)
+{
+    if (isSealed(entity))
+        return;
+
+    EntityHandle itemHandle = msg.data.asEntity();
+    Entity *item = entity.resolve(itemHandle);
+    if (!item)
+        return; // the item was destroyed after the command looked it up
+    entity.getComponent<ContainerComponent>()->addItem(itemHandle, item->getNameSymbol());
+    entity.getDispatcher().sendMessage({entity.getId(), msg.from, Opcode::RemoveItem, itemHandle});
+    entity.getDispatcher().output() << "You put the " << item->getName() << " in the " << entity.getName() << ".\n";
+}
+
+static void putIntoNonContainer(Entity &entity, const Message &)
+{
+    entity.getDispatcher().output() << "The " << entity.getName() << " is not a container.\n";
+    entity.getDispatcher().refuse();
+}
+
+MessageTable &MessageTable::instance()
+{
+    static MessageTable table;
+    return table;
+}
+
+// the built-in behaviours
+MessageTable::MessageTable()
+{
+    fallback(Opcode::Inspect, inspect);
+
+    on(Opcode::Use, ComponentType::Usable, use);
+    fallback(Opcode::Use, cannotUse);
+
+    on(Opcode::Unlock, ComponentType::Lockable, unlock);
+
+    on(Opcode::Open, ComponentType::Openable, open);
+    on(Opcode::Close, ComponentType::Openable, close);
+
+    on(Opcode::AddItem, ComponentType::Container, addItem);
+    on(Opcode::RemoveItem, ComponentType::Container, removeItem);
+    on(Opcode::LookIn, ComponentType::Container, lookIn);
+    fallback(Opcode::LookIn, cannotLookIn);
+    on(Opcode::TakeFrom, ComponentType::Container, takeFrom);
+    fallback(Opcode::TakeFrom, takeFromNonContainer);
+    on(Opcode::PutItem, ComponentType::Container, putItem);
+    fallback(Opcode::PutItem, putIntoNonContainer);
+}
+
+void MessageTable::on(Opcode opcode, ComponentType component, Handler handler)
+{
+    handlers[static_cast<size_t>(opcode)].push_back({componentBit(component), handler});
+}
+
+void MessageTable::fallback(Opcode opcode, Handler handler)
+{
+    fallbacks[static_cast<size_t>(opcode)] = handler;
+}
+
+void MessageTable::dispatch(Entity &entity, const Message &msg) const
+{
+    if (msg.opcode >= Opcode::Count)
+        return;
+    size_t index = static_cast<size_t>(msg.opcode);
+    ComponentSignature signature = entity.getSignature();
+    for (const Entry &entry : handlers[index])
+    {
+        if ((signature & entry.required) == entry.required)
+        {
+            entry.handler(entity, msg);
+            return;
+        }
+    }
+    if (Handler handler = fallbacks[index])
+        handler(entity, msg);
+}
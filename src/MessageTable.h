@@ -0,0 +1,59 @@
+#pragma once
+#include "Component.h"
+#include "Message.h"
+#include "Opcode.h"
+#include <array>
+#include <initializer_list>
+#include <vector>
+
+class Entity;
+
+// how an Entity reacts to each opcode
+// components register handlers for the opcodes they care about; an entity
+// receiving a message runs the first handler whose component it has, or the
+// opcode's fallback if it has none of them. lookup is an index by opcode and
+// a signature test per candidate, there are no string compares.
+class MessageTable
+{
+public:
+    using Handler = void (*)(Entity &entity, const Message &msg);
+
+    // the process wide table, the built-in handlers are registered on first use
+    static MessageTable &instance();
+
+    // handles opcode for entities that have the component
+    // handlers for the same opcode are tried in registration order
+    void on(Opcode opcode, ComponentType component, Handler handler);
+
+    // handles opcode for entities none of the component handlers applied to
+    void fallback(Opcode opcode, Handler handler);
+
+    // runs the handler for msg.opcode, if any
+    void dispatch(Entity &entity, const Message &msg) const;
+
+    // registers handlers during static initialisation, for components defined in their own files
+    struct Registrar
+    {
+        Registrar(ComponentType component, std::initializer_list<std::pair<Opcode, Handler>> handlers)
+        {
+            for (const auto &[opcode, handler] : handlers)
+                MessageTable::instance().on(opcode, component, handler);
+        }
+    };
+
+private:
+    MessageTable();
+
+    struct Entry
+    {
+        ComponentSignature required;
+        Handler handler;
+    };
+
+    std::array<std::vector<Entry>, kOpcodeCount> handlers;
+    std::array<Handler, kOpcodeCount> fallbacks{};
+};
+
+// true if the entity is locked or closed, in which case it has said so and refused
+// the container handlers check it first; commands that answer for a container do too
+bool isSealed(Entity &entity);
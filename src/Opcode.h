@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// every verb the message system understands
+// handlers are tables indexed by opcode, so a new verb is a new entry here
+enum class Opcode : uint8_t
+{
+    Inspect,
+    Use,
+    Unlock,
+    Open,
+    Close,
+    AddItem,
+    RemoveItem,
+    LookIn,
+    TakeFrom,
+    PutItem,
+    Heal,
+    Damage,
+    Count
+};
+
+constexpr size_t kOpcodeCount = static_cast<size_t>(Opcode::Count);
+
+// the verbs' names as they appear in logs and in any text that names a verb
+constexpr std::array<std::string_view, kOpcodeCount> kOpcodeNames = {
+    "inspect", "use", "unlock", "open", "close", "addItem",
+    "removeItem", "look_in", "take_from", "put_item", "heal", "damage"};
+
+constexpr std::string_view opcodeName(Opcode opcode)
+{
+    return opcode < Opcode::Count ? kOpcodeNames[static_cast<size_t>(opcode)] : std::string_view("unknown");
+}
+
+// the opcode for a verb name, Opcode::Count if there isn't one
+// for the edges (text coming in from outside), never for dispatch itself
+constexpr Opcode opcodeFromName(std::string_view name)
+{
+    for (size_t i = 0; i < kOpcodeCount; ++i)
+    {
+        if (kOpcodeNames[i] == name)
+            return static_cast<Opcode>(i);
+    }
+    return Opcode::Count;
+}
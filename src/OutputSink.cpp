@@ -0,0 +1,62 @@
+#include "OutputSink.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+void StreamSink::write(std::string_view text)
+{
+    stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+    stream.flush();
+}
+
+FileSink::FileSink(const std::string &filename)
+{
+    file = std::fopen(filename.c_str(), "ab");
+}
+
+FileSink::~FileSink()
+{
+    if (file)
+        std::fclose(file);
+}
+
+void FileSink::write(std::string_view text)
+{
+    if (!file)
+        return;
+    // no flush per command: stdio gathers commands into whole blocks, which is what
+    // a redirected std::cout did before, and the file is complete once it is closed
+    std::fwrite(text.data(), 1, text.size(), file);
+}
+
+void DescriptorSink::write(std::string_view text)
+{
+    // short writes are retried so a whole command's text always goes out
+    while (!text.empty())
+    {
+#ifdef _WIN32
+        int written = ::_write(fd, text.data(), static_cast<unsigned>(text.size()));
+        if (written <= 0)
+            return;
+#else
+        ssize_t written = ::write(fd, text.data(), text.size());
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return;
+#endif
+        text.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+void OutputBuffer::flush()
+{
+    if (text.empty())
+        return;
+    sink->write(text);
+    text.clear();
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <charconv>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// destination for player facing game text
+// each command's text reaches a sink in a single write call
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(std::string_view text) = 0;
+};
+
+// writes to a c++ stream, std::cout for the terminal
+class StreamSink : public OutputSink
+{
+public:
+    explicit StreamSink(std::ostream &stream) : stream(stream) {}
+    void write(std::string_view text) override;
+
+private:
+    std::ostream &stream;
+};
+
+// appends to a file, used to capture a session transcript
+// writes are buffered, the file is only certain to be up to date once the sink is gone
+class FileSink : public OutputSink
+{
+public:
+    explicit FileSink(const std::string &filename);
+    ~FileSink() override;
+    FileSink(const FileSink &) = delete;
+    FileSink &operator=(const FileSink &) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+    void write(std::string_view text) override;
+
+private:
+    std::FILE *file = nullptr;
+};
+
+// throws text away, for running sessions nobody watches
+class NullSink : public OutputSink
+{
+public:
+    void write(std::string_view) override {}
+};
+
+// writes to a raw descriptor such as a socket or pipe, the descriptor isn't owned
+class DescriptorSink : public OutputSink
+{
+public:
+    explicit DescriptorSink(int fd) : fd(fd) {}
+    void write(std::string_view text) override;
+
+private:
+    int fd;
+};
+
+// appends to a string someone else owns, e.g. a connection's unsent output
+class StringSink : public OutputSink
+{
+public:
+    explicit StringSink(std::string &text) : text(text) {}
+    void write(std::string_view more) override { text.append(more); }
+
+private:
+    std::string &text;
+};
+
+// reusable text buffer for one command's output
+// commands append to it and the game flushes it to its sink once per command;
+// the capacity is kept between commands so steady state output doesn't allocate
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(OutputSink &sink) : sink(&sink) { text.reserve(4096); }
+
+    OutputBuffer &operator<<(std::string_view str)
+    {
+        text.append(str);
+        return *this;
+    }
+    OutputBuffer &operator<<(const std::string &str)
+    {
+        text.append(str);
+        return *this;
+    }
+    OutputBuffer &operator<<(const char *str)
+    {
+        text.append(str);
+        return *this;
+    }
+    OutputBuffer &operator<<(char c)
+    {
+        text.push_back(c);
+        return *this;
+    }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    OutputBuffer &operator<<(T value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        text.append(digits, result.ptr);
+        return *this;
+    }
+
+    // hands everything buffered so far to the sink in one write
+    void flush();
+
+    // switches where flushed text goes
+    void setSink(OutputSink &newSink) { sink = &newSink; }
+
+    std::string_view view() const { return text; }
+    bool empty() const { return text.empty(); }
+
+private:
+    std::string text;
+    OutputSink *sink;
+};
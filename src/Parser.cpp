@@ -0,0 +1,151 @@
+#include "Parser.h"
+#include <cctype>
+
+bool Grammar::listed(std::string_view list, std::string_view word)
+{
+    while (!list.empty())
+    {
+        size_t end = list.find(' ');
+        if (list.substr(0, end) == word)
+            return true;
+        if (end == std::string_view::npos)
+            break;
+        list.remove_prefix(end + 1);
+    }
+    return false;
+}
+
+Parser::Parser(Resolver resolver) : resolver(std::move(resolver))
+{
+    text.reserve(256);
+    words.reserve(16);
+}
+
+std::string_view Parser::tokenize(std::string_view line)
+{
+    // lowercase and squeeze whitespace, so a phrase of several words is one view
+    text.clear();
+    for (char c : line)
+    {
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            if (!text.empty() && text.back() != ' ')
+                text.push_back(' ');
+        }
+        else
+        {
+            text.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+        }
+    }
+    if (!text.empty() && text.back() == ' ')
+        text.pop_back();
+
+    // the views are taken after the last write, text can't move under them
+    words.clear();
+    std::string_view rest(text);
+    while (!rest.empty())
+    {
+        size_t end = rest.find(' ');
+        words.push_back(rest.substr(0, end));
+        if (end == std::string_view::npos)
+            break;
+        rest.remove_prefix(end + 1);
+    }
+
+    return text;
+}
+
+const ParsedCommand &Parser::parse(const Grammar &grammar, size_t verbWords)
+{
+    size_t at = verbWords;
+    size_t count = words.size();
+    parsed = ParsedCommand{};
+    parsed.verb = span(0, at);
+    parsed.rest = span(at, count);
+    if (at < count && Grammar::listed(grammar.leading, words[at]))
+        parsed.preposition = words[at++];
+
+    if (!grammar.nouns)
+    {
+        if (at < count)
+            parsed.object = NounPhrase{words[at]};
+        if (at + 1 < count)
+            parsed.target = NounPhrase{words[at + 1]};
+        parsed.extra = span(at + 2, count);
+        return parsed;
+    }
+
+    // the object: whatever in reach the longest run of words names, or up to the separator
+    NounPhrase object = longestMatch(at, count);
+    size_t end = at;
+    if (object.empty())
+    {
+        while (end < count && !Grammar::listed(grammar.separators, words[end]))
+            ++end;
+        object = phrase(at, end);
+    }
+    else
+    {
+        end = at + 1;
+        while (words[end - 1].data() + words[end - 1].size() != object.text.data() + object.text.size())
+            ++end;
+    }
+    parsed.object = object;
+
+    if (end < count && Grammar::listed(grammar.separators, words[end]))
+    {
+        parsed.preposition = words[end];
+        NounPhrase target = longestMatch(end + 1, count);
+        size_t targetEnd = count;
+        if (!target.empty())
+        {
+            targetEnd = end + 2;
+            while (words[targetEnd - 1].data() + words[targetEnd - 1].size() != target.text.data() + target.text.size())
+                ++targetEnd;
+        }
+        else
+        {
+            target = phrase(end + 1, count);
+        }
+        parsed.target = target;
+        parsed.extra = span(targetEnd, count);
+    }
+    else
+    {
+        parsed.extra = span(end, count);
+    }
+    return parsed;
+}
+
+std::string_view Parser::span(size_t first, size_t last) const
+{
+    if (first >= last || first >= words.size())
+        return {};
+    const char *begin = words[first].data();
+    const char *end = words[last - 1].data() + words[last - 1].size();
+    return std::string_view(begin, static_cast<size_t>(end - begin));
+}
+
+NounPhrase Parser::phrase(size_t first, size_t last) const
+{
+    NounPhrase result;
+    result.text = span(first, last);
+    if (!result.text.empty())
+    {
+        result.folded = Symbol::findFolded(result.text);
+        if (!result.folded.empty() && resolver)
+            result.entity = resolver(result.folded);
+    }
+    return result;
+}
+
+NounPhrase Parser::longestMatch(size_t first, size_t last) const
+{
+    for (size_t end = last; end > first; --end)
+    {
+        NounPhrase candidate = phrase(first, end);
+        if (candidate.entity)
+            return candidate;
+    }
+    return NounPhrase{};
+}
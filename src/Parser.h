@@ -0,0 +1,79 @@
+#pragma once
+#include "Symbol.h"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Entity;
+
+// how a verb reads the words after it: VERB [LEADING] object [SEPARATOR target]
+// word lists are space separated, e.g. Grammar{"from"} for TAKE x FROM y
+struct Grammar
+{
+    std::string_view separators; // words that end the object and start the target
+    std::string_view leading;    // words allowed straight after the verb, "at in" for LOOK AT x
+    bool nouns = true;           // false: the arguments are plain words, one each (directions, command names)
+
+    static Grammar words() { return Grammar{"", "", false}; }
+
+    // true if word is one of a space separated list
+    static bool listed(std::string_view list, std::string_view word);
+};
+
+// a run of words naming something
+struct NounPhrase
+{
+    std::string_view text;    // lowercase, single spaced
+    Symbol folded;            // the interned folded form of text, empty if nothing is called that
+    Entity *entity = nullptr; // what it names within the player's reach, if anything
+
+    bool empty() const { return text.empty(); }
+};
+
+// one input line after parsing
+// every view points into the parser and stays valid until it reads the next line
+struct ParsedCommand
+{
+    std::string_view verb;        // one word, or more for a name like LOOK IN
+    std::string_view preposition; // the leading word or separator the line used, if any
+    NounPhrase object;
+    NounPhrase target;
+    std::string_view extra;       // words after the object that no rule accounted for
+    std::string_view rest;        // everything after the verb
+};
+
+// splits input lines into words and reads them by a verb's grammar
+// a line is lowercased into a buffer the parser keeps, and words and phrases are
+// views into it, so once the buffers have grown to fit a line nothing allocates.
+//
+// noun phrases are matched greedily: the longest run of words that names
+// something within the player's reach wins, so "take round rock" finds the Round
+// Rock before the Rock. a phrase that names nothing in reach runs up to the next
+// separator instead, so "take coin from bag" still splits at FROM.
+class Parser
+{
+public:
+    // finds what a folded name refers to within the player's reach, nullptr if nothing
+    using Resolver = std::function<Entity *(Symbol folded)>;
+
+    explicit Parser(Resolver resolver);
+
+    // reads a line and returns it lowercase and single spaced, for finding its command
+    std::string_view tokenize(std::string_view line);
+
+    // reads the last tokenized line by a grammar; the command's name is its first verbWords words
+    const ParsedCommand &parse(const Grammar &grammar, size_t verbWords = 1);
+
+private:
+    // the words [first, last) as one view into the buffer
+    std::string_view span(size_t first, size_t last) const;
+    NounPhrase phrase(size_t first, size_t last) const;
+    // the longest phrase starting at first that names something in reach, an empty one if none does
+    NounPhrase longestMatch(size_t first, size_t last) const;
+
+    Resolver resolver;
+    std::string text;                    // the line, lowercase and single spaced
+    std::vector<std::string_view> words; // views into text
+    ParsedCommand parsed;
+};
@@ -1,79 +1,102 @@
 #include "Player.h"
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
 
 // constructor implementation (must match declaration in Player.h)
 Player::Player(int startLocation, Graph &gameGraph, MessageDispatcher &dispatcher)
     : currentLocation(startLocation), graph(gameGraph), dispatcher(dispatcher)
 {
-    dispatcher.registerRecipient("player", [this](const Message &msg)
-                                 { handleMessage(msg); });
+    MessageDispatcher::MessageHandler handler = [this](const Message &msg)
+    { handleMessage(msg); };
+    // a name is one recipient's, so in a shared world the players after the first go unnamed
+    Symbol name("player");
+    EntityId id = dispatcher.lookup(name) == kNoEntity ? dispatcher.registerRecipient(name, std::move(handler))
+                                                     : dispatcher.registerRecipient(std::move(handler));
+    registration = MessageDispatcher::Registration(dispatcher, id);
 }
 
 void Player::displayCurrentLocation() const
 {
     const auto &location = graph.locations.at(currentLocation);
 
-    std::cout << "\n"
-              << location->name << "\n"
-              << location->description << "\n";
+    dispatcher.output() << "\n"
+              << location->name.str() << "\n"
+              << location->description.str() << "\n";
 
     std::string entityDescriptions = location->getEntityDescriptions();
     if (!entityDescriptions.empty())
     {
-        std::cout << entityDescriptions;
+        dispatcher.output() << entityDescriptions;
     }
 
-    std::cout << "\n";
+    dispatcher.output() << "\n";
 }
 
-void Player::go(const std::string &direction)
+bool Player::go(std::string_view direction)
 {
-    if (graph.locations[currentLocation]->connections.count(direction))
+    auto &connections = graph.locations[currentLocation]->connections;
+    auto it = connections.find(Symbol::find(direction));
+    if (it != connections.end())
     {
-        currentLocation = graph.locations[currentLocation]->connections[direction]->number;
-        std::cout << "\nYou move " << direction << ".\n";
+        currentLocation = it->second->number;
+        dispatcher.output() << "\nYou move " << direction << ".\n";
+        return true;
     }
     else
     {
-        std::cout << "\nNo path in that direction.\n";
+        dispatcher.output() << "\nNo path in that direction.\n";
+        return false;
     }
 }
 
-void Player::addItemToInventory(std::shared_ptr<Entity> item)
+void Player::addItemToInventory(EntityHandle item)
 {
-    inventory.push_back(item);
+    if (const Entity *entity = graph.entities.get(item))
+        inventory.add(item, entity->getNameSymbol());
+}
+
+void Player::dropInventory()
+{
+    auto it = graph.locations.find(currentLocation);
+    if (it == graph.locations.end())
+        return;
+    for (EntityHandle handle : inventory.handles())
+    {
+        if (graph.entities.get(handle))
+            it->second->addEntity(handle);
+    }
+    inventory = EntityList();
 }
 
 void Player::viewInventory() const
 {
-    std::cout << "\n----- Inventory -----\n";
+    dispatcher.output() << "\n----- Inventory -----\n";
     if (inventory.empty())
     {
-        std::cout << "Your inventory is empty.\n";
+        dispatcher.output() << "Your inventory is empty.\n";
     }
     else
     {
-        for (const auto &item : inventory)
+        for (EntityHandle handle : inventory.handles())
         {
             // display only the name of each item without nested contents
-            std::cout << "- " << item->getName() << "\n";
+            if (const Entity *item = graph.entities.get(handle))
+                dispatcher.output() << "- " << item->getName() << "\n";
         }
     }
-    std::cout << "---------------------\n";
+    dispatcher.output() << "---------------------\n";
 }
 
-std::shared_ptr<Entity> Player::findEntityInInventory(const std::string &name) const
+Entity *Player::findEntityInInventory(const std::string &name) const
 {
-    std::string lowerName = toLowerCase(name); // convert input name to lowercase
-    for (const auto &item : inventory)
-    {
-        if (toLowerCase(item->getName()) == lowerName)
-        {
-            return item;
-        }
-    }
-    return nullptr;
+    // case-insensitive, one probe of the inventory's name index
+    return graph.entities.get(inventory.find(Symbol::findFolded(name)));
+}
+
+Entity *Player::findEntityInInventory(Symbol name) const
+{
+    return graph.entities.get(inventory.find(name.folded()));
 }
 
 int Player::getCurrentLocation() const
@@ -81,13 +104,10 @@ int Player::getCurrentLocation() const
     return currentLocation;
 }
 
-void Player::removeItemFromInventory(std::shared_ptr<Entity> item)
+void Player::removeItemFromInventory(EntityHandle item)
 {
-    auto it = std::find(inventory.begin(), inventory.end(), item);
-    if (it != inventory.end())
-    {
-        inventory.erase(it);
-    }
+    if (const Entity *entity = graph.entities.get(item))
+        inventory.remove(item, entity->getNameSymbol());
 }
 
 void Player::modifyHealth(int amount)
@@ -103,7 +123,7 @@ void Player::modifyHealth(int amount)
         {
             health = 5;
         }
-        std::cout << "Your health is now: " << health << "\n";
+        dispatcher.output() << "Your health is now: " << health << "\n";
     }
 }
 
@@ -113,38 +133,43 @@ void Player::takeDamage(int amount)
     if (health <= 0)
     {
         health = 0; // caps lowest hp at 0
-        std::cout << "You took " << amount << " damage. Your health is now: " << health << "\n";
-        std::cout << "You lose! Game over.\n";
-        std::cout << "Press enter to exit...\n";
-        std::cin.get();
-        exit(0); // quit
+        dispatcher.output() << "You took " << amount << " damage. Your health is now: " << health << "\n";
+        dispatcher.output() << "You lose! Game over.\n";
+        // the game sees isDead() once the command is done and ends the session
     }
     else
     {
-        std::cout << "You took " << amount << " damage. Your health is now: " << health << "\n";
+        dispatcher.output() << "You took " << amount << " damage. Your health is now: " << health << "\n";
     }
 }
 
 void Player::handleMessage(const Message &msg)
 {
-    if (msg.message == "heal")
+    switch (msg.opcode)
     {
-        modifyHealth(std::any_cast<int>(msg.data));
-    }
-    else if (msg.message == "damage")
+    case Opcode::Heal:
+        modifyHealth(msg.data.asInt());
+        break;
+    case Opcode::Damage:
+        takeDamage(std::abs(msg.data.asInt()));
+        break;
+    case Opcode::AddItem:
     {
-        takeDamage(std::abs(std::any_cast<int>(msg.data)));
+        EntityHandle handle = msg.data.asEntity();
+        addItemToInventory(handle);
+        if (const Entity *item = graph.entities.get(handle))
+            dispatcher.output() << "You received " << item->getName() << ".\n";
+        break;
     }
-    else if (msg.message == "addItem")
+    case Opcode::RemoveItem:
     {
-        auto item = std::any_cast<std::shared_ptr<Entity>>(msg.data);
-        addItemToInventory(item);
-        std::cout << "You received " << item->getName() << ".\n";
+        EntityHandle handle = msg.data.asEntity();
+        removeItemFromInventory(handle);
+        if (const Entity *item = graph.entities.get(handle))
+            dispatcher.output() << "You lost " << item->getName() << ".\n";
+        break;
     }
-    else if (msg.message == "removeItem")
-    {
-        auto item = std::any_cast<std::shared_ptr<Entity>>(msg.data);
-        removeItemFromInventory(item);
-        std::cout << "You lost " << item->getName() << ".\n";
+    default:
+        break; // the player ignores verbs meant for items
     }
 }
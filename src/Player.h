@@ -4,8 +4,10 @@
 #include "Graph.h"
 #include "Entity.h"
 #include "MessageDispatcher.h"
+#include "EntityList.h"
 #include <vector>
 #include <string>
+#include <string_view>
 
 // this class is responsible for managing the player's location and movement as per spike report design
 class Player
@@ -15,12 +17,19 @@ public:
     Player(int startingLocation, Graph &graph, MessageDispatcher &dispatcher);
 
     void displayCurrentLocation() const;
-    void go(const std::string &direction);
+    bool go(std::string_view direction); // false if there is no path that way
     void viewInventory() const;
     int getCurrentLocation() const;
-    void addItemToInventory(std::shared_ptr<Entity> item);
-    std::shared_ptr<Entity> findEntityInInventory(const std::string &name) const;
-    void removeItemFromInventory(std::shared_ptr<Entity> item);
+    int getHealth() const { return health; }
+    bool isDead() const { return health <= 0; }
+    const EntityList &getInventory() const { return inventory; }
+    EntityId getId() const { return registration.id(); } // commands send from this id
+    void addItemToInventory(EntityHandle item);
+    Entity *findEntityInInventory(const std::string &name) const; // non-owning, nullptr if not carried
+    Entity *findEntityInInventory(Symbol name) const;
+    void removeItemFromInventory(EntityHandle item);
+    // leaves everything carried where the player stands, for a player leaving a shared world
+    void dropInventory();
     void modifyHealth(int amount);
     void takeDamage(int amount);
     void handleMessage(const Message &msg);
@@ -28,9 +37,10 @@ public:
 private:
     int currentLocation;                            // id of the current location
     Graph &graph;                                   // reference to the game graph
-    std::vector<std::shared_ptr<Entity>> inventory; // inventory storing Entity pointers
+    EntityList inventory;                           // handles of the carried entities, indexed by name
     int health = 5;                                 // player's health
     MessageDispatcher &dispatcher;                 // reference to the shared message dispatcher
+    MessageDispatcher::Registration registration;   // dispatcher id, the first player in a world is also indexed as "player"
 };
 
 #endif
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Component.h"
+#include "EntityHandle.h"
+
+class Entity;
+
+// slot index of an entity inside a Registry (EntityHandle::index)
+using EntityIndex = uint32_t;
+
+// type erased part of a component pool so the registry can drop components it doesn't know the type of
+class ComponentPoolBase
+{
+public:
+    virtual ~ComponentPoolBase() = default;
+    virtual void remove(EntityIndex entity) = 0;
+};
+
+// sparse set storage for one component type
+// components sit contiguously in `components`, `owners` holds the entity for each
+// slot and `sparse` maps an entity index back to its slot
+template <typename T>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+    static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+    template <typename... Args>
+    T &emplace(EntityIndex entity, Args &&...args)
+    {
+        if (entity >= sparse.size())
+            sparse.resize(entity + 1, kEmpty);
+        uint32_t &slot = sparse[entity];
+        if (slot != kEmpty)
+        {
+            components[slot] = T(std::forward<Args>(args)...);
+            return components[slot];
+        }
+        slot = static_cast<uint32_t>(components.size());
+        owners.push_back(entity);
+        components.emplace_back(std::forward<Args>(args)...);
+        return components.back();
+    }
+
+    // the caller has checked the entity's signature, so the slot exists
+    T *get(EntityIndex entity) { return &components[sparse[entity]]; }
+
+    // swaps the last component into the hole so storage stays dense
+    void remove(EntityIndex entity) override
+    {
+        if (entity >= sparse.size() || sparse[entity] == kEmpty)
+            return;
+        uint32_t slot = sparse[entity];
+        uint32_t last = static_cast<uint32_t>(components.size()) - 1;
+        if (slot != last)
+        {
+            components[slot] = std::move(components[last]);
+            owners[slot] = owners[last];
+            sparse[owners[slot]] = slot;
+        }
+        components.pop_back();
+        owners.pop_back();
+        sparse[entity] = kEmpty;
+    }
+
+    size_t size() const { return components.size(); }
+    const std::vector<EntityIndex> &entities() const { return owners; }
+
+private:
+    std::vector<uint32_t> sparse;
+    std::vector<EntityIndex> owners;
+    std::vector<T> components;
+};
+
+// central store for every entity in a world
+//
+// the registry hands out entity slots and generational handles, and keeps the
+// components of each type in a single contiguous pool, so systems can walk all
+// entities that have a given set of components without touching the rest.
+// pointers returned by get() are non-owning and only stay valid until another
+// component of the same type is added or removed.
+class Registry
+{
+public:
+    // reserves a slot for a new entity; the slot's owner is set with bind()
+    // returns a null handle once every index is in use
+    EntityHandle allocate()
+    {
+        EntityIndex index;
+        if (!freeIndices.empty())
+        {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        else
+        {
+            if (signatures.size() > EntityHandle::kMaxIndex)
+                return EntityHandle();
+            index = static_cast<EntityIndex>(signatures.size());
+            signatures.push_back(0);
+            owners.push_back(nullptr);
+            generations.push_back(1);
+        }
+        signatures[index] = 0;
+        ++liveCount;
+        return EntityHandle(index, generations[index]);
+    }
+
+    // records the object that lives in a slot
+    void bind(EntityHandle handle, Entity *owner) { owners[handle.index()] = owner; }
+
+    // drops every component of the entity and invalidates all handles to it
+    void release(EntityHandle handle)
+    {
+        if (!isAlive(handle))
+            return;
+        EntityIndex index = handle.index();
+        for (size_t type = 0; type < pools.size(); ++type)
+        {
+            if (pools[type] && (signatures[index] & componentBit(static_cast<ComponentType>(type))))
+                pools[type]->remove(index);
+        }
+        signatures[index] = 0;
+        owners[index] = nullptr;
+        --liveCount;
+
+        // a slot whose generation is used up is retired so old handles can never alias it
+        if (generations[index] < EntityHandle::kMaxGeneration)
+        {
+            ++generations[index];
+            freeIndices.push_back(index);
+        }
+        else
+        {
+            generations[index] = 0;
+        }
+    }
+
+    // true if the handle still refers to the entity it was made for
+    bool isAlive(EntityHandle handle) const
+    {
+        EntityIndex index = handle.index();
+        return !handle.isNull() && index < generations.size() && generations[index] == handle.generation() && owners[index];
+    }
+
+    // the entity behind a handle, or nullptr if the handle is null or stale
+    Entity *resolve(EntityHandle handle) const
+    {
+        return isAlive(handle) ? owners[handle.index()] : nullptr;
+    }
+
+    // number of live entities
+    size_t size() const { return liveCount; }
+
+    // number of slots ever handed out, live or not
+    size_t slotCount() const { return owners.size(); }
+
+    // constructs a component in place, replacing any existing one of the same type
+    template <typename T, typename... Args>
+    T &emplace(EntityIndex index, Args &&...args)
+    {
+        static_assert(std::is_base_of_v<Component, T>, "components must derive from Component");
+        T &component = pool<T>().emplace(index, std::forward<Args>(args)...);
+        signatures[index] |= componentBit(T::type);
+        return component;
+    }
+
+    // returns the component, or nullptr if the entity doesn't have one
+    template <typename T>
+    T *get(EntityIndex index) const
+    {
+        if (!(signatures[index] & componentBit(T::type)))
+            return nullptr;
+        return static_cast<ComponentPool<T> *>(pools[slot<T>()].get())->get(index);
+    }
+
+    template <typename T>
+    bool has(EntityIndex index) const
+    {
+        return (signatures[index] & componentBit(T::type)) != 0;
+    }
+
+    template <typename T>
+    void remove(EntityIndex index)
+    {
+        if (has<T>(index))
+        {
+            pool<T>().remove(index);
+            signatures[index] &= ~componentBit(T::type);
+        }
+    }
+
+    ComponentSignature signature(EntityIndex index) const { return signatures[index]; }
+
+    // the Entity an index belongs to
+    Entity *owner(EntityIndex index) const { return owners[index]; }
+
+    // a handle for a live index, e.g. one produced by a view
+    EntityHandle handle(EntityIndex index) const { return EntityHandle(index, generations[index]); }
+
+    // iterates every entity that has all of Ts, driven by the smallest pool
+    template <typename... Ts>
+    class View
+    {
+    public:
+        explicit View(Registry &registry) : registry(registry) {}
+
+        // calls fn(EntityIndex, Ts &...) for each match
+        template <typename Fn>
+        void each(Fn &&fn)
+        {
+            constexpr ComponentSignature mask = (componentBit(Ts::type) | ...);
+            const std::vector<EntityIndex> *smallest = nullptr;
+            for (const std::vector<EntityIndex> *candidate : {&registry.pool<Ts>().entities()...})
+            {
+                if (!smallest || candidate->size() < smallest->size())
+                    smallest = candidate;
+            }
+            for (EntityIndex index : *smallest)
+            {
+                if ((registry.signatures[index] & mask) == mask)
+                    fn(index, *registry.get<Ts>(index)...);
+            }
+        }
+
+    private:
+        Registry &registry;
+    };
+
+    template <typename... Ts>
+    View<Ts...> view() { return View<Ts...>(*this); }
+
+    // number of components of one type across the world
+    template <typename T>
+    size_t count() { return pool<T>().size(); }
+
+private:
+    template <typename T>
+    static constexpr size_t slot() { return static_cast<size_t>(T::type); }
+
+    template <typename T>
+    ComponentPool<T> &pool()
+    {
+        auto &base = pools[slot<T>()];
+        if (!base)
+            base = std::make_unique<ComponentPool<T>>();
+        return *static_cast<ComponentPool<T> *>(base.get());
+    }
+
+    std::array<std::unique_ptr<ComponentPoolBase>, static_cast<size_t>(ComponentType::Count)> pools;
+    std::vector<ComponentSignature> signatures; // per entity index
+    std::vector<Entity *> owners;               // per entity index
+    std::vector<uint16_t> generations;          // per entity index, 0 once retired
+    std::vector<EntityIndex> freeIndices;
+    size_t liveCount = 0;
+};
@@ -0,0 +1,396 @@
+#include "Server.h"
+#include "Game.h"
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace
+{
+    constexpr size_t kReadSize = 16 * 1024;
+    constexpr size_t kMaxLine = 64 * 1024;        // a connection sending more than this without a newline is dropped
+    constexpr size_t kMaxPending = 1024 * 1024;   // stop reading from a connection with this much unsent
+    constexpr const char *kPrompt = "\n> ";
+
+    volatile std::sig_atomic_t stopRequested = 0;
+}
+
+// one player's connection
+struct Server::Connection
+{
+    int fd = -1;
+    std::string input;          // bytes read that don't make a whole line yet
+    std::string pending;        // text not sent yet, the session's sink appends here
+    size_t sent = 0;            // how much of pending has gone out
+    std::unique_ptr<Game> game; // after pending, it writes there until it is gone
+    uint32_t events = 0;        // what epoll is watching for
+    bool closing = false;       // the session is over, close once pending is out
+};
+
+void Server::Stats::report(std::ostream &out) const
+{
+    // a percentile is its bucket's upper bound, never report it above the real maximum
+    auto micros = [&](double fraction)
+    { return static_cast<double>(std::min(latency.percentile(fraction), maxNanos)) / 1000.0; };
+
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "server: %llu sessions (peak %llu at once), %llu lines, %llu commands in %.3f s (%.0f commands/s), latency per line us p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+                  static_cast<unsigned long long>(sessions), static_cast<unsigned long long>(peak),
+                  static_cast<unsigned long long>(lines), static_cast<unsigned long long>(commands), seconds,
+                  seconds > 0 ? commands / seconds : 0.0,
+                  micros(0.50), micros(0.90), micros(0.99), static_cast<double>(maxNanos) / 1000.0);
+    out << text;
+}
+
+Server::Server(World &world) : world(world)
+{
+    line.reserve(256);
+}
+
+void Server::stop()
+{
+    stopRequested = 1;
+}
+
+#ifdef __linux__
+
+Server::~Server()
+{
+    for (auto &connection : connections)
+    {
+        if (connection)
+            drop(*connection);
+    }
+    if (listener >= 0)
+        ::close(listener);
+    if (poller >= 0)
+        ::close(poller);
+    if (!socketPath.empty())
+        ::unlink(socketPath.c_str());
+}
+
+bool Server::listen(const std::string &address)
+{
+    // a descriptor per player, so take every one the system allows
+    rlimit files;
+    if (::getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    if (address.compare(0, 5, "unix:") == 0)
+    {
+        sockaddr_un local{};
+        std::string path = address.substr(5);
+        if (path.empty() || path.size() >= sizeof(local.sun_path))
+        {
+            problem = "bad unix socket path '" + path + "'";
+            return false;
+        }
+        local.sun_family = AF_UNIX;
+        std::memcpy(local.sun_path, path.c_str(), path.size() + 1);
+        listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        ::unlink(path.c_str()); // left behind by a server that didn't get to clean up
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+        {
+            problem = "could not bind " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        socketPath = path;
+    }
+    else
+    {
+        // a bare port listens on loopback only, anything wider has to be asked for
+        size_t colon = address.rfind(':');
+        std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+        std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *found = nullptr;
+        if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0 || !found)
+        {
+            problem = "could not resolve '" + address + "'";
+            return false;
+        }
+        listener = ::socket(found->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (listener >= 0)
+            ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        bool bound = listener >= 0 && ::bind(listener, found->ai_addr, found->ai_addrlen) == 0;
+        int error = errno;
+        ::freeaddrinfo(found);
+        if (!bound)
+        {
+            problem = "could not bind " + address + ": " + std::strerror(error);
+            return false;
+        }
+        tcp = true;
+    }
+
+    if (::listen(listener, SOMAXCONN) != 0)
+    {
+        problem = std::string("could not listen: ") + std::strerror(errno);
+        return false;
+    }
+    poller = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    if (poller < 0 || ::epoll_ctl(poller, EPOLL_CTL_ADD, listener, &event) != 0)
+    {
+        problem = std::string("could not create the event loop: ") + std::strerror(errno);
+        return false;
+    }
+    ZLOG(Info, General, "serving " << world.name << " on " << address);
+    return true;
+}
+
+void Server::run()
+{
+    if (poller < 0)
+        return;
+    epoll_event events[256];
+    auto started = std::chrono::steady_clock::now();
+    stopRequested = 0;
+    while (!stopRequested)
+    {
+        // the timeout only bounds how late a stop that landed just before the wait is seen
+        int ready = ::epoll_wait(poller, events, 256, 500);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ZLOG(Error, General, "epoll_wait failed: " << std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < ready; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listener)
+            {
+                accept();
+                continue;
+            }
+            // an earlier event in this batch may have closed it
+            if (static_cast<size_t>(fd) >= connections.size() || !connections[fd])
+                continue;
+            uint32_t what = events[i].events;
+            if (what & EPOLLERR)
+            {
+                drop(*connections[fd]);
+                continue;
+            }
+            if (what & EPOLLOUT)
+                flush(*connections[fd]);
+            // a hang up still has its last input to read, recv returns 0 once that's done
+            if ((what & (EPOLLIN | EPOLLHUP)) && connections[fd])
+                receive(*connections[fd]);
+        }
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    ZLOG(Info, General, "server stopped with " << connected << " connections open");
+}
+
+void Server::accept()
+{
+    while (true)
+    {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                ZLOG(Warn, General, "accept failed: " << std::strerror(errno));
+            return;
+        }
+        if (tcp)
+        {
+            // every answer is one small write, don't hold it back waiting for more
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        if (static_cast<size_t>(fd) >= connections.size())
+            connections.resize(static_cast<size_t>(fd) + 1);
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->game = std::make_unique<Game>(world, std::make_unique<StringSink>(connection->pending));
+        connection->game->setStopOnFailure(stopOnFailure);
+        connection->game->welcome();
+        connection->game->start();
+        connection->pending += kPrompt;
+        connection->events = EPOLLIN;
+
+        epoll_event event{};
+        event.events = connection->events;
+        event.data.fd = fd;
+        if (::epoll_ctl(poller, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            ZLOG(Warn, General, "could not watch connection " << fd << ": " << std::strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        connections[fd] = std::move(connection);
+        ++stats.sessions;
+        stats.peak = std::max(stats.peak, ++connected);
+        ZLOG(Debug, General, "connection " << fd << " opened, " << connected << " open");
+        flush(*connections[fd]);
+    }
+}
+
+void Server::receive(Connection &connection)
+{
+    char buffer[kReadSize];
+    ssize_t got = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if (got < 0)
+    {
+        drop(connection); // broken
+        return;
+    }
+    // the other end has stopped sending, though it may still be reading (shutdown(SHUT_WR)):
+    // a last line needn't end in a newline, and the answers go out before the connection closes
+    bool ended = got == 0;
+    if (!ended)
+        connection.input.append(buffer, static_cast<size_t>(got));
+    else if (!connection.input.empty())
+        connection.input += '\n';
+
+    size_t start = 0;
+    size_t end;
+    while (!connection.closing && (end = connection.input.find('\n', start)) != std::string::npos)
+    {
+        line.assign(connection.input, start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        start = end + 1;
+
+        Game &game = *connection.game;
+        uint64_t commandsBefore = game.getCommandsRun();
+        auto before = std::chrono::steady_clock::now();
+        game.processUInput(line);
+        auto nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                               std::chrono::steady_clock::now() - before)
+                                               .count());
+        stats.latency.add(LatencyHistogram::bucketOf(nanos), 1);
+        stats.maxNanos = std::max(stats.maxNanos, nanos);
+        ++stats.lines;
+        stats.commands += game.getCommandsRun() - commandsBefore;
+
+        if (game.isOver())
+            connection.closing = true; // anything after QUIT is ignored
+        else
+            connection.pending += kPrompt;
+    }
+    connection.input.erase(0, start);
+    if (ended)
+        connection.closing = true;
+    if (connection.input.size() > kMaxLine)
+    {
+        ZLOG(Warn, General, "connection " << connection.fd << " sent a line over " << kMaxLine << " bytes, dropped");
+        drop(connection);
+        return;
+    }
+    flush(connection);
+}
+
+void Server::flush(Connection &connection)
+{
+    while (connection.sent < connection.pending.size())
+    {
+        ssize_t written = ::send(connection.fd, connection.pending.data() + connection.sent,
+                                 connection.pending.size() - connection.sent, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            drop(connection);
+            return;
+        }
+        connection.sent += static_cast<size_t>(written);
+    }
+
+    if (connection.sent == connection.pending.size())
+    {
+        connection.pending.clear(); // keeps its capacity for the next answer
+        connection.sent = 0;
+        if (connection.closing)
+        {
+            drop(connection);
+            return;
+        }
+    }
+    else if (connection.sent > connection.pending.size() / 2)
+    {
+        // a slow reader: don't let what has gone pile up in front of what hasn't
+        connection.pending.erase(0, connection.sent);
+        connection.sent = 0;
+    }
+    watch(connection);
+}
+
+void Server::watch(Connection &connection)
+{
+    uint32_t wanted = 0;
+    if (!connection.closing && connection.pending.size() - connection.sent < kMaxPending)
+        wanted |= EPOLLIN;
+    if (connection.sent < connection.pending.size())
+        wanted |= EPOLLOUT;
+    if (wanted == connection.events)
+        return;
+    epoll_event event{};
+    event.events = wanted;
+    event.data.fd = connection.fd;
+    ::epoll_ctl(poller, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = wanted;
+}
+
+void Server::drop(Connection &connection)
+{
+    int fd = connection.fd;
+    // closing removes it from the epoll set too
+    ::close(fd);
+    connections[fd].reset(); // the session leaves the world here
+    --connected;
+    ZLOG(Debug, General, "connection " << fd << " closed, " << connected << " open");
+}
+
+#else
+
+Server::~Server() = default;
+
+bool Server::listen(const std::string &)
+{
+    problem = "serving needs epoll, which only linux builds have";
+    return false;
+}
+
+void Server::run()
+{
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include "World.h"
+#include "DispatchStats.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// serves one world to many players at once over a socket
+// every connection is its own Game (player, commands, parser and text) in the
+// shared world, so players see each other's doings: what one takes is gone for
+// the rest, and what they carried is dropped where they stood when they leave.
+//
+// one thread runs everything off a level triggered epoll loop with non-blocking
+// sockets, so a command always runs to completion before the next one starts and
+// the world needs no locks. the protocol is plain lines: the server greets a new
+// connection with the welcome, the opening location and a "\n> " prompt, and
+// answers every input line with its text and another prompt. QUIT, dying or the
+// client shutting down its sending side ends the session once its last text has
+// gone out.
+//
+// linux only for now (epoll); elsewhere listen() fails
+class Server
+{
+public:
+    // what the server did while it ran
+    struct Stats
+    {
+        uint64_t sessions = 0; // accepted over the whole run
+        uint64_t peak = 0;     // most connected at once
+        uint64_t lines = 0;
+        uint64_t commands = 0; // a line can hold several
+        double seconds = 0;
+        LatencyHistogram latency; // running each line, in ns, not counting the network
+        uint64_t maxNanos = 0;
+
+        // one summary line, in the style of the batch mode's
+        void report(std::ostream &out) const;
+    };
+
+    explicit Server(World &world);
+    ~Server();
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    // "PORT" (loopback only), "HOST:PORT" or "unix:PATH"; false if it can't, see error()
+    bool listen(const std::string &address);
+    const std::string &error() const { return problem; }
+
+    // see Game::setStopOnFailure, applies to every session
+    void setStopOnFailure(bool stop) { stopOnFailure = stop; }
+
+    // serves until stop() is called, then closes every connection
+    void run();
+    // makes run() return soon; safe to call from a signal handler
+    static void stop();
+
+    const Stats &getStats() const { return stats; }
+
+private:
+    struct Connection;
+
+    void accept();
+    // reads what has arrived and runs every whole line in it
+    void receive(Connection &connection);
+    // sends as much unsent text as the socket takes; closes the connection once a finished session's text is out
+    void flush(Connection &connection);
+    // asks epoll for what the connection is waiting on: input unless too much output is backed up, output while some is unsent
+    void watch(Connection &connection);
+    // closes the connection; it is gone when this returns
+    void drop(Connection &connection);
+
+    World &world;
+    int listener = -1;
+    int poller = -1;
+    bool tcp = false;
+    bool stopOnFailure = false;
+    std::string socketPath; // a unix socket's, removed again on the way out
+    std::string problem;
+    std::vector<std::unique_ptr<Connection>> connections; // indexed by descriptor
+    uint64_t connected = 0;
+    std::string line; // the line being run, reused
+    Stats stats;
+};
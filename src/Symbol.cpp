@@ -0,0 +1,129 @@
+#include "Symbol.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+// ascii lowercase, the same folding the commands have always used
+static std::string foldCase(std::string_view text)
+{
+    std::string folded(text);
+    std::transform(folded.begin(), folded.end(), folded.begin(),
+                   [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return folded;
+}
+
+static bool isFolded(std::string_view text)
+{
+    return std::none_of(text.begin(), text.end(),
+                        [](unsigned char c)
+                        { return std::isupper(c); });
+}
+
+SymbolTable &SymbolTable::instance()
+{
+    static SymbolTable table;
+    return table;
+}
+
+// id 0 is the empty string, so a default constructed Symbol is valid
+SymbolTable::SymbolTable() : owner(std::this_thread::get_id())
+{
+    chunks.reserve(kMaxChunks);
+    insert(std::string_view());
+}
+
+void SymbolTable::checkOwner() const
+{
+    if (std::this_thread::get_id() != owner)
+        throw std::logic_error("the symbol table is only used from the thread that owns it");
+}
+
+Symbol SymbolTable::intern(std::string_view text)
+{
+    checkOwner();
+    ++requests;
+    requestedBytes += text.size();
+
+    auto it = index.find(text);
+    if (it != index.end())
+        return Symbol(it->second);
+    return insert(text);
+}
+
+// adds a new entry, interning its folded form first so the entry can point at it
+Symbol SymbolTable::insert(std::string_view text)
+{
+    bool lowercase = isFolded(text);
+    uint32_t folded = 0;
+    if (!lowercase)
+    {
+        std::string lower = foldCase(text);
+        auto it = index.find(lower);
+        folded = it != index.end() ? it->second : insert(lower).value;
+    }
+
+    uint32_t id = count;
+    if ((id & (kChunkSize - 1)) == 0)
+    {
+        if (chunks.size() == kMaxChunks)
+            throw std::length_error("the symbol table is full");
+        chunks.emplace_back(new Entry[kChunkSize]);
+    }
+    Entry &added = chunks.back()[id & (kChunkSize - 1)];
+    added = {std::string(text), lowercase ? id : folded, std::hash<std::string_view>()(text)};
+    ++count;
+    index.emplace(added.text, id);
+    storedBytes += text.size();
+    return Symbol(id);
+}
+
+Symbol SymbolTable::find(std::string_view text) const
+{
+    checkOwner();
+    auto it = index.find(text);
+    return it != index.end() ? Symbol(it->second) : Symbol();
+}
+
+SymbolTable::Stats SymbolTable::stats() const
+{
+    return {count - size_t(1), storedBytes, requests, requestedBytes};
+}
+
+Symbol::Symbol(std::string_view text) : value(SymbolTable::instance().intern(text).value) {}
+
+Symbol Symbol::find(std::string_view text)
+{
+    return SymbolTable::instance().find(text);
+}
+
+Symbol Symbol::findFolded(std::string_view text)
+{
+    if (isFolded(text))
+        return find(text).folded();
+
+    // names typed by the player are short, fold them on the stack
+    char buffer[64];
+    if (text.size() > sizeof(buffer))
+        return find(foldCase(text)).folded();
+    std::transform(text.begin(), text.end(), buffer,
+                   [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return find(std::string_view(buffer, text.size())).folded();
+}
+
+const std::string &Symbol::str() const
+{
+    return SymbolTable::instance().entry(*this).text;
+}
+
+Symbol Symbol::folded() const
+{
+    return Symbol(SymbolTable::instance().entry(*this).folded);
+}
+
+size_t Symbol::hash() const
+{
+    return SymbolTable::instance().entry(*this).hash;
+}
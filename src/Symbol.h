@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// an interned string, stored and compared as a 32-bit id
+// every distinct string lives once in the process-wide SymbolTable together with
+// its case-folded form and its hash, so equality is an integer compare and a
+// case-insensitive match is a compare of the two folded ids
+class Symbol
+{
+public:
+    // the empty string
+    constexpr Symbol() = default;
+
+    // interns text; explicit so a stray literal never grows the table by accident
+    explicit Symbol(std::string_view text);
+
+    // the symbol for text if it is already interned, the empty symbol otherwise
+    // used for player input, which must not grow the table
+    static Symbol find(std::string_view text);
+
+    // the folded symbol matching text case-insensitively, or the empty symbol
+    // if nothing interned folds to the same string
+    static Symbol findFolded(std::string_view text);
+
+    const std::string &str() const;
+    Symbol folded() const;     // lowercase form, itself interned
+    size_t hash() const;       // std::hash of str(), computed once at intern time
+
+    // case-insensitive equality
+    bool matches(Symbol other) const { return folded() == other.folded(); }
+
+    constexpr uint32_t id() const { return value; }
+    constexpr bool empty() const { return value == 0; }
+
+    constexpr bool operator==(Symbol other) const { return value == other.value; }
+    constexpr bool operator!=(Symbol other) const { return value != other.value; }
+
+private:
+    friend class SymbolTable;
+    constexpr explicit Symbol(uint32_t value) : value(value) {}
+
+    uint32_t value = 0;
+};
+
+// the process-wide string table behind Symbol
+//
+// threads: the table belongs to the thread that first used it. only that thread
+// may intern or find (Symbol(text), Symbol::find, Symbol::findFolded), the others
+// get a std::logic_error; the loader only interns during its serial build pass.
+// reading a symbol (str, folded, hash) is safe from any thread that got the
+// symbol from the owner through something that synchronises, e.g. a message
+// sent over a MessageBus: entries are never moved or changed once added.
+class SymbolTable
+{
+public:
+    static SymbolTable &instance();
+
+    // owner thread only
+    Symbol intern(std::string_view text);
+    Symbol find(std::string_view text) const;
+
+    // how much interning saved, for the loader's log
+    struct Stats
+    {
+        size_t symbols;        // distinct strings stored
+        size_t storedBytes;    // bytes of text actually stored
+        size_t requests;       // intern calls
+        size_t requestedBytes; // bytes of text passed to intern
+    };
+    Stats stats() const;
+
+private:
+    friend class Symbol;
+
+    struct Entry
+    {
+        std::string text;
+        uint32_t folded; // id of the lowercase form (its own id if already lowercase)
+        size_t hash;
+    };
+
+    // entries live in fixed chunks that are never moved, and the chunk list is
+    // reserved up front so it never reallocates either
+    static constexpr size_t kChunkBits = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    static constexpr size_t kMaxChunks = (size_t(1) << 32) >> kChunkBits;
+
+    SymbolTable();
+    Symbol insert(std::string_view text);
+    const Entry &entry(Symbol symbol) const { return chunks[symbol.value >> kChunkBits][symbol.value & (kChunkSize - 1)]; }
+    // throws unless called on the owner thread
+    void checkOwner() const;
+
+    std::vector<std::unique_ptr<Entry[]>> chunks;          // see kChunkBits
+    uint32_t count = 0;                                    // entries in use
+    std::unordered_map<std::string_view, uint32_t> index;  // views into entries
+    std::thread::id owner;                                 // the thread that built the table
+    size_t storedBytes = 0;
+    size_t requests = 0;
+    size_t requestedBytes = 0;
+};
+
+// hashes match std::hash<std::string> of the text, so containers keyed by
+// Symbol iterate in the same order as the string keyed ones they replace
+template <>
+struct std::hash<Symbol>
+{
+    size_t operator()(Symbol symbol) const noexcept { return symbol.hash(); }
+};
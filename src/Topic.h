@@ -0,0 +1,38 @@
+#pragma once
+#include "Component.h"
+#include "Message.h"
+#include <cstdint>
+
+// a group of recipients that one MessageDispatcher::publish reaches
+// the kind sits in the top byte of the key so topics of different kinds never collide.
+// the loader and the handlers keep no topics up to date, a caller that wants to
+// broadcast subscribes the recipients it means to reach
+class Topic
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Location,  // the top level entities of a location, by location number
+        Container, // the contents of a container, by the container's id
+        Component  // every entity with a component type
+    };
+
+    static constexpr Topic location(int number) { return Topic(Kind::Location, static_cast<uint32_t>(number)); }
+    static constexpr Topic container(EntityId id) { return Topic(Kind::Container, id); }
+    static constexpr Topic component(ComponentType type) { return Topic(Kind::Component, static_cast<uint64_t>(type)); }
+
+    constexpr Kind kind() const { return static_cast<Kind>(bits >> kKindShift); }
+    constexpr uint64_t key() const { return bits; }
+
+    constexpr bool operator==(Topic other) const { return bits == other.bits; }
+    constexpr bool operator!=(Topic other) const { return bits != other.bits; }
+
+private:
+    static constexpr unsigned kKindShift = 56;
+    static constexpr uint64_t kValueMask = (uint64_t(1) << kKindShift) - 1;
+
+    constexpr Topic(Kind kind, uint64_t value)
+        : bits((static_cast<uint64_t>(kind) << kKindShift) | (value & kValueMask)) {}
+
+    uint64_t bits;
+};
@@ -0,0 +1,238 @@
+#include "Trace.h"
+#include "Log.h"
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kWriteBuffer = 1 << 16;
+
+    uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+    int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+}
+
+TraceWriter::TraceWriter(const std::string &filename, std::string_view worldPath, uint8_t dispatchMode, uint8_t flags)
+{
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        ZLOG(Error, General, "could not open trace file " << filename);
+        return;
+    }
+    buffer.reset(new char[kWriteBuffer]);
+    std::setvbuf(file, buffer.get(), _IOFBF, kWriteBuffer);
+    record.reserve(256);
+
+    record.append(ztr::kMagic, sizeof(ztr::kMagic));
+    for (int i = 0; i < 4; ++i)
+        record.push_back(static_cast<char>((ztr::kVersion >> (i * 8)) & 0xFF));
+    record.push_back(static_cast<char>(dispatchMode));
+    record.push_back(static_cast<char>(flags));
+    varint(worldPath.size());
+    record.append(worldPath);
+    write();
+}
+
+TraceWriter::~TraceWriter()
+{
+    if (file)
+        std::fclose(file);
+}
+
+void TraceWriter::input(std::string_view line)
+{
+    if (!file)
+        return;
+    record.push_back(static_cast<char>(ztr::Tag::Input));
+    varint(line.size());
+    record.append(line);
+    write();
+}
+
+void TraceWriter::message(const Message &message)
+{
+    if (!file)
+        return;
+    record.push_back(static_cast<char>(ztr::Tag::Message));
+    record.push_back(static_cast<char>(message.opcode));
+    varint(message.from);
+    varint(message.to);
+    record.push_back(static_cast<char>(message.data.getKind()));
+    switch (message.data.getKind())
+    {
+    case Payload::Kind::Int:
+        varint(zigzag(message.data.asInt()));
+        break;
+    case Payload::Kind::Entity:
+        varint(message.data.asEntity().raw());
+        break;
+    case Payload::Kind::Symbol:
+    {
+        const std::string &text = message.data.asSymbol().str();
+        varint(text.size());
+        record.append(text);
+        break;
+    }
+    case Payload::Kind::None:
+        break;
+    }
+    write();
+}
+
+void TraceWriter::fixed(ztr::Tag tag, uint64_t value)
+{
+    if (!file)
+        return;
+    record.push_back(static_cast<char>(tag));
+    for (int i = 0; i < 8; ++i)
+        record.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    write();
+}
+
+void TraceWriter::flush()
+{
+    if (file)
+        std::fflush(file);
+}
+
+void TraceWriter::varint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        record.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    record.push_back(static_cast<char>(value));
+}
+
+void TraceWriter::write()
+{
+    if (std::fwrite(record.data(), 1, record.size(), file) != record.size())
+    {
+        ZLOG(Error, General, "trace write failed, recording stopped");
+        std::fclose(file);
+        file = nullptr;
+    }
+    record.clear();
+}
+
+TraceReader::TraceReader(const std::string &filename) : file(filename)
+{
+    if (!file.isOpen())
+    {
+        problem = "could not open " + filename;
+        return;
+    }
+    bytes = file.view();
+    if (bytes.size() < sizeof(ztr::kMagic) + 5 || std::memcmp(bytes.data(), ztr::kMagic, sizeof(ztr::kMagic)) != 0)
+    {
+        problem = filename + " is not a trace";
+        return;
+    }
+    at = sizeof(ztr::kMagic);
+    uint32_t version = 0;
+    for (int i = 0; i < 4; ++i)
+        version |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[at++])) << (i * 8);
+    if (version == 0 || version > ztr::kVersion)
+    {
+        problem = filename + " is trace version " + std::to_string(version) + ", expected " + std::to_string(ztr::kVersion);
+        return;
+    }
+    // version 1 traces have no session flags
+    if (!byte(mode) || (version >= 2 && !byte(sessionFlags)) || !text(world))
+    {
+        problem = filename + " has a damaged header";
+        return;
+    }
+    open = true;
+}
+
+bool TraceReader::next(TraceRecord &record)
+{
+    uint8_t tag;
+    if (!open || !byte(tag))
+        return false;
+    record.tag = static_cast<ztr::Tag>(tag);
+    record.text = {};
+    switch (record.tag)
+    {
+    case ztr::Tag::Input:
+        return text(record.text);
+    case ztr::Tag::Message:
+    {
+        uint8_t opcode, kind;
+        uint64_t value;
+        Message &message = record.message;
+        message = Message{};
+        if (!byte(opcode) || !varint(message.from) || !varint(message.to) || !byte(kind))
+            return false;
+        message.opcode = static_cast<Opcode>(opcode);
+        switch (static_cast<Payload::Kind>(kind))
+        {
+        case Payload::Kind::Int:
+            if (!varint(value))
+                return false;
+            message.data = static_cast<int>(unzigzag(value));
+            return true;
+        case Payload::Kind::Entity:
+            if (!varint(value))
+                return false;
+            message.data = EntityHandle(static_cast<uint32_t>(value) & EntityHandle::kIndexMask,
+                                        static_cast<uint32_t>(value) >> EntityHandle::kIndexBits);
+            return true;
+        case Payload::Kind::Symbol:
+            return text(record.text);
+        case Payload::Kind::None:
+            return true;
+        }
+        return false;
+    }
+    case ztr::Tag::Output:
+    case ztr::Tag::World:
+        return fixed(record.digest);
+    }
+    problem = "unknown record at byte " + std::to_string(at - 1);
+    return false;
+}
+
+bool TraceReader::byte(uint8_t &value)
+{
+    if (at >= bytes.size())
+        return false;
+    value = static_cast<uint8_t>(bytes[at++]);
+    return true;
+}
+
+bool TraceReader::varint(uint64_t &value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t part;
+        if (!byte(part))
+            return false;
+        value |= static_cast<uint64_t>(part & 0x7F) << shift;
+        if (!(part & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool TraceReader::text(std::string_view &value)
+{
+    uint64_t length;
+    if (!varint(length) || length > bytes.size() - at)
+        return false;
+    value = bytes.substr(at, static_cast<size_t>(length));
+    at += static_cast<size_t>(length);
+    return true;
+}
+
+bool TraceReader::fixed(uint64_t &value)
+{
+    if (bytes.size() - at < 8)
+        return false;
+    value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[at++])) << (i * 8);
+    return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "MappedFile.h"
+#include "Message.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// binary session traces (.ztr)
+// a trace is a header followed by one record per event, in the order they happened:
+// every input line the game was given, every message sent while handling it, a
+// digest of the text it printed, and a digest of the world at the end.
+// numbers are LEB128 varints, so a typical message record is 5 or 6 bytes.
+//
+//   header   "ZTR\0", u32 version, u8 dispatch mode, u8 session flags (from version 2),
+//            varint length + world path
+//   'I'      varint length + input line
+//   'M'      u8 opcode, varint from, varint to, u8 payload kind, payload
+//            (int: zigzag varint, entity: varint handle, symbol: varint length + text)
+//   'O'      u64 digest of one input line's output
+//   'D'      u64 digest of the world state, written when the session ends
+namespace ztr
+{
+    constexpr char kMagic[4] = {'Z', 'T', 'R', '\0'};
+    constexpr uint32_t kVersion = 2;
+
+    // session flags, settings a session plays out differently under
+    constexpr uint8_t kStopOnFailure = 1;
+
+    enum class Tag : uint8_t
+    {
+        Input = 'I',
+        Message = 'M',
+        Output = 'O',
+        World = 'D'
+    };
+
+    // 64-bit FNV-1a, for the output and world digests
+    constexpr uint64_t kDigestSeed = 14695981039346656037ull;
+    inline uint64_t digest(std::string_view bytes, uint64_t hash = kDigestSeed)
+    {
+        for (unsigned char c : bytes)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+    inline uint64_t digest(uint64_t value, uint64_t hash = kDigestSeed)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+// appends records to a trace file
+// writes go through a large stdio buffer, which exit() flushes too
+class TraceWriter
+{
+public:
+    TraceWriter(const std::string &filename, std::string_view worldPath, uint8_t dispatchMode, uint8_t flags);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+
+    void input(std::string_view line);
+    void message(const Message &message);
+    void output(uint64_t digest) { fixed(ztr::Tag::Output, digest); }
+    void world(uint64_t digest) { fixed(ztr::Tag::World, digest); }
+    void flush();
+
+private:
+    void varint(uint64_t value);
+    void fixed(ztr::Tag tag, uint64_t value);
+    void write();
+
+    std::FILE *file = nullptr;
+    std::unique_ptr<char[]> buffer; // stdio buffer
+    std::string record;             // the record being built, reused
+};
+
+// one record read back from a trace
+// text points into the mapped file: the input line, or a message's symbol payload
+struct TraceRecord
+{
+    ztr::Tag tag;
+    std::string_view text;
+    Message message;  // for Message records; a symbol payload is left empty, see text
+    uint64_t digest;  // for Output and World records
+};
+
+// reads a trace straight out of a memory mapping
+class TraceReader
+{
+public:
+    explicit TraceReader(const std::string &filename);
+
+    // false if the file is missing or its header is wrong, see error()
+    bool isOpen() const { return open; }
+    const std::string &error() const { return problem; }
+
+    std::string_view worldPath() const { return world; }
+    uint8_t dispatchMode() const { return mode; }
+    uint8_t flags() const { return sessionFlags; }
+
+    // the next record, false at the end of the trace or if it is cut short
+    bool next(TraceRecord &record);
+
+    // how far through the file reading has got, and how long it is, in bytes
+    size_t position() const { return at; }
+    size_t size() const { return bytes.size(); }
+
+private:
+    bool varint(uint64_t &value);
+    bool byte(uint8_t &value);
+    bool text(std::string_view &value);
+    bool fixed(uint64_t &value);
+
+    MappedFile file;
+    std::string_view bytes;
+    size_t at = 0;
+    bool open = false;
+    std::string problem;
+    std::string_view world;
+    uint8_t mode = 0;
+    uint8_t sessionFlags = 0;
+};
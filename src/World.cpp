@@ -0,0 +1,26 @@
+#include "World.h"
+#include "WorldImage.h"
+#include "Log.h"
+#include <filesystem>
+
+World::World()
+{
+    dispatcher.setMode(MessageDispatcher::Mode::Queued); // drained once per command, see Game::processUInput
+}
+
+void World::load(const std::string &filename, unsigned loaderThreads)
+{
+    ZLOG(Info, General, "loading adventure file: " << filename);
+    file = filename;
+    name = std::filesystem::path(filename).stem().string();
+    graph.setLoaderThreads(loaderThreads);
+    if (WorldImage::isImagePath(filename))
+    {
+        graph.loadFromBinary(filename); // precompiled by zorkc
+    }
+    else
+    {
+        graph.loadFromFile(filename);
+    }
+    ZLOG(Info, General, "adventure file loaded");
+}
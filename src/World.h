@@ -0,0 +1,22 @@
+#pragma once
+#include "Graph.h"
+#include "MessageDispatcher.h"
+#include <string>
+
+// everything the players of one world share: the map, the entities in it and the
+// dispatcher they talk through. a single player game owns its world; a server
+// loads one and every connection plays in it (see Game's constructors)
+struct World
+{
+    World();
+    World(const World &) = delete;
+    World &operator=(const World &) = delete;
+
+    // loads a text world or a .zwb image; loaderThreads > 1 tokenizes text in parallel (0 = one per core)
+    void load(const std::string &filename, unsigned loaderThreads = 1);
+
+    MessageDispatcher dispatcher;
+    Graph graph{dispatcher};
+    std::string name; // shown in the welcome, the file name without its extension
+    std::string file; // the path it was loaded from, named in traces
+};
@@ -0,0 +1,240 @@
+#include "WorldImage.h"
+#include "ComponentRegistry.h"
+#include "Graph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // checks that a section of count records starting at offset lies inside the file
+    template <typename T>
+    bool sectionFits(std::string_view bytes, uint32_t offset, uint32_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "image records must be plain data");
+        if (offset % alignof(T) != 0 || offset > bytes.size())
+            return false;
+        return (bytes.size() - offset) / sizeof(T) >= count;
+    }
+
+    // accumulates the sections of an image while walking a Graph
+    class ImageBuilder
+    {
+    public:
+        explicit ImageBuilder(const Graph &graph) : graph(graph)
+        {
+            // sorting by id keeps the output stable regardless of hash map order
+            std::vector<int> ids;
+            ids.reserve(graph.locations.size());
+            for (const auto &[id, location] : graph.locations)
+                ids.push_back(id);
+            std::sort(ids.begin(), ids.end());
+
+            for (int id : ids)
+            {
+                const auto &location = graph.locations.at(id);
+                zwb::LocationRecord record{};
+                record.id = id;
+                record.name = intern(location->name.str());
+                record.description = intern(location->description.str());
+                record.firstConnection = static_cast<uint32_t>(connections.size());
+                for (const auto &[direction, target] : location->connections)
+                {
+                    if (target)
+                        connections.push_back({intern(direction.str()), target->number});
+                }
+                record.connectionCount = static_cast<uint32_t>(connections.size()) - record.firstConnection;
+                addList(location->getEntities(), record.firstChild, record.childCount);
+                locations.push_back(record);
+            }
+        }
+
+        bool write(const std::string &filename) const
+        {
+            zwb::Header header{};
+            std::memcpy(header.magic, zwb::kMagic, sizeof(header.magic));
+            header.version = zwb::kVersion;
+            header.byteOrder = zwb::kByteOrderMark;
+
+            uint32_t offset = sizeof(zwb::Header);
+            header.stringCount = static_cast<uint32_t>(stringRefs.size());
+            header.stringsOffset = offset;
+            offset += static_cast<uint32_t>(stringRefs.size() * sizeof(zwb::StringRef));
+            header.locationCount = static_cast<uint32_t>(locations.size());
+            header.locationsOffset = offset;
+            offset += static_cast<uint32_t>(locations.size() * sizeof(zwb::LocationRecord));
+            header.connectionCount = static_cast<uint32_t>(connections.size());
+            header.connectionsOffset = offset;
+            offset += static_cast<uint32_t>(connections.size() * sizeof(zwb::ConnectionRecord));
+            header.entityCount = static_cast<uint32_t>(entities.size());
+            header.entitiesOffset = offset;
+            offset += static_cast<uint32_t>(entities.size() * sizeof(zwb::EntityRecord));
+            header.childCount = static_cast<uint32_t>(children.size());
+            header.childrenOffset = offset;
+            offset += static_cast<uint32_t>(children.size() * sizeof(uint32_t));
+            header.stringBytesOffset = offset;
+            header.stringBytesSize = static_cast<uint32_t>(stringBytes.size());
+
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            writeSection(out, &header, 1);
+            writeSection(out, stringRefs.data(), stringRefs.size());
+            writeSection(out, locations.data(), locations.size());
+            writeSection(out, connections.data(), connections.size());
+            writeSection(out, entities.data(), entities.size());
+            writeSection(out, children.data(), children.size());
+            out.write(stringBytes.data(), static_cast<std::streamsize>(stringBytes.size()));
+            return static_cast<bool>(out);
+        }
+
+    private:
+        template <typename T>
+        static void writeSection(std::ofstream &out, const T *data, size_t count)
+        {
+            out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(count * sizeof(T)));
+        }
+
+        // stores each distinct string once and returns its index
+        uint32_t intern(const std::string &str)
+        {
+            auto it = stringIndex.find(str);
+            if (it != stringIndex.end())
+                return it->second;
+            uint32_t index = static_cast<uint32_t>(stringRefs.size());
+            stringRefs.push_back({static_cast<uint32_t>(stringBytes.size()), static_cast<uint32_t>(str.size())});
+            stringBytes += str;
+            stringIndex.emplace(str, index);
+            return index;
+        }
+
+        // reserves a contiguous block in the children array, then fills it
+        // nested contents get their own blocks appended after this one
+        void addList(const std::vector<EntityHandle> &list, uint32_t &first, uint32_t &count)
+        {
+            first = static_cast<uint32_t>(children.size());
+            count = static_cast<uint32_t>(list.size());
+            children.resize(children.size() + list.size());
+            for (uint32_t i = 0; i < count; ++i)
+                children[first + i] = addEntity(*graph.entities.get(list[i]));
+        }
+
+        uint32_t addEntity(const Entity &entity)
+        {
+            zwb::EntityRecord record{};
+            record.name = intern(entity.getName());
+            record.description = intern(entity.getDescription());
+            record.properties = intern(ComponentRegistry::instance().describe(entity));
+
+            uint32_t index = static_cast<uint32_t>(entities.size());
+            entities.push_back(record);
+            if (entity.getComponent<ContainerComponent>())
+            {
+                // entities may grow while recursing so the record is patched by index
+                uint32_t first = 0, count = 0;
+                addList(entity.getContainedEntities(), first, count);
+                entities[index].firstChild = first;
+                entities[index].childCount = count;
+            }
+            return index;
+        }
+
+        const Graph &graph; // resolves entity handles while walking
+        std::unordered_map<std::string, uint32_t> stringIndex;
+        std::vector<zwb::StringRef> stringRefs;
+        std::string stringBytes;
+        std::vector<zwb::LocationRecord> locations;
+        std::vector<zwb::ConnectionRecord> connections;
+        std::vector<zwb::EntityRecord> entities;
+        std::vector<uint32_t> children;
+    };
+}
+
+// maps the image and checks every section against the file size
+WorldImage::WorldImage(const std::string &filename) : file(filename)
+{
+    if (!file.isOpen())
+    {
+        errorMessage = "could not open " + filename;
+        return;
+    }
+    if (!validate())
+        header = nullptr;
+}
+
+bool WorldImage::validate()
+{
+    std::string_view bytes = file.view();
+    if (bytes.size() < sizeof(zwb::Header))
+    {
+        errorMessage = "file too small for a world image";
+        return false;
+    }
+
+    header = reinterpret_cast<const zwb::Header *>(bytes.data());
+    if (std::memcmp(header->magic, zwb::kMagic, sizeof(header->magic)) != 0)
+    {
+        errorMessage = "not a world image";
+        return false;
+    }
+    if (header->byteOrder != zwb::kByteOrderMark)
+    {
+        errorMessage = "world image was written with a different byte order";
+        return false;
+    }
+    if (header->version != zwb::kVersion)
+    {
+        errorMessage = "unsupported world image version " + std::to_string(header->version);
+        return false;
+    }
+    if (!sectionFits<zwb::StringRef>(bytes, header->stringsOffset, header->stringCount) ||
+        !sectionFits<char>(bytes, header->stringBytesOffset, header->stringBytesSize) ||
+        !sectionFits<zwb::LocationRecord>(bytes, header->locationsOffset, header->locationCount) ||
+        !sectionFits<zwb::ConnectionRecord>(bytes, header->connectionsOffset, header->connectionCount) ||
+        !sectionFits<zwb::EntityRecord>(bytes, header->entitiesOffset, header->entityCount) ||
+        !sectionFits<uint32_t>(bytes, header->childrenOffset, header->childCount))
+    {
+        errorMessage = "world image is truncated";
+        return false;
+    }
+
+    strings = reinterpret_cast<const zwb::StringRef *>(bytes.data() + header->stringsOffset);
+    stringBytes = bytes.data() + header->stringBytesOffset;
+    locations = reinterpret_cast<const zwb::LocationRecord *>(bytes.data() + header->locationsOffset);
+    connections = reinterpret_cast<const zwb::ConnectionRecord *>(bytes.data() + header->connectionsOffset);
+    entities = reinterpret_cast<const zwb::EntityRecord *>(bytes.data() + header->entitiesOffset);
+    children = reinterpret_cast<const uint32_t *>(bytes.data() + header->childrenOffset);
+
+    for (uint32_t i = 0; i < header->stringCount; ++i)
+    {
+        if (strings[i].offset > header->stringBytesSize || header->stringBytesSize - strings[i].offset < strings[i].length)
+        {
+            errorMessage = "world image has a corrupt string table";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view WorldImage::string(uint32_t index) const
+{
+    if (index >= header->stringCount)
+        return {};
+    return std::string_view(stringBytes + strings[index].offset, strings[index].length);
+}
+
+bool WorldImage::write(const Graph &graph, const std::string &filename)
+{
+    return ImageBuilder(graph).write(filename);
+}
+
+bool WorldImage::isImagePath(const std::string &filename)
+{
+    constexpr std::string_view extension = ".zwb";
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class Graph;
+
+// compiled world image (.zwb)
+// produced offline by tools/zorkc from the text format read by Graph::loadFromFile
+// every section is a flat array of fixed size records so the file can be used
+// straight from a memory mapping without any parsing
+namespace zwb
+{
+    constexpr char kMagic[4] = {'Z', 'W', 'B', '\0'};
+    constexpr uint32_t kVersion = 2;
+    constexpr uint32_t kByteOrderMark = 0x01020304; // catches images written on other endianness
+
+    // offsets are in bytes from the start of the file, counts are in records
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t stringCount;
+        uint32_t stringsOffset;     // StringRef[stringCount]
+        uint32_t stringBytesOffset; // raw characters referenced by StringRef
+        uint32_t stringBytesSize;
+        uint32_t locationCount;
+        uint32_t locationsOffset;   // LocationRecord[locationCount]
+        uint32_t connectionCount;
+        uint32_t connectionsOffset; // ConnectionRecord[connectionCount]
+        uint32_t entityCount;
+        uint32_t entitiesOffset;    // EntityRecord[entityCount]
+        uint32_t childCount;
+        uint32_t childrenOffset;    // uint32_t entity indices
+    };
+
+    struct StringRef
+    {
+        uint32_t offset; // into the string bytes section
+        uint32_t length;
+    };
+
+    struct LocationRecord
+    {
+        int32_t id;
+        uint32_t name;            // string index
+        uint32_t description;     // string index
+        uint32_t firstConnection; // range into the connection array
+        uint32_t connectionCount;
+        uint32_t firstChild;      // range into the children array (top-level entities)
+        uint32_t childCount;
+    };
+
+    struct ConnectionRecord
+    {
+        uint32_t direction; // string index
+        int32_t target;     // location id
+    };
+
+    // components are stored as the property list ComponentRegistry::describe
+    // writes, so any registered component survives the image without a field here
+    struct EntityRecord
+    {
+        uint32_t name;        // string index
+        uint32_t description; // string index
+        uint32_t properties;  // string index, e.g. "Takeable, Lockable=key"
+        uint32_t firstChild;  // range into the children array (container contents)
+        uint32_t childCount;
+    };
+}
+
+// read-only view over a mapped .zwb file
+class WorldImage
+{
+public:
+    explicit WorldImage(const std::string &filename);
+
+    // true if the file mapped and its header checks out
+    bool isValid() const { return header != nullptr; }
+    // reason the image was rejected, empty when valid
+    const std::string &error() const { return errorMessage; }
+
+    const zwb::Header &getHeader() const { return *header; }
+    std::string_view string(uint32_t index) const;
+    const zwb::LocationRecord &location(uint32_t index) const { return locations[index]; }
+    const zwb::ConnectionRecord &connection(uint32_t index) const { return connections[index]; }
+    const zwb::EntityRecord &entity(uint32_t index) const { return entities[index]; }
+    uint32_t child(uint32_t index) const { return children[index]; }
+
+    // compiles an in-memory world into an image file, returns false on io failure
+    static bool write(const Graph &graph, const std::string &filename);
+
+    // true if the path looks like a compiled world
+    static bool isImagePath(const std::string &filename);
+
+private:
+    bool validate();
+
+    MappedFile file;
+    std::string errorMessage;
+    const zwb::Header *header = nullptr;
+    const zwb::StringRef *strings = nullptr;
+    const char *stringBytes = nullptr;
+    const zwb::LocationRecord *locations = nullptr;
+    const zwb::ConnectionRecord *connections = nullptr;
+    const zwb::EntityRecord *entities = nullptr;
+    const uint32_t *children = nullptr;
+};
@@ -1,28 +1,231 @@
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <cstdlib>
+#include <csignal>
 #include "Game.h"
+#include "Log.h"
+#include "DispatchStats.h"
+#include "Trace.h"
+#include "Server.h"
 
 // To compile (if you’re using cl.exe from MSVC):
 //  Navigate to the Zorkish_Adventure/src (directory) in your CLI terminal
 //  Run: cl /EHsc /std:c++17 *.cpp /link /out:Zorkish.exe
+// Usage: Zorkish.exe [--threads N] [--log SETTING] [--output FILE] [--dispatch MODE] [--stats FILE] [--stats-sample N]
+//        [--trace FILE | --replay FILE | --batch SCRIPT | --serve ADDRESS] [--stop-on-failure] [world file]
+//  the world can be a text file or a .zwb image compiled with tools/zorkc
+//  --threads tokenizes text worlds on N threads (0 = one per core, default 1); fewer only
+//   when the world has fewer locations than N, which is logged
+//  --output appends game text to FILE instead of the terminal ("none" to discard it)
+//  --dispatch queued (default) runs messages after each command, direct runs them as they are sent,
+//   bus is queued plus a lock-free MessageBus that other threads can post into; the game
+//   thread drains it, there are no consumer threads
+//  --stats writes message counts and latencies to FILE on exit, nothing is written without it;
+//   the in-game STATS command shows the same figures either way
+//  --stats-sample times one message delivery in N for the latency figures (default 256, 1 = all)
+//  --trace records the session (input, messages, output and final world digests) to FILE
+//  --replay re-runs a recorded session as fast as it can without any game text, checks
+//   that it plays out identically and exits with 0 if it did; the world defaults to the traced one
+//  --batch runs the commands in SCRIPT ("-" for stdin) with no prompts, then prints commands/s
+//   and per-command latency percentiles to stderr
+//  --serve plays the world with every client that connects to ADDRESS, each as their own player,
+//   until interrupted; ADDRESS is PORT (loopback), HOST:PORT or unix:PATH, linux only.
+//   tools/zorkload drives it with thousands of sessions
+//  --stop-on-failure skips the rest of a "cmd; cmd; cmd" line once one of them fails
+//  --log sets diagnostic output, e.g. "--log debug" or "--log dispatch=trace" (repeatable)
+// exits with 0 when the input ends or the player quits, 3 on game over, 1 on errors
 
-int main()
+int main(int argc, char *argv[])
 {
-    //todo: remove debugging from program (commentout)
-    std::string filename = "../world/example_world.txt"; 
+    std::string filename;
+    unsigned loaderThreads = 1;
+    std::string transcript;
+    MessageDispatcher::Mode dispatchMode = MessageDispatcher::Mode::Queued;
+    std::string statsFile;
+    std::string traceFile, replayFile, batchFile, serveAddress;
+    bool stopOnFailure = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            loaderThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            transcript = argv[++i];
+        }
+        else if (arg == "--dispatch" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode != "queued" && mode != "direct" && mode != "bus")
+            {
+                std::cerr << "Error: unknown dispatch mode '" << mode << "'" << std::endl;
+                return 1;
+            }
+            dispatchMode = mode == "direct" ? MessageDispatcher::Mode::Direct
+                           : mode == "bus"  ? MessageDispatcher::Mode::Bus
+                                            : MessageDispatcher::Mode::Queued;
+        }
+        else if (arg == "--stats" && i + 1 < argc)
+        {
+            statsFile = argv[++i];
+            if (statsFile == "none") // what turned the old default file off
+                statsFile.clear();
+        }
+        else if (arg == "--stats-sample" && i + 1 < argc)
+        {
+            DispatchStats::setSampleInterval(static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFile = argv[++i];
+        }
+        else if (arg == "--batch" && i + 1 < argc)
+        {
+            batchFile = argv[++i];
+        }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            serveAddress = argv[++i];
+        }
+        else if (arg == "--stop-on-failure")
+        {
+            stopOnFailure = true;
+        }
+        else if (arg == "--log" && i + 1 < argc)
+        {
+            if (!Log::configure(argv[++i]))
+            {
+                std::cerr << "Error: unknown log setting '" << argv[i] << "'" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            filename = arg;
+        }
+    }
+
+    std::unique_ptr<TraceReader> replay;
+    if (!replayFile.empty())
+    {
+        replay = std::make_unique<TraceReader>(replayFile);
+        if (!replay->isOpen())
+        {
+            std::cerr << "Error: " << replay->error() << std::endl;
+            return 1;
+        }
+        if (filename.empty())
+            filename = std::string(replay->worldPath());
+        // the recorded message order depends on the mode it was recorded in
+        dispatchMode = static_cast<MessageDispatcher::Mode>(replay->dispatchMode());
+        stopOnFailure = (replay->flags() & ztr::kStopOnFailure) != 0;
+    }
+    if (filename.empty())
+        filename = "../world/example_world.txt";
     if (!std::filesystem::exists(filename))
     {
         std::cerr << "Error: File not found at path: " << filename << std::endl;
         return 1;
     }
 
+    if (!serveAddress.empty())
+    {
+        if (replay || !traceFile.empty() || !batchFile.empty() || !transcript.empty())
+        {
+            std::cerr << "Error: --serve plays sessions over the network, it can't be combined with --trace, --replay, --batch or --output" << std::endl;
+            return 1;
+        }
+        try
+        {
+            // the world goes before the server, whose sessions are players in it
+            World world;
+            world.load(filename, loaderThreads);
+            world.dispatcher.setMode(dispatchMode);
+            Server server(world);
+            server.setStopOnFailure(stopOnFailure);
+            if (!server.listen(serveAddress))
+            {
+                std::cerr << "Error: " << server.error() << std::endl;
+                return 1;
+            }
+            DispatchStats::writeOnExit(statsFile);
+            std::signal(SIGINT, [](int)
+                        { Server::stop(); });
+            std::signal(SIGTERM, [](int)
+                        { Server::stop(); });
+            std::cerr << "serving " << world.name << " on " << serveAddress << ", interrupt to stop" << std::endl;
+            server.run();
+            server.getStats().report(std::cerr);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "An error occurred: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     try
     {
-        std::cout << "Initialising game with file: " << filename << std::endl;
-        Game game(filename);
-        std::cout << "Game initialized successfully." << std::endl;
-        game.run();
-        std::cout << "Game loop ended." << std::endl;
+        ZLOG(Info, General, "initialising game with file: " << filename);
+        Game game(filename, loaderThreads);
+        game.dispatcher.setMode(dispatchMode);
+        game.setStopOnFailure(stopOnFailure);
+        DispatchStats::writeOnExit(statsFile);
+        if (replay)
+            return game.replay(*replay, std::cout) ? 0 : 2;
+        if (!traceFile.empty() && !game.startTrace(traceFile))
+        {
+            std::cerr << "Error: could not open trace file " << traceFile << std::endl;
+            return 1;
+        }
+        if (transcript == "none")
+        {
+            game.setOutputSink(std::make_unique<NullSink>());
+        }
+        else if (!transcript.empty())
+        {
+            auto sink = std::make_unique<FileSink>(transcript);
+            if (!sink->isOpen())
+            {
+                std::cerr << "Error: could not open output file " << transcript << std::endl;
+                return 1;
+            }
+            game.setOutputSink(std::move(sink));
+        }
+        ZLOG(Info, General, "game initialized successfully");
+        Game::Status status;
+        if (!batchFile.empty())
+        {
+            std::ifstream file;
+            if (batchFile != "-")
+            {
+                file.open(batchFile);
+                if (!file)
+                {
+                    std::cerr << "Error: could not open script " << batchFile << std::endl;
+                    return 1;
+                }
+            }
+            Game::BatchResult result = game.runBatch(batchFile == "-" ? std::cin : file);
+            game.output.flush();
+            result.report(std::cerr);
+            status = result.status;
+        }
+        else
+        {
+            status = game.run();
+        }
+        ZLOG(Info, General, "game loop ended");
+        if (status == Game::Status::GameOver)
+            return 3;
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,1925 @@
+#include "../src/CommandManager.h"
+#include "../src/ComponentRegistry.h"
+#include "../src/EntityPool.h"
+#include "../src/Game.h"
+#include "../src/Graph.h"
+#include "../src/MessageBus.h"
+#include "../src/MessageDispatcher.h"
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// zorkbench - measures the speedups the loader, component, dispatch and command
+// table changes claim, each against a copy of the code it replaced, and what the
+// message bus delivers from many threads
+//
+// the replaced code no longer exists in src, so each benchmark carries a faithful
+// copy of the old algorithm (marked "legacy") minus its console chatter, which
+// would only have made it look slower still.
+//
+// To compile (linux, each loader runs in a forked child so its peak memory is its own):
+//  Navigate to the Zorkish_Adventure/tools (directory) in your CLI terminal
+//  Run: g++ -O2 -std=c++17 -pthread zorkbench.cpp $(ls ../src/*.cpp | grep -v main.cpp) -o zorkbench
+//
+// Usage: zorkbench load [--locations N] [--threads N] [WORLD]
+//        zorkbench properties [--rounds N]
+//        zorkbench components [--rounds N]
+//        zorkbench scan [--entities N] [--rounds N]
+//        zorkbench entities [--entities N] [--moves N]
+//        zorkbench symbols [--entities N] [--rounds N]
+//        zorkbench dispatch [--rounds N] [--mode direct|queued|bus]
+//        zorkbench broadcast [--subscribers N] [--rounds N]
+//        zorkbench commands [--rounds N] [--lines N]
+//        zorkbench bus [--messages N] [--shards N]
+//  load times the getline/stringstream loader against the memory mapped one and
+//   reports each one's peak resident memory; without WORLD it writes a synthetic
+//   world of N locations (default 200000) to the temp directory first. --threads
+//   also times the mapped loader asked for N tokenizing threads, to see whether they
+//   pay off for that size of world on this machine
+//  properties builds the components of entities from their property lists, with
+//   the find and regex chain against PropertyList and the ComponentRegistry, N
+//   rounds of the example world's lists (default 20000)
+//  components times getComponent hits and misses over 4096 entities N times
+//   (default 2000), then 100 N take_from / put_item round trips between two
+//   containers, the type_index map entity against the current one
+//  scan loads a synthetic world of N entities (default 1000000) and finds its
+//   takeable and its usable takeable things in N rounds (default 10): by walking every
+//   location and container of the old layout and of the current one, and through
+//   registry views
+//  entities builds N entities (default 1000000) of the example world's kinds into
+//   locations and reports the memory each one costs, shared_ptr<Entity> against the
+//   EntityPool, then moves an item from a location to the inventory, into a bag and
+//   back N times (default 1000000) in each layout
+//  symbols holds the names, descriptions and directions of a synthetic world of N
+//   entities (default 1000000) as std::strings and as Symbols and reports the memory
+//   each takes, then N times (default 1000000) matches a typed word against a
+//   location's things, lowercasing both sides against findFolded, and looks a name
+//   up among 100000 recipients, a std::string keyed map against a Symbol keyed one
+//  dispatch sends each of the ten entity verbs to an entity without components N
+//   times (default 1000000), through a string if-chain and through the opcode table,
+//   then through sendMessage in Direct mode and in --mode (default queued), draining
+//   after every ten as the game does after a command
+//  broadcast sends one message to each of N recipients (default 10000) in N rounds
+//   (default 500), with a loop of sendMessage calls and with one publish to a topic,
+//   in Direct and Queued mode
+//  commands finds the command 4096 typed lines start with, N times (default 200),
+//   through the old name and alias maps and through the trie, for the game's own
+//   table and for 1000 and 100000 made up names. each side is timed whole (with the
+//   istringstream split or the tokenizer in front) and on the bare lookup; the trie
+//   is timed on 3 letter abbreviations too. then it plays N lines (default 200000) of
+//   the example world with the game text going to a file, and times the text of
+//   LOOK, INVENTORY and HELP alone written piece by piece to a redirected stdout, as
+//   the commands did before the OutputBuffer, and through an OutputBuffer flushed
+//   to a FileSink once per command
+//  bus sends N messages (default 2000000) from 1 to 32 producer threads to 64
+//   recipients over S shards (default one per core): through mutex guarded queues
+//   for comparison, the bare MpscQueues, the whole MessageBus with its consumer
+//   threads, and a MessageDispatcher in Bus mode drained by one thread
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // -------------------------------------------------------------- load
+
+    // a world shaped like the example one, repeated: a container with contents,
+    // locks, health effects and four connections per location
+    std::string writeSyntheticWorld(size_t locations)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / ("zorkbench_world_" + std::to_string(locations) + ".txt")).string();
+        if (std::filesystem::exists(path))
+            return path;
+        std::ofstream out(path);
+        for (size_t i = 1; i <= locations; ++i)
+        {
+            size_t north = i % locations + 1, south = (i + locations - 2) % locations + 1;
+            out << i << "; Clearing " << i << "; A quiet clearing, number " << i << " of many.; north=" << north
+                << ", south=" << south << ", east=" << north << ", west=" << south << ";\n"
+                << "    Rock: A small rock blending with the forest floor.; [Takeable]\n"
+                << "    Bag: A rugged leather bag, useful for holding items.; [Takeable, Container]\n"
+                << "        Coin: A shiny gold coin.; [Takeable]\n"
+                << "        Key: A small bronze key.; [Takeable]\n"
+                << "    Chest: A heavy wooden chest, old and sturdy.; [Lockable=Key, Container, Openable]\n"
+                << "        Gem: A beautiful gem, hidden from view.; [Takeable]\n"
+                << "    Potion: A small vial filled with a glowing liquid.; [Takeable, Usable, Health=+2]\n"
+                << "    Canoe: A light canoe for navigating the river.\n\n";
+        }
+        return path;
+    }
+
+    // the original loader's object model: strings everywhere, shared_ptrs, a
+    // type_index map of components per entity and a name keyed handler map
+    namespace legacy
+    {
+        struct Component
+        {
+            virtual ~Component() = default;
+        };
+        struct Entity;
+        struct Takeable : Component {};
+        struct Container : Component
+        {
+            std::vector<std::shared_ptr<Entity>> items;
+        };
+        struct Openable : Component
+        {
+            bool open = false;
+        };
+        struct Lockable : Component
+        {
+            explicit Lockable(std::string key) : key(std::move(key)) {}
+            std::string key;
+            bool locked = true;
+        };
+        struct Health : Component
+        {
+            explicit Health(int value) : value(value) {}
+            int value;
+        };
+        struct Usable : Component
+        {
+            explicit Usable(int effect = 0) : effect(effect) {}
+            int effect;
+        };
+
+        struct Entity
+        {
+            Entity(std::string name, std::string description) : name(std::move(name)), description(std::move(description)) {}
+            std::string name, description;
+            std::unordered_map<std::type_index, std::shared_ptr<Component>> components;
+            template <typename T>
+            void add(std::shared_ptr<T> component) { components[typeid(T)] = std::move(component); }
+            template <typename T>
+            std::shared_ptr<T> get() const
+            {
+                auto it = components.find(typeid(T));
+                return it != components.end() ? std::static_pointer_cast<T>(it->second) : nullptr;
+            }
+        };
+
+        struct Location
+        {
+            Location(int number, std::string name, std::string description) : number(number), name(std::move(name)), description(std::move(description)) {}
+            int number;
+            std::string name, description;
+            std::unordered_map<std::string, std::shared_ptr<Location>> connections;
+            std::vector<std::shared_ptr<Entity>> entities;
+        };
+
+        struct World
+        {
+            std::unordered_map<int, std::shared_ptr<Location>> locations;
+            std::unordered_map<std::string, std::function<void(int)>> handlers;
+            size_t entities = 0;
+        };
+
+        std::string trim(const std::string &str)
+        {
+            size_t start = str.find_first_not_of(" \t\n\r");
+            size_t end = str.find_last_not_of(" \t\n\r");
+            return (start == std::string::npos) ? "" : str.substr(start, end - start + 1);
+        }
+
+        int countIndentation(const std::string &line)
+        {
+            int count = 0;
+            for (char c : line)
+            {
+                if (c != ' ' && c != '\t')
+                    break;
+                ++count;
+            }
+            return count;
+        }
+
+        // the find chain the loader ran on every entity's property list before the
+        // component registry, a fresh regex for each Lockable= and Health= included;
+        // returns whether the entity became a container
+        bool addProperties(Entity &entity, const std::string &propertiesStr)
+        {
+            bool isContainer = false;
+            if (propertiesStr.find("Takeable") != std::string::npos)
+                entity.add(std::make_shared<Takeable>());
+            if (propertiesStr.find("Container") != std::string::npos)
+            {
+                entity.add(std::make_shared<Container>());
+                isContainer = true;
+            }
+            if (propertiesStr.find("Openable") != std::string::npos)
+                entity.add(std::make_shared<Openable>());
+            if (propertiesStr.find("Lockable=") != std::string::npos)
+            {
+                std::regex lockRegex(R"(Lockable=([^,\]]+))");
+                std::smatch match;
+                if (std::regex_search(propertiesStr, match, lockRegex))
+                    entity.add(std::make_shared<Lockable>(match[1]));
+            }
+            if (propertiesStr.find("Health=") != std::string::npos)
+            {
+                std::regex healthRegex(R"(Health=\+?(\d+))");
+                std::smatch match;
+                if (std::regex_search(propertiesStr, match, healthRegex))
+                    entity.add(std::make_shared<Health>(std::stoi(match[1])));
+            }
+            if (propertiesStr.find("Usable") != std::string::npos)
+            {
+                size_t pos = propertiesStr.find("Health=");
+                entity.add(std::make_shared<Usable>(pos != std::string::npos ? std::stoi(trim(propertiesStr.substr(pos + 7))) : 0));
+            }
+            return isContainer;
+        }
+
+        // Graph::loadFromFile as it was before the mapped loader, minus its per line console output
+        void load(const std::string &filename, World &world)
+        {
+            std::ifstream file(filename);
+            std::string line;
+            std::shared_ptr<Location> currentLocation;
+            std::shared_ptr<Entity> currentContainer;
+            int containerIndentationLevel = -1;
+            std::vector<std::tuple<int, std::string, int>> pendingConnections;
+
+            while (std::getline(file, line))
+            {
+                int currentIndentationLevel = countIndentation(line);
+                std::string trimmedLine = trim(line);
+                if (trimmedLine.empty())
+                    continue;
+                try
+                {
+                    if (isdigit(static_cast<unsigned char>(trimmedLine[0])))
+                    {
+                        std::stringstream ss(trimmedLine);
+                        std::string idStr, name, description, connectionsStr;
+                        std::getline(ss, idStr, ';');
+                        int locID = std::stoi(trim(idStr));
+                        std::getline(ss, name, ';');
+                        name = trim(name);
+                        std::getline(ss, description, ';');
+                        description = trim(description);
+                        currentLocation = std::make_shared<Location>(locID, name, description);
+                        world.locations[locID] = currentLocation;
+
+                        std::getline(ss, connectionsStr, ';');
+                        std::stringstream connectionsStream(connectionsStr);
+                        std::string connection;
+                        while (std::getline(connectionsStream, connection, ','))
+                        {
+                            std::stringstream connectionStream(connection);
+                            std::string direction, connectedLocIDStr;
+                            std::getline(connectionStream, direction, '=');
+                            std::getline(connectionStream, connectedLocIDStr);
+                            pendingConnections.emplace_back(locID, trim(direction), std::stoi(trim(connectedLocIDStr)));
+                        }
+                        std::shared_ptr<Location> captured = currentLocation;
+                        world.handlers["location_" + std::to_string(locID)] = [captured](int) {};
+                        currentContainer = nullptr;
+                        containerIndentationLevel = -1;
+                    }
+                    else if (currentLocation)
+                    {
+                        std::stringstream ss(trimmedLine);
+                        std::string entityName, entityDescription, propertiesStr;
+                        std::getline(ss, entityName, ':');
+                        entityName = trim(entityName);
+                        std::getline(ss, entityDescription, ';');
+                        entityDescription = trim(entityDescription);
+                        if (entityName.empty() || entityDescription.empty())
+                            continue;
+
+                        auto entity = std::make_shared<Entity>(entityName, entityDescription);
+                        bool isContainer = false;
+                        if (std::getline(ss, propertiesStr))
+                            isContainer = addProperties(*entity, trim(propertiesStr));
+                        world.handlers[entity->name] = [entity](int) {};
+                        ++world.entities;
+
+                        if (currentIndentationLevel > containerIndentationLevel && currentContainer && currentContainer->get<Container>())
+                        {
+                            currentContainer->get<Container>()->items.push_back(entity);
+                        }
+                        else
+                        {
+                            currentLocation->entities.push_back(entity);
+                            currentContainer = isContainer ? entity : nullptr;
+                            if (isContainer)
+                                containerIndentationLevel = currentIndentationLevel;
+                        }
+                    }
+                }
+                catch (const std::exception &)
+                {
+                }
+            }
+
+            for (const auto &[fromID, direction, toID] : pendingConnections)
+            {
+                if (world.locations.count(fromID) && world.locations.count(toID))
+                    world.locations[fromID]->connections[direction] = world.locations[toID];
+            }
+        }
+    }
+
+    // runs body in a child process and returns the child's peak resident memory in kB
+    // body's line of output goes to stdout before the child exits
+    long inChild(const std::function<void()> &body)
+    {
+        std::fflush(stdout);
+        pid_t child = ::fork();
+        if (child == 0)
+        {
+            body();
+            std::fflush(stdout);
+            std::_Exit(0);
+        }
+        int status = 0;
+        rusage usage{};
+        if (child < 0 || ::wait4(child, &status, 0, &usage) < 0)
+            return -1;
+        return usage.ru_maxrss;
+    }
+
+    int benchLoad(int argc, char *argv[])
+    {
+        size_t locations = 200000;
+        unsigned threads = 1;
+        std::string world;
+        for (int i = 0; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--locations" && i + 1 < argc)
+                locations = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--threads" && i + 1 < argc)
+                threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            else
+                world = arg;
+        }
+        if (world.empty())
+            world = writeSyntheticWorld(locations);
+        std::printf("world %s, %.1f MB\n", world.c_str(), std::filesystem::file_size(world) / 1048576.0);
+
+        long baseline = inChild([] {});
+        long legacyPeak = inChild([&]
+                                  {
+            auto start = Clock::now();
+            legacy::World loaded;
+            legacy::load(world, loaded);
+            std::printf("  legacy getline/stringstream  %8.3f s  %zu locations, %zu entities\n", secondsSince(start), loaded.locations.size(), loaded.entities); });
+        auto mapped = [&](unsigned loaderThreads)
+        {
+            return inChild([&]
+                           {
+                auto start = Clock::now();
+                MessageDispatcher dispatcher;
+                Graph graph(dispatcher);
+                graph.setLoaderThreads(loaderThreads);
+                graph.loadFromFile(world);
+                std::printf("  memory mapped, %2u thread%s    %8.3f s  %zu locations, %zu entities\n", loaderThreads,
+                            loaderThreads == 1 ? " " : "s", secondsSince(start), graph.locations.size(), graph.entities.size()); });
+        };
+        long mappedPeak = mapped(1);
+        std::printf("peak resident memory above an empty process: legacy %.1f MB, mapped %.1f MB\n",
+                    (legacyPeak - baseline) / 1024.0, (mappedPeak - baseline) / 1024.0);
+        if (threads != 1)
+            mapped(threads);
+        return 0;
+    }
+
+    // -------------------------------------------------------------- properties
+
+    // the property lists of the example world plus a couple of harder ones; the legacy
+    // chain builds one component fewer per round, its Health regex never took a minus
+    const char *const kPropertyLists[] = {
+        "[Takeable]",
+        "[Takeable, Container]",
+        "[Lockable=Key, Container, Openable]",
+        "[Takeable, Usable, Health=+2]",
+        "[Container, Openable]",
+        "[Takeable, Usable, Health=-5]",
+        "[Lockable=Bronze Key, Openable, Container, Takeable]",
+    };
+    constexpr size_t kPropertyListCount = sizeof(kPropertyLists) / sizeof(kPropertyLists[0]);
+
+    // both sides build every component of a fresh entity, so entity creation is in
+    // both figures; the legacy entity is a make_shared, the current one a pool slot
+    int benchProperties(int argc, char *argv[])
+    {
+        size_t rounds = 20000;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+        }
+        std::vector<std::string> lists(kPropertyLists, kPropertyLists + kPropertyListCount);
+        size_t total = rounds * lists.size();
+        size_t legacyComponents = 0, registryComponents = 0, parsed = 0;
+
+        auto start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const std::string &list : lists)
+            {
+                legacy::Entity entity("Thing", "A thing.");
+                legacy::addProperties(entity, list);
+                legacyComponents += entity.components.size();
+            }
+        }
+        double legacySeconds = secondsSince(start);
+
+        MessageDispatcher dispatcher;
+        Registry registry;
+        EntityPool pool(registry);
+        Symbol name("Thing"), description("A thing.");
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const std::string &list : lists)
+            {
+                EntityHandle handle = pool.create(name, description, dispatcher);
+                PropertyList properties;
+                properties.parse(list);
+                registryComponents += ComponentRegistry::instance().apply(*pool.get(handle), properties);
+                pool.destroy(handle);
+            }
+        }
+        double registrySeconds = secondsSince(start);
+
+        // tokenizing alone, without building anything
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const std::string &list : lists)
+            {
+                PropertyList properties;
+                properties.parse(list);
+                parsed += properties.size();
+            }
+        }
+        double parseSeconds = secondsSince(start);
+
+        std::printf("%zu property lists\n", total);
+        std::printf("  legacy find chain + regex    %8.3f s  %10.0f lists/s  %zu components\n", legacySeconds, total / legacySeconds, legacyComponents);
+        std::printf("  PropertyList + registry      %8.3f s  %10.0f lists/s  %zu components (%.1fx)\n", registrySeconds, total / registrySeconds, registryComponents, legacySeconds / registrySeconds);
+        std::printf("  PropertyList::parse alone    %8.3f s  %10.0f lists/s  %zu properties\n", parseSeconds, total / parseSeconds, parsed);
+        return 0;
+    }
+
+    // -------------------------------------------------------------- components
+
+    namespace legacy
+    {
+        // messages and the dispatcher as the container handlers used them: string
+        // addresses and verbs, std::any payloads and a name keyed handler map
+        struct Message
+        {
+            std::string from, to, message;
+            std::any data;
+        };
+        struct Dispatcher
+        {
+            std::unordered_map<std::string, std::function<void(const Message &)>> recipients;
+            OutputBuffer *output;
+            void sendMessage(const Message &message)
+            {
+                auto it = recipients.find(message.to);
+                if (it != recipients.end())
+                    it->second(message);
+            }
+        };
+
+        std::string toLowerCase(const std::string &input)
+        {
+            std::string result = input;
+            std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+            return result;
+        }
+
+        // Entity::handleMessage's container branches as they were before the fixed
+        // slot store, every getComponent a type_index lookup and a shared_ptr copy
+        void handleMessage(Entity &entity, Dispatcher &dispatcher, const Message &msg)
+        {
+            OutputBuffer &out = *dispatcher.output;
+            const std::string &name = entity.name;
+            if (msg.message == "addItem")
+            {
+                if (auto container = entity.get<Container>())
+                {
+                    container->items.push_back(std::any_cast<std::shared_ptr<Entity>>(msg.data));
+                    out << "Item added to " << name << ".\n";
+                }
+            }
+            else if (msg.message == "removeItem")
+            {
+                if (auto container = entity.get<Container>())
+                {
+                    auto item = std::any_cast<std::shared_ptr<Entity>>(msg.data);
+                    container->items.erase(std::remove(container->items.begin(), container->items.end(), item), container->items.end());
+                    out << "Item removed from " << name << ".\n";
+                }
+            }
+            else if (msg.message == "take_from" || msg.message == "put_item")
+            {
+                auto container = entity.get<Container>();
+                if (!container)
+                {
+                    out << name << " is not a container.\n";
+                    return;
+                }
+                if (auto lockable = entity.get<Lockable>())
+                {
+                    if (lockable->locked)
+                    {
+                        out << name << " is locked.\n";
+                        return;
+                    }
+                }
+                if (auto openable = entity.get<Openable>())
+                {
+                    if (!openable->open)
+                    {
+                        out << "The " << name << " is closed.\n";
+                        return;
+                    }
+                }
+                if (msg.message == "put_item")
+                {
+                    auto item = std::any_cast<std::shared_ptr<Entity>>(msg.data);
+                    container->items.push_back(item);
+                    dispatcher.sendMessage({name, msg.from, "removeItem", item});
+                    out << "You put the " << item->name << " in the " << name << ".\n";
+                    return;
+                }
+                std::string itemName = std::any_cast<std::string>(msg.data);
+                for (const auto &item : container->items)
+                {
+                    if (toLowerCase(item->name) == toLowerCase(itemName))
+                    {
+                        if (!item->get<Takeable>())
+                        {
+                            out << "You can't take that.\n";
+                            return;
+                        }
+                        auto taken = item;
+                        container->items.erase(std::remove(container->items.begin(), container->items.end(), taken), container->items.end());
+                        dispatcher.sendMessage({name, msg.from, "addItem", taken});
+                        out << "Taken " << taken->name << " from " << name << ".\n";
+                        return;
+                    }
+                }
+                out << "You don't see a " << itemName << " in there.\n";
+            }
+        }
+    }
+
+    // keeps a result alive so the optimiser can't drop the loop that made it
+    volatile uintptr_t sink;
+
+    // getComponent hit and miss over a spread of entities, then a take_from and
+    // put_item round trip between two containers, the old entity against the current
+    int benchComponents(int argc, char *argv[])
+    {
+        size_t rounds = 2000;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+        }
+        constexpr size_t kEntities = 4096;
+        NullSink nowhere;
+        OutputBuffer out(nowhere);
+
+        // every entity is an open, unlocked container without health
+        std::vector<std::shared_ptr<legacy::Entity>> oldEntities;
+        for (size_t i = 0; i < kEntities; ++i)
+        {
+            auto entity = std::make_shared<legacy::Entity>("Chest", "A chest.");
+            entity->add(std::make_shared<legacy::Container>());
+            auto openable = std::make_shared<legacy::Openable>();
+            openable->open = true;
+            entity->add(openable);
+            auto lockable = std::make_shared<legacy::Lockable>("Key");
+            lockable->locked = false;
+            entity->add(lockable);
+            oldEntities.push_back(entity);
+        }
+        MessageDispatcher dispatcher;
+        dispatcher.setOutput(&out);
+        Registry registry;
+        EntityPool pool(registry);
+        std::vector<Entity *> entities;
+        for (size_t i = 0; i < kEntities; ++i)
+        {
+            Entity *entity = pool.get(pool.create(Symbol("Chest"), Symbol("A chest."), dispatcher));
+            entity->addComponent<ContainerComponent>();
+            entity->addComponent<OpenableComponent>(true);
+            entity->addComponent<LockableComponent>("Key").unlock("Key");
+            entities.push_back(entity);
+        }
+
+        size_t lookups = rounds * kEntities;
+        auto time = [&](auto lookup)
+        {
+            uintptr_t found = 0;
+            auto start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+                found += lookup();
+            sink = found;
+            return secondsSince(start);
+        };
+        double oldHit = time([&]
+                             { uintptr_t found = 0; for (auto &e : oldEntities) found += reinterpret_cast<uintptr_t>(e->get<legacy::Container>().get()); return found; });
+        double oldMiss = time([&]
+                              { uintptr_t found = 0; for (auto &e : oldEntities) found += reinterpret_cast<uintptr_t>(e->get<legacy::Health>().get()); return found; });
+        double newHit = time([&]
+                             { uintptr_t found = 0; for (Entity *e : entities) found += reinterpret_cast<uintptr_t>(e->getComponent<ContainerComponent>()); return found; });
+        double newMiss = time([&]
+                              { uintptr_t found = 0; for (Entity *e : entities) found += reinterpret_cast<uintptr_t>(e->getComponent<HealthComponent>()); return found; });
+        std::printf("getComponent, %zu lookups each\n", lookups);
+        std::printf("  legacy type_index map, hit   %8.3f s  %6.2f ns/lookup\n", oldHit, oldHit * 1e9 / lookups);
+        std::printf("  legacy type_index map, miss  %8.3f s  %6.2f ns/lookup\n", oldMiss, oldMiss * 1e9 / lookups);
+        std::printf("  registry, hit                %8.3f s  %6.2f ns/lookup\n", newHit, newHit * 1e9 / lookups);
+        std::printf("  registry, miss               %8.3f s  %6.2f ns/lookup\n", newMiss, newMiss * 1e9 / lookups);
+
+        // a gem goes from the chest to the pack and back: take_from, addItem, put_item, removeItem
+        size_t moves = rounds * 100;
+        legacy::Dispatcher oldDispatcher{{}, &out};
+        auto oldChest = oldEntities[0], oldPack = oldEntities[1];
+        auto oldGem = std::make_shared<legacy::Entity>("Gem", "A gem.");
+        oldGem->add(std::make_shared<legacy::Takeable>());
+        oldChest->get<legacy::Container>()->items.push_back(oldGem);
+        oldDispatcher.recipients["Chest"] = [&](const legacy::Message &msg)
+        { legacy::handleMessage(*oldChest, oldDispatcher, msg); };
+        oldDispatcher.recipients["player"] = [&](const legacy::Message &msg)
+        { legacy::handleMessage(*oldPack, oldDispatcher, msg); };
+        auto start = Clock::now();
+        for (size_t i = 0; i < moves; ++i)
+        {
+            oldDispatcher.sendMessage({"player", "Chest", "take_from", std::string("gem")});
+            oldDispatcher.sendMessage({"player", "Chest", "put_item", oldGem});
+            out.flush();
+        }
+        double oldMoves = secondsSince(start);
+
+        Entity *chest = entities[0], *pack = entities[1];
+        Entity *gem = pool.get(pool.create(Symbol("Gem"), Symbol("A gem."), dispatcher));
+        gem->addComponent<TakeableComponent>();
+        chest->addContainedEntity(gem->getHandle());
+        Symbol gemName("gem");
+        start = Clock::now();
+        for (size_t i = 0; i < moves; ++i)
+        {
+            dispatcher.sendMessage({pack->getId(), chest->getId(), Opcode::TakeFrom, gemName});
+            dispatcher.sendMessage({pack->getId(), chest->getId(), Opcode::PutItem, gem->getHandle()});
+            out.flush();
+        }
+        double newMoves = secondsSince(start);
+        bool same = oldChest->get<legacy::Container>()->items.size() == 1 && oldPack->get<legacy::Container>()->items.empty() &&
+                    chest->getContainedEntities().size() == 1 && pack->getContainedEntities().empty();
+        std::printf("take_from + put_item round trips, %zu each%s\n", moves, same ? "" : " (the gem went astray!)");
+        std::printf("  legacy entity                %8.3f s  %6.0f ns/round trip\n", oldMoves, oldMoves * 1e9 / moves);
+        std::printf("  current entity               %8.3f s  %6.0f ns/round trip (%.1fx)\n", newMoves, newMoves * 1e9 / moves, oldMoves / newMoves);
+        return same ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- scan
+
+    namespace legacy
+    {
+        // every entity of a location and, depth first, everything inside it
+        template <typename Fn>
+        void walk(const std::vector<std::shared_ptr<Entity>> &items, Fn &fn)
+        {
+            for (const auto &entity : items)
+            {
+                fn(*entity);
+                if (auto container = entity->get<Container>())
+                    walk(container->items, fn);
+            }
+        }
+    }
+
+    // the same walk over the current layout: handles resolved through the registry
+    template <typename Fn>
+    void walk(const Registry &registry, const std::vector<EntityHandle> &items, Fn &fn)
+    {
+        for (EntityHandle handle : items)
+        {
+            Entity *entity = registry.resolve(handle);
+            fn(*entity);
+            walk(registry, entity->getContainedEntities(), fn);
+        }
+    }
+
+    // a whole world queried for its takeable things and for its usable takeable
+    // things. the old layout can only be asked by walking every location and every
+    // container in it; the current one is walked the same way and then asked
+    // through a registry view, which never leaves the component pools.
+    // each side loads the world in a child of its own so neither pays for the
+    // other's memory
+    int benchScan(int argc, char *argv[])
+    {
+        size_t entities = 1000000, rounds = 10;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--entities")
+                entities = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+        }
+        // the synthetic world has eight entities per location
+        std::string world = writeSyntheticWorld(std::max<size_t>(1, (entities + 7) / 8));
+        std::printf("world %s, %zu scans of each query\n", world.c_str(), rounds);
+
+        // runs query rounds times, prints its time per entity visited and what it found
+        auto report = [rounds](const char *label, size_t visited, auto query)
+        {
+            size_t found = 0;
+            long effect = 0;
+            auto start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+                query(found, effect);
+            double seconds = secondsSince(start);
+            std::printf("  %-30s %8.3f s  %7.2f ms/scan  %6.2f ns/entity  %zu found, effects %ld\n", label, seconds,
+                        seconds * 1e3 / rounds, seconds * 1e9 / (rounds * visited), found / rounds, effect / static_cast<long>(rounds));
+        };
+
+        inChild([&]
+                {
+            legacy::World loaded;
+            legacy::load(world, loaded);
+            std::printf("%zu entities in %zu locations\n", loaded.entities, loaded.locations.size());
+            report("legacy walk, takeable", loaded.entities, [&](size_t &found, long &)
+                   {
+                auto match = [&](const legacy::Entity &entity)
+                { found += entity.get<legacy::Takeable>() != nullptr; };
+                for (const auto &[number, location] : loaded.locations)
+                    legacy::walk(location->entities, match); });
+            report("legacy walk, usable takeable", loaded.entities, [&](size_t &found, long &effect)
+                   {
+                auto match = [&](const legacy::Entity &entity)
+                {
+                    if (auto usable = entity.get<legacy::Usable>(); usable && entity.get<legacy::Takeable>())
+                    {
+                        ++found;
+                        effect += usable->effect;
+                    }
+                };
+                for (const auto &[number, location] : loaded.locations)
+                    legacy::walk(location->entities, match); }); });
+
+        inChild([&]
+                {
+            MessageDispatcher dispatcher;
+            Graph graph(dispatcher);
+            graph.loadFromFile(world);
+            const Registry &registry = graph.registry;
+            size_t count = graph.entities.size();
+            report("current walk, takeable", count, [&](size_t &found, long &)
+                   {
+                auto match = [&](const Entity &entity)
+                { found += entity.hasComponent<TakeableComponent>(); };
+                for (const auto &[number, location] : graph.locations)
+                    walk(registry, location->getEntities(), match); });
+            report("current walk, usable takeable", count, [&](size_t &found, long &effect)
+                   {
+                auto match = [&](const Entity &entity)
+                {
+                    if (auto usable = entity.getComponent<UsableComponent>(); usable && entity.hasComponent<TakeableComponent>())
+                    {
+                        ++found;
+                        effect += usable->getEffectValue();
+                    }
+                };
+                for (const auto &[number, location] : graph.locations)
+                    walk(registry, location->getEntities(), match); });
+            report("view, takeable", count, [&](size_t &found, long &)
+                   { graph.registry.view<TakeableComponent>().each([&](EntityIndex, TakeableComponent &)
+                                                                   { ++found; }); });
+            report("view, usable takeable", count, [&](size_t &found, long &effect)
+                   { graph.registry.view<UsableComponent, TakeableComponent>().each([&](EntityIndex, UsableComponent &usable, TakeableComponent &)
+                                                                                    {
+                        ++found;
+                        effect += usable.getEffectValue(); }); }); });
+        return 0;
+    }
+
+    // -------------------------------------------------------------- entities
+
+    // resident memory of this process right now in kB, unlike the peak inChild returns
+    long residentKb()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long pages = 0, resident = 0;
+        statm >> pages >> resident;
+        return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    // the kinds of thing the synthetic world is made of, with their property lists
+    struct Thing
+    {
+        const char *name, *description, *properties;
+    };
+    const Thing kThings[] = {
+        {"Rock", "A small rock blending with the forest floor.", "[Takeable]"},
+        {"Bag", "A rugged leather bag, useful for holding items.", "[Takeable, Container]"},
+        {"Coin", "A shiny gold coin.", "[Takeable]"},
+        {"Key", "A small bronze key.", "[Takeable]"},
+        {"Chest", "A heavy wooden chest, old and sturdy.", "[Lockable=Key, Container, Openable]"},
+        {"Gem", "A beautiful gem, hidden from view.", "[Takeable]"},
+        {"Potion", "A small vial filled with a glowing liquid.", "[Takeable, Usable, Health=+2]"},
+        {"Canoe", "A light canoe for navigating the river.", ""},
+    };
+    constexpr size_t kThingCount = sizeof(kThings) / sizeof(kThings[0]);
+
+    // what an entity costs to keep and to move around: N entities (default 1000000)
+    // built with their components into locations of eight, the shared_ptr layout
+    // against the pool, then N round trips of an item from a location to the
+    // inventory, into a bag and back, the item riding in a message payload each
+    // time as it did in the game. dispatcher registrations are left out of both
+    int benchEntities(int argc, char *argv[])
+    {
+        size_t count = 1000000, moves = 1000000;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--entities")
+                count = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--moves")
+                moves = std::strtoul(argv[++i], nullptr, 10);
+        }
+        std::printf("%zu entities in locations of %zu\n", count, kThingCount);
+
+        inChild([&]
+                {
+            std::vector<std::shared_ptr<legacy::Location>> locations;
+            locations.reserve(count / kThingCount + 1);
+            long before = residentKb();
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i % kThingCount == 0)
+                    locations.push_back(std::make_shared<legacy::Location>(static_cast<int>(locations.size()), "Clearing", "A quiet clearing."));
+                const Thing &thing = kThings[i % kThingCount];
+                auto entity = std::make_shared<legacy::Entity>(thing.name, thing.description);
+                legacy::addProperties(*entity, thing.properties);
+                locations.back()->entities.push_back(entity);
+            }
+            long used = residentKb() - before;
+            std::printf("  legacy shared_ptr<Entity>    %8.1f MB  %6.0f bytes/entity\n", used / 1024.0, used * 1024.0 / count); });
+
+        inChild([&]
+                {
+            MessageDispatcher dispatcher;
+            Registry registry;
+            EntityPool pool(registry);
+            std::vector<std::shared_ptr<Location>> locations;
+            locations.reserve(count / kThingCount + 1);
+            Symbol clearing("Clearing"), quiet("A quiet clearing.");
+            long before = residentKb();
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i % kThingCount == 0)
+                    locations.push_back(std::make_shared<Location>(static_cast<int>(locations.size()), clearing, quiet, registry));
+                const Thing &thing = kThings[i % kThingCount];
+                EntityHandle handle = pool.create(Symbol(thing.name), Symbol(thing.description), dispatcher);
+                PropertyList properties;
+                properties.parse(thing.properties);
+                ComponentRegistry::instance().apply(*pool.get(handle), properties);
+                locations.back()->addEntity(handle);
+            }
+            long used = residentKb() - before;
+            std::printf("  EntityPool + handles         %8.1f MB  %6.0f bytes/entity\n", used / 1024.0, used * 1024.0 / count); });
+
+        // a location holding the example world's things, one of them carried around
+        std::vector<std::shared_ptr<legacy::Entity>> oldGround, oldInventory;
+        std::shared_ptr<legacy::Entity> oldBag, oldItem;
+        for (const Thing &thing : kThings)
+        {
+            auto entity = std::make_shared<legacy::Entity>(thing.name, thing.description);
+            legacy::addProperties(*entity, thing.properties);
+            oldGround.push_back(entity);
+        }
+        oldBag = oldGround[1];
+        oldItem = oldGround[2];
+        // the item travels in a std::any, as addItem and removeItem carried it
+        auto oldMove = [](std::vector<std::shared_ptr<legacy::Entity>> &from, std::vector<std::shared_ptr<legacy::Entity>> &to, const std::shared_ptr<legacy::Entity> &item)
+        {
+            std::any data = item;
+            auto moved = std::any_cast<std::shared_ptr<legacy::Entity>>(data);
+            from.erase(std::remove(from.begin(), from.end(), moved), from.end());
+            to.push_back(moved);
+        };
+        auto &oldBagItems = oldBag->get<legacy::Container>()->items;
+        auto start = Clock::now();
+        for (size_t i = 0; i < moves; ++i)
+        {
+            oldMove(oldGround, oldInventory, oldItem);
+            oldMove(oldInventory, oldBagItems, oldItem);
+            oldMove(oldBagItems, oldGround, oldItem);
+        }
+        double oldSeconds = secondsSince(start);
+
+        MessageDispatcher dispatcher;
+        Registry registry;
+        EntityPool pool(registry);
+        Location ground(1, Symbol("Clearing"), Symbol("A quiet clearing."), registry);
+        EntityList inventory;
+        std::vector<EntityHandle> things;
+        for (const Thing &thing : kThings)
+        {
+            EntityHandle handle = pool.create(Symbol(thing.name), Symbol(thing.description), dispatcher);
+            PropertyList properties;
+            properties.parse(thing.properties);
+            ComponentRegistry::instance().apply(*pool.get(handle), properties);
+            ground.addEntity(handle);
+            things.push_back(handle);
+        }
+        Entity *bag = pool.get(things[1]);
+        EntityHandle item = things[2];
+        Symbol itemName = pool.get(item)->getNameSymbol();
+        start = Clock::now();
+        for (size_t i = 0; i < moves; ++i)
+        {
+            // the handle travels in a Payload and is checked for staleness on arrival
+            Payload data = item;
+            EntityHandle moved = data.asEntity();
+            ground.removeEntity(moved);
+            inventory.add(moved, itemName);
+            data = moved;
+            moved = data.asEntity();
+            if (inventory.remove(moved, itemName) && pool.get(moved))
+                bag->addContainedEntity(moved);
+            data = moved;
+            moved = data.asEntity();
+            bag->removeContainedEntity(moved);
+            ground.addEntity(moved);
+        }
+        double newSeconds = secondsSince(start);
+
+        bool same = oldGround.size() == kThingCount && oldInventory.empty() && oldBagItems.empty() &&
+                    ground.getEntities().size() == kThingCount && inventory.empty() && bag->getContainedEntities().empty();
+        std::printf("location -> inventory -> bag -> location, %zu round trips each%s\n", moves, same ? "" : " (the item went astray!)");
+        std::printf("  legacy shared_ptr in std::any %8.3f s  %6.0f ns/round trip\n", oldSeconds, oldSeconds * 1e9 / moves);
+        std::printf("  handle in a Payload          %8.3f s  %6.0f ns/round trip (%.1fx)\n", newSeconds, newSeconds * 1e9 / moves, oldSeconds / newSeconds);
+        return same ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- symbols
+
+    // what the names of a world cost held as std::strings and as Symbols, and the
+    // lookups the game does with them. the world is the synthetic one: per location
+    // a name and description of its own and four directions, then the example
+    // world's things. N entities (default 1000000), N rounds (default 1000000) of
+    // matching typed words against a location's things and of finding a recipient
+    // among 100000 by name, each the old way and the interned one
+    int benchSymbols(int argc, char *argv[])
+    {
+        size_t count = 1000000, rounds = 1000000;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--entities")
+                count = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+        }
+        const char *const kDirections[] = {"north", "south", "east", "west"};
+        size_t locations = (count + kThingCount - 1) / kThingCount;
+        size_t strings = locations * 6 + count * 2;
+        std::printf("%zu names, descriptions and directions of %zu locations and %zu entities\n", strings, locations, count);
+
+        // calls keep(text) for every string the world holds, in loading order
+        auto eachString = [&](auto keep)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i % kThingCount == 0)
+                {
+                    size_t number = i / kThingCount + 1;
+                    keep("Clearing " + std::to_string(number));
+                    keep("A quiet clearing, number " + std::to_string(number) + " of many.");
+                    for (const char *direction : kDirections)
+                        keep(std::string(direction));
+                }
+                const Thing &thing = kThings[i % kThingCount];
+                keep(std::string(thing.name));
+                keep(std::string(thing.description));
+            }
+        };
+
+        inChild([&]
+                {
+            std::vector<std::string> held;
+            held.reserve(strings);
+            long before = residentKb();
+            eachString([&](std::string &&text)
+                       { held.push_back(std::move(text)); });
+            long used = residentKb() - before;
+            std::printf("  legacy std::string           %8.1f MB  %6.1f bytes/string\n", used / 1024.0, used * 1024.0 / strings); });
+
+        inChild([&]
+                {
+            std::vector<Symbol> held;
+            held.reserve(strings);
+            SymbolTable::Stats start = SymbolTable::instance().stats();
+            long before = residentKb();
+            eachString([&](std::string &&text)
+                       { held.push_back(Symbol(text)); });
+            long used = residentKb() - before;
+            SymbolTable::Stats end = SymbolTable::instance().stats();
+            std::printf("  Symbol + SymbolTable         %8.1f MB  %6.1f bytes/string, %zu symbols (lowercase forms included)\n",
+                        used / 1024.0, used * 1024.0 / strings, end.symbols - start.symbols); });
+
+        // a location of the example world's things, matched against typed words in
+        // any case, some of which name nothing here
+        const std::vector<std::string> typed = {"rock", "GEM", "Potion", "canoe", "lantern", "bag", "Key", "chEst", "sword"};
+        std::vector<std::string> oldThings;
+        MessageDispatcher dispatcher;
+        Registry registry;
+        EntityPool pool(registry);
+        Location ground(1, Symbol("Clearing"), Symbol("A quiet clearing."), registry);
+        for (const Thing &thing : kThings)
+        {
+            oldThings.emplace_back(thing.name);
+            ground.addEntity(pool.create(Symbol(thing.name), Symbol(thing.description), dispatcher));
+        }
+
+        // Location::findEntityByName before Symbols: lowercase both sides of every compare
+        auto start = Clock::now();
+        size_t oldFound = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            const std::string &word = typed[round % typed.size()];
+            for (const std::string &name : oldThings)
+            {
+                if (legacy::toLowerCase(name) == legacy::toLowerCase(word))
+                {
+                    ++oldFound;
+                    break;
+                }
+            }
+        }
+        double oldMatchSeconds = secondsSince(start);
+
+        start = Clock::now();
+        size_t newFound = 0;
+        for (size_t round = 0; round < rounds; ++round)
+            newFound += ground.findEntityByName(typed[round % typed.size()]) != nullptr;
+        double newMatchSeconds = secondsSince(start);
+
+        // the dispatcher's name index, keyed by the name as typed and by its Symbol
+        constexpr size_t kRecipients = 100000;
+        std::unordered_map<std::string, EntityId> oldIndex;
+        std::unordered_map<Symbol, EntityId> newIndex;
+        std::vector<std::string> asked;
+        for (size_t i = 0; i < kRecipients; ++i)
+        {
+            std::string name = "recipient " + std::to_string(i);
+            oldIndex.emplace(name, static_cast<EntityId>(i + 1));
+            newIndex.emplace(Symbol(name), static_cast<EntityId>(i + 1));
+            // every fourth name asked for was never registered
+            asked.push_back(i % 4 == 3 ? "stranger " + std::to_string(i) : name);
+        }
+        std::shuffle(asked.begin(), asked.end(), std::mt19937(7));
+
+        start = Clock::now();
+        uint64_t oldSum = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            auto it = oldIndex.find(asked[round % kRecipients]);
+            oldSum += it != oldIndex.end() ? it->second : 0;
+        }
+        double oldLookupSeconds = secondsSince(start);
+
+        start = Clock::now();
+        uint64_t newSum = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            auto it = newIndex.find(Symbol::find(asked[round % kRecipients]));
+            newSum += it != newIndex.end() ? it->second : 0;
+        }
+        double newLookupSeconds = secondsSince(start);
+
+        // and once the name is a Symbol already, as it is inside the game
+        std::vector<Symbol> askedSymbols;
+        for (const std::string &name : asked)
+            askedSymbols.push_back(Symbol::find(name));
+        start = Clock::now();
+        uint64_t symbolSum = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            auto it = newIndex.find(askedSymbols[round % kRecipients]);
+            symbolSum += it != newIndex.end() ? it->second : 0;
+        }
+        double symbolLookupSeconds = secondsSince(start);
+
+        bool same = oldFound == newFound && oldSum == newSum && symbolSum == newSum;
+        std::printf("%zu typed words against %zu things%s\n", rounds, kThingCount, same ? "" : " (the two sides disagree!)");
+        std::printf("  legacy toLowerCase compares  %8.3f s  %6.2f ns/word\n", oldMatchSeconds, oldMatchSeconds * 1e9 / rounds);
+        std::printf("  findFolded + folded ids      %8.3f s  %6.2f ns/word (%.1fx)\n", newMatchSeconds, newMatchSeconds * 1e9 / rounds, oldMatchSeconds / newMatchSeconds);
+        std::printf("%zu names looked up among %zu recipients, a quarter unknown\n", rounds, kRecipients);
+        std::printf("  legacy std::string keys      %8.3f s  %6.2f ns/lookup\n", oldLookupSeconds, oldLookupSeconds * 1e9 / rounds);
+        std::printf("  Symbol::find + Symbol keys   %8.3f s  %6.2f ns/lookup (%.1fx)\n", newLookupSeconds, newLookupSeconds * 1e9 / rounds, oldLookupSeconds / newLookupSeconds);
+        std::printf("  Symbol keys, Symbol in hand  %8.3f s  %6.2f ns/lookup (%.1fx)\n", symbolLookupSeconds, symbolLookupSeconds * 1e9 / rounds, oldLookupSeconds / symbolLookupSeconds);
+        return same ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- dispatch
+
+    // counts what reaches it, so both sides can be checked to say the same thing
+    struct CountingSink : OutputSink
+    {
+        size_t bytes = 0;
+        void write(std::string_view text) override { bytes += text.size(); }
+    };
+
+    namespace legacy
+    {
+        struct VerbMessage
+        {
+            EntityId from, to;
+            std::string message;
+        };
+
+        // Entity::handleMessage before opcodes: a compare per verb until one matches,
+        // the component checks are the current registry so only the dispatch differs.
+        // just the branches an entity without components takes
+        void handleVerb(::Entity &entity, const VerbMessage &msg)
+        {
+            OutputBuffer &out = entity.getDispatcher().output();
+            if (msg.message == "inspect")
+                out << "The " << entity.getName() << " is inspected: " << entity.getDescription() << "\n";
+            else if (msg.message == "use")
+            {
+                if (!entity.getComponent<UsableComponent>())
+                    out << "You can't use " << entity.getName() << ".\n";
+            }
+            else if (msg.message == "unlock")
+                (void)entity.getComponent<LockableComponent>();
+            else if (msg.message == "open")
+                (void)entity.getComponent<OpenableComponent>();
+            else if (msg.message == "close")
+                (void)entity.getComponent<OpenableComponent>();
+            else if (msg.message == "addItem")
+                (void)entity.getComponent<ContainerComponent>();
+            else if (msg.message == "removeItem")
+                (void)entity.getComponent<ContainerComponent>();
+            else if (msg.message == "look_in")
+            {
+                if (!entity.getComponent<ContainerComponent>())
+                    out << "You can't look inside " << entity.getName() << ".\n";
+            }
+            else if (msg.message == "take_from")
+            {
+                if (!entity.getComponent<ContainerComponent>())
+                    out << entity.getName() << " is not a container.\n";
+            }
+            else if (msg.message == "put_item")
+            {
+                if (!entity.getComponent<ContainerComponent>())
+                    out << "The " << entity.getName() << " is not a container.\n";
+            }
+        }
+    }
+
+    // every verb an entity handled before opcodes, sent in turn to an entity
+    // without components, through the string chain and through the MessageTable
+    int benchDispatch(int argc, char *argv[])
+    {
+        size_t rounds = 1000000;
+        MessageDispatcher::Mode mode = MessageDispatcher::Mode::Queued;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--mode")
+            {
+                std::string name = argv[++i];
+                if (name == "direct")
+                    mode = MessageDispatcher::Mode::Direct;
+                else if (name == "bus")
+                    mode = MessageDispatcher::Mode::Bus;
+                else if (name != "queued")
+                {
+                    std::cerr << "unknown dispatch mode " << name << "\n";
+                    return 1;
+                }
+            }
+        }
+        const Opcode opcodes[] = {Opcode::Inspect, Opcode::Use, Opcode::Unlock, Opcode::Open, Opcode::Close,
+                                  Opcode::AddItem, Opcode::RemoveItem, Opcode::LookIn, Opcode::TakeFrom, Opcode::PutItem};
+        constexpr size_t kVerbs = sizeof(opcodes) / sizeof(opcodes[0]);
+
+        MessageDispatcher dispatcher;
+        Registry registry;
+        EntityPool pool(registry);
+        Entity *rock = pool.get(pool.create(Symbol("Rock"), Symbol("A small rock."), dispatcher));
+
+        std::vector<legacy::VerbMessage> oldMessages;
+        std::vector<Message> messages;
+        for (Opcode opcode : opcodes)
+        {
+            oldMessages.push_back({kNoEntity, rock->getId(), std::string(opcodeName(opcode))});
+            messages.push_back({kNoEntity, rock->getId(), opcode, {}});
+        }
+
+        CountingSink oldText, newText;
+        OutputBuffer oldOut(oldText), newOut(newText);
+        dispatcher.setOutput(&oldOut);
+        auto start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const auto &msg : oldMessages)
+                legacy::handleVerb(*rock, msg);
+            oldOut.flush();
+        }
+        double oldSeconds = secondsSince(start);
+
+        dispatcher.setOutput(&newOut);
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const auto &msg : messages)
+                rock->handleMessage(msg);
+            newOut.flush();
+        }
+        double newSeconds = secondsSince(start);
+
+        // the verb names survive at the edges, as one lookup when text comes in
+        start = Clock::now();
+        size_t found = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const auto &msg : oldMessages)
+                found += opcodeFromName(msg.message) != Opcode::Count;
+        }
+        double edgeSeconds = secondsSince(start);
+
+        // the same messages through sendMessage, a round being one command's worth:
+        // Direct delivers each one as it is sent, the other modes queue the round
+        // and deliver it when the game would, with a drain after the command
+        auto throughDispatcher = [&](MessageDispatcher::Mode sendMode, CountingSink &text)
+        {
+            OutputBuffer out(text);
+            dispatcher.setOutput(&out);
+            dispatcher.setMode(sendMode);
+            auto begin = Clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const auto &msg : messages)
+                    dispatcher.sendMessage(msg);
+                dispatcher.drain();
+                out.flush();
+            }
+            double seconds = secondsSince(begin);
+            dispatcher.setMode(MessageDispatcher::Mode::Direct);
+            dispatcher.setOutput(nullptr);
+            return seconds;
+        };
+        CountingSink directText, modeText;
+        double directSeconds = throughDispatcher(MessageDispatcher::Mode::Direct, directText);
+        double modeSeconds = throughDispatcher(mode, modeText);
+        const char *modeName = mode == MessageDispatcher::Mode::Direct ? "Direct" : mode == MessageDispatcher::Mode::Queued ? "Queued" : "Bus";
+
+        size_t total = rounds * kVerbs;
+        bool same = oldText.bytes == newText.bytes && directText.bytes == newText.bytes && modeText.bytes == newText.bytes && found == total;
+        std::printf("%zu messages over %zu verbs%s\n", total, kVerbs, same ? "" : " (the two sides disagree!)");
+        std::printf("  legacy string if-chain       %8.3f s  %6.2f ns/message\n", oldSeconds, oldSeconds * 1e9 / total);
+        std::printf("  opcode MessageTable          %8.3f s  %6.2f ns/message (%.1fx)\n", newSeconds, newSeconds * 1e9 / total, oldSeconds / newSeconds);
+        std::printf("  opcodeFromName at the edge   %8.3f s  %6.2f ns/name\n", edgeSeconds, edgeSeconds * 1e9 / total);
+        std::printf("  sendMessage, Direct          %8.3f s  %6.2f ns/message\n", directSeconds, directSeconds * 1e9 / total);
+        std::printf("  sendMessage, %-6s + drain  %8.3f s  %6.2f ns/message (%.2fx Direct)\n", modeName, modeSeconds, modeSeconds * 1e9 / total, directSeconds / modeSeconds);
+        return same ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- broadcast
+
+    // one message to every one of N recipients (default 10000), N rounds (default
+    // 500): a loop of sendMessage calls against a single publish to a topic they
+    // all subscribe to, in Direct mode and in Queued mode with a drain after each
+    // round. the handlers only count, so the fan-out itself is what's timed
+    int benchBroadcast(int argc, char *argv[])
+    {
+        size_t subscribers = 10000, rounds = 500;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--subscribers")
+                subscribers = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+        }
+        MessageDispatcher dispatcher;
+        size_t received = 0;
+        std::vector<EntityId> ids;
+        Topic everyone = Topic::location(1);
+        for (size_t i = 0; i < subscribers; ++i)
+        {
+            EntityId id = dispatcher.registerRecipient([&received](const Message &)
+                                                       { ++received; });
+            ids.push_back(id);
+            dispatcher.subscribe(everyone, id);
+        }
+
+        size_t total = subscribers * rounds;
+        std::printf("%zu rounds to %zu subscribers\n", rounds, subscribers);
+        bool same = true;
+        for (MessageDispatcher::Mode mode : {MessageDispatcher::Mode::Direct, MessageDispatcher::Mode::Queued})
+        {
+            dispatcher.setMode(mode);
+            const char *modeName = mode == MessageDispatcher::Mode::Direct ? "Direct" : "Queued";
+
+            received = 0;
+            auto start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (EntityId id : ids)
+                    dispatcher.sendMessage({kNoEntity, id, Opcode::Inspect, {}});
+                dispatcher.drain();
+            }
+            double loopSeconds = secondsSince(start);
+            same = same && received == total;
+
+            received = 0;
+            start = Clock::now();
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                dispatcher.publish(everyone, kNoEntity, Opcode::Inspect);
+                dispatcher.drain();
+            }
+            double publishSeconds = secondsSince(start);
+            same = same && received == total;
+
+            std::printf("  %s, sendMessage loop        %8.3f s  %6.2f ns/recipient\n", modeName, loopSeconds, loopSeconds * 1e9 / total);
+            std::printf("  %s, publish                 %8.3f s  %6.2f ns/recipient (%.1fx)\n", modeName, publishSeconds, publishSeconds * 1e9 / total, loopSeconds / publishSeconds);
+        }
+        if (!same)
+            std::printf("  (some subscribers missed a message!)\n");
+        return same ? 0 : 1;
+    }
+
+    // --------------------------------------------------------- commands
+
+    // a command that does nothing, so only finding it is timed
+    class NopCommand : public Command
+    {
+    public:
+        bool execute(Game &, const ParsedCommand &, OutputBuffer &) override { return true; }
+    };
+
+    namespace legacy
+    {
+        // CommandManager before the trie: a map of names and a map of aliases,
+        // looked up the way executeCommand did, minus running the command
+        class CommandTable
+        {
+        public:
+            void registerCommand(const std::string &name, std::unique_ptr<Command> command)
+            {
+                commands[name] = std::move(command);
+            }
+            void addAlias(const std::string &alias, const std::string &originalCommand)
+            {
+                if (commands.find(originalCommand) != commands.end())
+                    aliases[alias] = originalCommand;
+            }
+            Command *resolve(const std::string &name)
+            {
+                std::string commandName = name;
+                if (aliases.find(commandName) != aliases.end())
+                    commandName = aliases[commandName];
+                if (commands.find(commandName) != commands.end())
+                    return commands[commandName].get();
+                return nullptr;
+            }
+
+        private:
+            std::unordered_map<std::string, std::unique_ptr<Command>> commands;
+            std::unordered_map<std::string, std::string> aliases;
+        };
+
+        // Game::processUInput up to the table: split off the first word, lowercase
+        // it, and send LOOK IN to its own entry
+        Command *lookup(CommandTable &table, const std::string &line)
+        {
+            std::istringstream iss(line);
+            std::string cmd, args;
+            iss >> cmd;
+            std::getline(iss, args);
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c)
+                           { return std::tolower(c); });
+            args = trim(args);
+            if (cmd == "look" && args.rfind("in ", 0) == 0)
+                return table.resolve("look in");
+            return table.resolve(cmd);
+        }
+    }
+
+    // a command table in both shapes, and lines typed against it
+    struct CommandSet
+    {
+        std::string label;
+        legacy::CommandTable old;
+        CommandManager current;
+        std::vector<std::string> lines;
+        std::vector<std::string> abbreviated; // the trie only: each line's first word cut to 3 letters
+    };
+
+    // the game's own commands and aliases, and the example session's lines
+    void gameCommands(CommandSet &set)
+    {
+        set.label = "the game's";
+        for (const char *name : {"go", "help", "inventory", "look", "look in", "take", "alias", "debug",
+                                 "stats", "quit", "put", "open", "use", "north", "south", "east", "west"})
+        {
+            set.old.registerCommand(name, std::make_unique<NopCommand>());
+            set.current.registerCommand(name, std::make_unique<NopCommand>());
+        }
+        for (const char *direction : {"north", "south", "east", "west"})
+        {
+            set.old.addAlias(std::string(direction, 1), direction);
+            set.current.addAlias(std::string_view(direction, 1), direction);
+        }
+        set.old.addAlias("move", "go");
+        set.current.addAlias("move", "go");
+        const char *typed[] = {"look", "take rock", "Inventory", "look in bag", "take coin from bag", "look at coin",
+                               "go west", "take basket", "look in basket", "use apple", "n", "move south",
+                               "open chest with key", "put gem in bag", "help", "dance wildly"};
+        for (size_t i = 0; i < 4096; ++i)
+            set.lines.push_back(typed[i % (sizeof(typed) / sizeof(typed[0]))]);
+    }
+
+    // N made up names, every fourth an alias of the one before, typed with an
+    // argument; one line in eight names nothing
+    void syntheticCommands(CommandSet &set, size_t names)
+    {
+        set.label = std::to_string(names);
+        std::mt19937 rng(7);
+        std::vector<std::string> words;
+        while (words.size() < names)
+        {
+            std::string word;
+            for (size_t length = 3 + rng() % 8; word.size() < length;)
+                word.push_back(static_cast<char>('a' + rng() % 26));
+            words.push_back(word);
+        }
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            if (i % 4 == 3)
+            {
+                set.old.addAlias(words[i], words[i - 1]);
+                set.current.addAlias(words[i], words[i - 1]);
+            }
+            else
+            {
+                set.old.registerCommand(words[i], std::make_unique<NopCommand>());
+                set.current.registerCommand(words[i], std::make_unique<NopCommand>());
+            }
+        }
+        for (size_t i = 0; i < 4096; ++i)
+            set.lines.push_back(i % 8 == 7 ? "zz9 north" : words[rng() % words.size()] + " north");
+    }
+
+    // finding the command every line starts with, N times over, through the
+    // name and alias maps and through the trie
+    namespace legacy
+    {
+        // the text of LOOK, INVENTORY and HELP as the commands wrote it before the
+        // OutputBuffer, a piece per insertion; run on std::cout it is the old path,
+        // on an OutputBuffer the current one, so only where the pieces go differs
+        template <typename Out>
+        void commandText(Out &out, const Game &game, size_t which)
+        {
+            if (which == 0)
+            {
+                const auto &location = game.graph.locations.at(game.player.getCurrentLocation());
+                out << "\n"
+                    << location->name.str() << "\n"
+                    << location->description.str() << "\n";
+                out << location->getEntityDescriptions();
+                out << "\n";
+            }
+            else if (which == 1)
+            {
+                out << "\n----- Inventory -----\n";
+                for (EntityHandle handle : game.player.getInventory().handles())
+                    out << "- " << game.graph.entities.get(handle)->getName() << "\n";
+                out << "---------------------\n";
+            }
+            else
+            {
+                out << "\nAvailable commands:\n";
+                out << "\nDisclaimer: A 'container' is an item that can have other items inside!:\n";
+                out << "\n--- Navigation Commands ---\n";
+                out << "GO [Compass direction]\n";
+                out << "\n--- Inspection Commands ---\n";
+                out << "LOOK\n";
+                out << "LOOK AT [entity]\n";
+                out << "LOOK IN [container]\n";
+                out << "\n--- Inventory Commands ---\n";
+                out << "INVENTORY\n";
+                out << "TAKE [item] FROM [container]\n";
+                out << "PUT [item] IN [container]\n";
+                out << "OPEN [locked container] WITH [item]\n";
+                out << "USE [item] \n";
+                out << "\n--- System Commands ---\n";
+                out << "HELP\n";
+                out << "ALIAS [new command] [existing command]\n";
+                out << "DEBUG\n";
+                out << "QUIT\n";
+            }
+        }
+    }
+
+    // the example world played with its game text going to a file: the whole game
+    // through runBatch, then the text alone, written the old way to a redirected
+    // stdout and the current way through an OutputBuffer into a FileSink
+    bool benchPlay(size_t lines)
+    {
+        const char *kSession[] = {"look", "inventory", "look at rock", "help", "look in bag", "put rock in bag", "take rock from bag"};
+        constexpr size_t kSessionLines = sizeof(kSession) / sizeof(kSession[0]);
+        std::string script;
+        for (size_t i = 0; i < lines; ++i)
+            script.append(kSession[i % kSessionLines]).push_back('\n');
+        std::string path = (std::filesystem::temp_directory_path() / "zorkbench_output.txt").string();
+
+        Game game("../world/example_world.txt");
+        if (game.graph.locations.empty())
+            return false;
+        game.setOutputSink(std::make_unique<NullSink>());
+        game.processUInput("take rock");
+        std::printf("\nthe example world, %zu lines with the game text going to %s\n", lines, path.c_str());
+        auto play = [&](const char *label, std::unique_ptr<OutputSink> output)
+        {
+            game.setOutputSink(std::move(output));
+            std::istringstream input(script);
+            Game::BatchResult result = game.runBatch(input);
+            std::printf("  %-28s %8.3f s  %10.0f commands/s\n", label, result.seconds, result.commands / result.seconds);
+            return result.commands;
+        };
+        std::filesystem::remove(path);
+        uint64_t commands = play("game, FileSink", std::make_unique<FileSink>(path));
+        play("game, NullSink", std::make_unique<NullSink>());
+
+        // just the text of LOOK, INVENTORY and HELP, the same number of times
+        std::filesystem::remove(path);
+        inChild([&]
+                {
+            int terminal = ::dup(STDOUT_FILENO);
+            if (!std::freopen(path.c_str(), "w", stdout))
+                return;
+            auto start = Clock::now();
+            for (size_t i = 0; i < commands; ++i)
+                legacy::commandText(std::cout, game, i % 3);
+            std::cout.flush();
+            std::fflush(stdout);
+            double seconds = secondsSince(start);
+            ::dup2(terminal, STDOUT_FILENO);
+            std::printf("  text, std::cout to a file    %8.3f s  %10.0f commands/s\n", seconds, commands / seconds); });
+        size_t oldBytes = std::filesystem::file_size(path);
+
+        std::filesystem::remove(path);
+        double seconds;
+        {
+            FileSink file(path);
+            OutputBuffer out(file);
+            auto start = Clock::now();
+            for (size_t i = 0; i < commands; ++i)
+            {
+                legacy::commandText(out, game, i % 3);
+                out.flush();
+            }
+            seconds = secondsSince(start);
+        }
+        std::printf("  text, OutputBuffer + FileSink %7.3f s  %10.0f commands/s\n", seconds, commands / seconds);
+        bool same = std::filesystem::file_size(path) == oldBytes;
+        std::filesystem::remove(path);
+        if (!same)
+            std::printf("  (the two files differ in size!)\n");
+        return same;
+    }
+
+    int benchCommands(int argc, char *argv[])
+    {
+        size_t rounds = 200, lines = 200000;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--rounds")
+                rounds = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--lines")
+                lines = std::strtoul(argv[++i], nullptr, 10);
+        }
+        Parser parser([](Symbol) -> Entity *
+                      { return nullptr; });
+
+        std::printf("4096 lines %zu times, ns/line; \"whole\" splits or tokenizes the line first, \"lookup\" is given the words\n", rounds);
+        std::printf("  names          legacy whole  lookup    trie whole         lookup   3 letter prefixes\n");
+        bool same = true;
+        for (size_t names : {size_t(0), size_t(1000), size_t(100000)})
+        {
+            CommandSet set;
+            if (names == 0)
+                gameCommands(set);
+            else
+                syntheticCommands(set, names);
+
+            // what each side looks up once the line is split: the old one a name
+            // (LOOK IN by hand), the trie the whole tokenized line
+            std::vector<std::string> oldNames, tokenized;
+            for (const auto &line : set.lines)
+            {
+                std::string first = line.substr(0, line.find(' '));
+                std::transform(first.begin(), first.end(), first.begin(), [](unsigned char c)
+                               { return std::tolower(c); });
+                oldNames.push_back(first == "look" && line.find(" in ") != std::string::npos ? "look in" : first);
+                tokenized.emplace_back(parser.tokenize(line));
+                set.abbreviated.push_back(tokenized.back().substr(0, std::min<size_t>(3, tokenized.back().find(' '))));
+            }
+
+            // both sides must find a command for the same lines before either is timed
+            for (size_t i = 0; i < set.lines.size(); ++i)
+            {
+                bool oldHit = legacy::lookup(set.old, set.lines[i]) != nullptr;
+                same = same && oldHit == (set.old.resolve(oldNames[i]) != nullptr) &&
+                       oldHit == (set.current.find(parser.tokenize(set.lines[i])).entry != nullptr);
+            }
+
+            // runs find over every line rounds times, in ns per line
+            size_t found = 0;
+            auto time = [&](auto find)
+            {
+                auto start = Clock::now();
+                for (size_t round = 0; round < rounds; ++round)
+                {
+                    for (size_t i = 0; i < set.lines.size(); ++i)
+                        found += find(i);
+                }
+                return secondsSince(start) * 1e9 / static_cast<double>(rounds * set.lines.size());
+            };
+            double oldWhole = time([&](size_t i)
+                                   { return legacy::lookup(set.old, set.lines[i]) != nullptr; });
+            double oldLookup = time([&](size_t i)
+                                    { return set.old.resolve(oldNames[i]) != nullptr; });
+            double newWhole = time([&](size_t i)
+                                   { return set.current.find(parser.tokenize(set.lines[i])).entry != nullptr; });
+            double newLookup = time([&](size_t i)
+                                    { return set.current.find(tokenized[i]).entry != nullptr; });
+            size_t before = found;
+            double prefix = time([&](size_t i)
+                                 { return set.current.find(set.abbreviated[i]).entry != nullptr; });
+            size_t prefixFound = found - before;
+            sink = found;
+
+            std::printf("  %-11s  %14.1f  %6.1f  %6.1f (%4.1fx)  %6.1f (%4.1fx)  %6.1f, %zu%% found\n", set.label.c_str(),
+                        oldWhole, oldLookup, newWhole, oldWhole / newWhole, newLookup, oldLookup / newLookup, prefix,
+                        prefixFound * 100 / (rounds * set.lines.size()));
+        }
+        if (!same)
+            std::printf("the two sides disagree on which lines name a command!\n");
+        bool played = benchPlay(lines);
+        return same && played ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- bus
+
+    // what a lock would cost: the same bounded queue, guarded by a mutex
+    class MutexQueue
+    {
+    public:
+        explicit MutexQueue(size_t capacity) : capacity(capacity) {}
+        bool push(const Message &message)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (messages.size() == capacity)
+                return false;
+            messages.push_back(message);
+            return true;
+        }
+        bool pop(Message &message)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (messages.empty())
+                return false;
+            message = messages.front();
+            messages.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::deque<Message> messages;
+        size_t capacity;
+    };
+
+    constexpr size_t kBusRecipients = 64;
+    constexpr size_t kBusQueueCapacity = 4096;
+
+    // producers push into the shard of each message's recipient and one consumer
+    // per shard pops, with no handlers: the queue's own messages per second
+    template <typename Queue>
+    double queueThroughput(unsigned producers, unsigned shardCount, size_t perProducer)
+    {
+        std::vector<std::unique_ptr<Queue>> queues;
+        for (unsigned i = 0; i < shardCount; ++i)
+            queues.push_back(std::make_unique<Queue>(kBusQueueCapacity));
+        size_t total = perProducer * producers;
+        std::atomic<size_t> received{0};
+
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned shard = 0; shard < shardCount; ++shard)
+        {
+            threads.emplace_back([&, shard]
+                                 {
+                Message message;
+                while (received.load(std::memory_order_relaxed) < total)
+                {
+                    if (queues[shard]->pop(message))
+                        received.fetch_add(1, std::memory_order_relaxed);
+                    else
+                        std::this_thread::yield();
+                } });
+        }
+        for (unsigned producer = 0; producer < producers; ++producer)
+        {
+            threads.emplace_back([&, producer]
+                                 {
+                for (size_t i = 0; i < perProducer; ++i)
+                {
+                    EntityId to = i % kBusRecipients + 1;
+                    while (!queues[to % shardCount]->push({producer, to, Opcode::Heal, static_cast<int>(i)}))
+                        std::this_thread::yield();
+                } });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        return total / secondsSince(start);
+    }
+
+    // the whole MessageBus: recipient lookup, handlers on the shard threads, statistics
+    double busThroughput(unsigned producers, unsigned shardCount, size_t perProducer)
+    {
+        MessageBus bus(shardCount, kBusQueueCapacity);
+        std::vector<EntityId> ids;
+        for (size_t i = 0; i < kBusRecipients; ++i)
+            ids.push_back(bus.registerRecipient([](const Message &) {}));
+        size_t total = perProducer * producers;
+
+        auto start = Clock::now();
+        bus.start();
+        std::vector<std::thread> threads;
+        for (unsigned producer = 0; producer < producers; ++producer)
+        {
+            threads.emplace_back([&, producer]
+                                 {
+                for (size_t i = 0; i < perProducer; ++i)
+                    bus.send({producer, ids[i % kBusRecipients], Opcode::Heal, static_cast<int>(i)}); });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        while (bus.delivered() < total)
+            std::this_thread::yield();
+        double seconds = secondsSince(start);
+        bus.stop();
+        return total / seconds;
+    }
+
+    // MessageDispatcher in Bus mode: producers post from their threads, this one drains
+    double dispatcherThroughput(unsigned producers, size_t perProducer)
+    {
+        MessageDispatcher dispatcher;
+        dispatcher.setMode(MessageDispatcher::Mode::Bus);
+        size_t received = 0;
+        std::vector<MessageDispatcher::Registration> recipients;
+        for (size_t i = 0; i < kBusRecipients; ++i)
+            recipients.emplace_back(dispatcher, dispatcher.registerRecipient([&](const Message &)
+                                                                             { ++received; }));
+        std::vector<EntityId> ids;
+        for (const auto &recipient : recipients)
+            ids.push_back(recipient.id());
+        size_t total = perProducer * producers;
+
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned producer = 0; producer < producers; ++producer)
+        {
+            threads.emplace_back([&, producer]
+                                 {
+                for (size_t i = 0; i < perProducer; ++i)
+                    dispatcher.postFromAnyThread({producer, ids[i % kBusRecipients], Opcode::Heal, static_cast<int>(i)}); });
+        }
+        while (received < total)
+        {
+            if (dispatcher.drain() == 0)
+                std::this_thread::yield();
+        }
+        double seconds = secondsSince(start);
+        for (auto &thread : threads)
+            thread.join();
+        return total / seconds;
+    }
+
+    // 1 to 32 producers sending to 64 recipients
+    int benchBus(int argc, char *argv[])
+    {
+        size_t messages = 2000000;
+        unsigned shards = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--messages")
+                messages = std::strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--shards")
+                shards = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        std::printf("%zu messages to %zu recipients over %u shards, %u cores, million messages/s\n",
+                    messages, kBusRecipients, shards, std::thread::hardware_concurrency());
+        std::printf("  producers  mutex queue  MpscQueue  MessageBus  dispatcher Bus mode\n");
+        for (unsigned producers : {1u, 2u, 4u, 8u, 16u, 32u})
+        {
+            size_t perProducer = messages / producers;
+            std::printf("  %9u  %11.2f  %9.2f  %10.2f  %19.2f\n", producers,
+                        queueThroughput<MutexQueue>(producers, shards, perProducer) / 1e6,
+                        queueThroughput<MpscQueue<Message>>(producers, shards, perProducer) / 1e6,
+                        busThroughput(producers, shards, perProducer) / 1e6,
+                        dispatcherThroughput(producers, perProducer) / 1e6);
+        }
+        return 0;
+    }
+
+    void usage()
+    {
+        std::cerr << "Usage: zorkbench load [--locations N] [--threads N] [WORLD]\n"
+                  << "       zorkbench properties [--rounds N]\n"
+                  << "       zorkbench components [--rounds N]\n"
+                  << "       zorkbench scan [--entities N] [--rounds N]\n"
+                  << "       zorkbench entities [--entities N] [--moves N]\n"
+                  << "       zorkbench symbols [--entities N] [--rounds N]\n"
+                  << "       zorkbench dispatch [--rounds N] [--mode direct|queued|bus]\n"
+                  << "       zorkbench broadcast [--subscribers N] [--rounds N]\n"
+                  << "       zorkbench commands [--rounds N] [--lines N]\n"
+                  << "       zorkbench bus [--messages N] [--shards N]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    std::string what = argv[1];
+    if (what == "load")
+        return benchLoad(argc - 2, argv + 2);
+    if (what == "properties")
+        return benchProperties(argc - 2, argv + 2);
+    if (what == "components")
+        return benchComponents(argc - 2, argv + 2);
+    if (what == "scan")
+        return benchScan(argc - 2, argv + 2);
+    if (what == "entities")
+        return benchEntities(argc - 2, argv + 2);
+    if (what == "symbols")
+        return benchSymbols(argc - 2, argv + 2);
+    if (what == "dispatch")
+        return benchDispatch(argc - 2, argv + 2);
+    if (what == "broadcast")
+        return benchBroadcast(argc - 2, argv + 2);
+    if (what == "commands")
+        return benchCommands(argc - 2, argv + 2);
+    if (what == "bus")
+        return benchBus(argc - 2, argv + 2);
+    usage();
+    return 1;
+}
@@ -0,0 +1,140 @@
+#include "../src/Graph.h"
+#include "../src/WorldImage.h"
+#include "../src/MessageDispatcher.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// zorkc - compiles a text world into a .zwb world image
+//
+// To compile (if you're using cl.exe from MSVC):
+//  Navigate to the Zorkish_Adventure/tools (directory) in your CLI terminal
+//  Run: cl /EHsc /std:c++17 zorkc.cpp ../src/Graph.cpp ../src/MessageDispatcher.cpp ../src/MappedFile.cpp ../src/WorldImage.cpp ../src/ComponentRegistry.cpp ../src/Log.cpp ../src/OutputSink.cpp ../src/Symbol.cpp ../src/MessageTable.cpp ../src/DispatchStats.cpp /link /out:zorkc.exe
+//
+// Usage: zorkc [--verify] [--threads N] <input.txt> <output.zwb>
+//  --verify reloads the image and checks it describes the same world as the text
+//  --threads tokenizes the text world on N threads (0 = one per core); fewer only when
+//   the world has fewer locations than N, which is logged
+
+// writes one entity (and its contents) in a canonical form
+static void dumpEntity(std::ostream &out, const Entity &entity, int depth)
+{
+    out << std::string(depth * 2, ' ') << entity.getName() << ": " << entity.getDescription() << " [";
+    if (entity.hasComponent<TakeableComponent>())
+        out << " Takeable";
+    if (entity.getComponent<ContainerComponent>())
+        out << " Container";
+    if (auto openable = entity.getComponent<OpenableComponent>())
+        out << " Openable(" << openable->isOpen() << ")";
+    if (auto lockable = entity.getComponent<LockableComponent>())
+        out << " Lockable(" << lockable->getKey() << "," << lockable->isLocked() << ")";
+    if (auto health = entity.getComponent<HealthComponent>())
+        out << " Health(" << health->getHealth() << ")";
+    if (auto usable = entity.getComponent<UsableComponent>())
+        out << " Usable(" << static_cast<int>(usable->getEffectType()) << "," << usable->getEffectValue() << ")";
+    // covers component types added since, which the checks above don't know
+    out << " ] signature " << entity.getSignature() << "\n";
+    for (EntityHandle child : entity.getContainedEntities())
+        dumpEntity(out, *entity.resolve(child), depth + 1);
+}
+
+// writes the whole world in a canonical form so two loads can be compared as text
+static std::string dumpWorld(const Graph &graph)
+{
+    std::map<int, std::shared_ptr<Location>> sorted(graph.locations.begin(), graph.locations.end());
+    std::ostringstream out;
+    for (const auto &[id, location] : sorted)
+    {
+        out << id << "; " << location->name.str() << "; " << location->description.str() << "\n";
+        std::map<std::string, int> connections;
+        for (const auto &[direction, target] : location->connections)
+            connections[direction.str()] = target ? target->number : -1;
+        for (const auto &[direction, target] : connections)
+            out << "  -> " << direction << "=" << target << "\n";
+        for (EntityHandle entity : location->getEntities())
+            dumpEntity(out, *graph.entities.get(entity), 1);
+    }
+    return out.str();
+}
+
+// reports the first line where two dumps disagree
+static void reportDifference(const std::string &expected, const std::string &actual)
+{
+    std::istringstream a(expected), b(actual);
+    std::string lineA, lineB;
+    for (int line = 1;; ++line)
+    {
+        bool hasA = static_cast<bool>(std::getline(a, lineA));
+        bool hasB = static_cast<bool>(std::getline(b, lineB));
+        if (!hasA && !hasB)
+            return;
+        if (lineA != lineB || hasA != hasB)
+        {
+            std::cerr << "first difference at line " << line << ":\n  text:  " << (hasA ? lineA : "<end>")
+                      << "\n  image: " << (hasB ? lineB : "<end>") << "\n";
+            return;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool verify = false;
+    unsigned threads = 1;
+    int arg = 1;
+    for (; arg < argc; ++arg)
+    {
+        std::string option = argv[arg];
+        if (option == "--verify")
+            verify = true;
+        else if (option == "--threads" && arg + 1 < argc)
+            threads = static_cast<unsigned>(std::strtoul(argv[++arg], nullptr, 10));
+        else
+            break;
+    }
+    if (argc - arg != 2)
+    {
+        std::cerr << "Usage: zorkc [--verify] [--threads N] <input.txt> <output.zwb>\n";
+        return 2;
+    }
+    std::string input = argv[arg];
+    std::string output = argv[arg + 1];
+
+    MessageDispatcher dispatcher;
+    Graph graph(dispatcher);
+    graph.setLoaderThreads(threads);
+    graph.loadFromFile(input);
+    if (graph.locations.empty())
+    {
+        std::cerr << "Error: no locations loaded from " << input << "\n";
+        return 1;
+    }
+
+    if (!WorldImage::write(graph, output))
+    {
+        std::cerr << "Error: could not write " << output << "\n";
+        return 1;
+    }
+    std::cout << "compiled " << graph.locations.size() << " locations into " << output << "\n";
+
+    if (verify)
+    {
+        MessageDispatcher imageDispatcher;
+        Graph imageGraph(imageDispatcher);
+        imageGraph.loadFromBinary(output);
+
+        std::string expected = dumpWorld(graph);
+        std::string actual = dumpWorld(imageGraph);
+        if (expected != actual)
+        {
+            std::cerr << "verify failed: " << output << " does not match " << input << "\n";
+            reportDifference(expected, actual);
+            return 1;
+        }
+        std::cout << "verified: image matches text world\n";
+    }
+    return 0;
+}
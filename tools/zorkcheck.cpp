@@ -0,0 +1,800 @@
+#include "../src/ComponentRegistry.h"
+#include "../src/Game.h"
+#include "../src/MessageBus.h"
+#include "../src/Server.h"
+#include "../src/WorldImage.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// zorkcheck - pass/fail checks for promises the code makes that playing the game
+// wouldn't show, e.g. that a path doesn't allocate or that typed names don't grow
+// the symbol table. exits with 0 when every check passed, 1 otherwise
+//
+// To compile:
+//  Navigate to the Zorkish_Adventure/tools (directory) in your CLI terminal
+//  Run: g++ -O2 -std=c++17 -pthread zorkcheck.cpp $(ls ../src/*.cpp | grep -v main.cpp) -o zorkcheck
+//
+// Usage: zorkcheck allocs [WORLD]
+//        zorkcheck bus [--shards N]
+//        zorkcheck soak [--rounds N]
+//        zorkcheck serve [WORLD]
+//        zorkcheck image [WORLD]
+//  allocs checks that sending and delivering each kind of message payload, to a
+//   small handler and to a location's, and parsing and resolving input lines
+//   never allocate once warmed up, and that taking things nobody has heard of
+//   doesn't intern their names. WORLD defaults to ../world/example_world.txt
+//  bus has 1 to 32 threads send to 64 recipients over N shards (default 4) and
+//   checks every message arrives once and in each sender's order; that senders
+//   waiting on a full shard give up when the bus stops; and that a dispatcher in
+//   Bus mode runs other threads' messages on its own thread and refuses to be
+//   used, or let the symbol table be used, from any other
+//  soak has handlers grow and shrink the recipient table under themselves, then
+//   creates, broadcasts to and destroys 100000 entities for N rounds (default 20)
+//   and checks that the dispatcher's tables and resident memory come back down
+//  serve runs a server on a unix socket and checks that clients shutting down
+//   their sending side still get every answer, WORLD as for allocs
+//  image compiles a world using every form of every built-in property, then
+//   WORLD (as for allocs), into .zwb images and checks that loading each image
+//   gives back the same entities and components, and that the image's components
+//   are built by whatever factory is registered for them at load time
+
+// every allocation the process makes goes through here so a check can count them
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+namespace
+{
+    int failures = 0;
+
+    // prints one check's outcome and remembers a failure
+    void report(bool passed, const std::string &what)
+    {
+        std::cout << (passed ? "ok    " : "FAIL  ") << what << std::endl;
+        if (!passed)
+            ++failures;
+    }
+
+    // allocations made by body
+    template <typename Body>
+    size_t allocationsIn(Body body)
+    {
+        size_t before = allocations;
+        body();
+        return allocations - before;
+    }
+
+    // -------------------------------------------------------------- allocs
+
+    void checkPayloads()
+    {
+        MessageDispatcher dispatcher;
+        uint64_t received = 0;
+        MessageDispatcher::Registration recipient(dispatcher, dispatcher.registerRecipient([&](const Message &msg)
+                                                                                          { received += static_cast<uint64_t>(msg.data.getKind()) + 1; }));
+        const Payload payloads[] = {Payload(), Payload(7), Payload(EntityHandle()), Payload(Symbol::find("player"))};
+        const char *kinds[] = {"no", "an int", "an entity", "a symbol"};
+        constexpr int kSends = 100000;
+
+        for (auto mode : {MessageDispatcher::Mode::Direct, MessageDispatcher::Mode::Queued})
+        {
+            dispatcher.setMode(mode);
+            const char *modeName = mode == MessageDispatcher::Mode::Direct ? "direct" : "queued";
+            for (size_t kind = 0; kind < 4; ++kind)
+            {
+                auto send = [&](int count)
+                {
+                    for (int i = 0; i < count; ++i)
+                        dispatcher.sendMessage({kNoEntity, recipient.id(), Opcode::Inspect, payloads[kind]});
+                    dispatcher.drain();
+                };
+                send(kSends); // lets the queue and the statistics reach their size
+                received = 0;
+                size_t made = allocationsIn([&]
+                                            { send(kSends); });
+                report(made == 0 && received == kSends * (kind + 1),
+                       std::string(modeName) + " send of a message with " + kinds[kind] + " payload: " +
+                           std::to_string(made) + " allocations in " + std::to_string(kSends) + " sends");
+            }
+        }
+    }
+
+    // the handlers the game really registers capture more than std::function keeps
+    // inline (a location's is a shared_ptr and the graph), so they must be called
+    // where they are, never copied per message. the location is asked for something
+    // it doesn't have, the way TAKE asks for a thing that isn't there
+    void checkLocationSends(Game &game)
+    {
+        MessageDispatcher &dispatcher = game.dispatcher;
+        EntityId location = game.graph.locations.at(game.player.getCurrentLocation())->id;
+        Symbol missing = Symbol::find("player");
+        constexpr int kSends = 100000;
+        for (auto mode : {MessageDispatcher::Mode::Direct, MessageDispatcher::Mode::Queued})
+        {
+            dispatcher.setMode(mode);
+            auto send = [&](int count)
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    dispatcher.sendMessage({game.player.getId(), location, Opcode::RemoveItem, missing});
+                    dispatcher.drain();
+                    game.output.flush();
+                    dispatcher.clearRefusal();
+                }
+            };
+            send(kSends);
+            size_t made = allocationsIn([&]
+                                        { send(kSends); });
+            report(location != kNoEntity && made == 0,
+                   std::string(mode == MessageDispatcher::Mode::Direct ? "direct" : "queued") +
+                       " RemoveItem to a location's handler: " + std::to_string(made) + " allocations in " +
+                       std::to_string(kSends) + " sends");
+        }
+        dispatcher.setMode(MessageDispatcher::Mode::Queued);
+    }
+
+    void checkParsing(Game &game)
+    {
+        const std::vector<std::string> lines = {"look", "take rock", "look at round rock", "  TAKE   Coin  FROM bag ",
+                                                "put gem in bag", "open chest with key", "use potion on player", "go north",
+                                                "alias grab take", "frobnicate x y", "inv", "l in bag", "n"};
+        size_t resolved = 0;
+        auto parseAll = [&](int rounds)
+        {
+            for (int round = 0; round < rounds; ++round)
+            {
+                for (const std::string &line : lines)
+                {
+                    CommandManager::Match match = game.commandManager.find(game.parser.tokenize(line));
+                    if (match.entry)
+                        resolved += game.parser.parse(match.entry->grammar, match.words).object.entity != nullptr;
+                }
+            }
+        };
+        parseAll(2); // the parser's buffers grow to fit the longest line
+        size_t made = allocationsIn([&]
+                                    { parseAll(10000); });
+        report(made == 0, "tokenizing, resolving and parsing " + std::to_string(10000 * lines.size()) +
+                              " input lines: " + std::to_string(made) + " allocations");
+    }
+
+    void checkTypedNames(Game &game)
+    {
+        // names nobody in the world has, built before counting starts
+        std::vector<std::string> lines;
+        for (int i = 0; i < 10000; ++i)
+        {
+            std::string name = "thing" + std::to_string(i * 7919);
+            lines.push_back("take " + name);
+            lines.push_back("take " + name + " from bag");
+            lines.push_back("take " + name + " from chest");
+        }
+        size_t before = SymbolTable::instance().stats().symbols;
+        for (const std::string &line : lines)
+            game.processUInput(line);
+        size_t grown = SymbolTable::instance().stats().symbols - before;
+        report(grown == 0, "taking " + std::to_string(lines.size()) + " unknown things: the symbol table grew by " +
+                               std::to_string(grown) + " symbols");
+    }
+
+    int checkAllocs(int argc, char *argv[])
+    {
+        std::string world = argc > 0 ? argv[0] : "../world/example_world.txt";
+        Game game(world);
+        game.setOutputSink(std::make_unique<NullSink>());
+        if (game.graph.locations.empty())
+        {
+            std::cerr << "Error: could not load " << world << std::endl;
+            return 1;
+        }
+        checkPayloads();
+        checkLocationSends(game);
+        checkParsing(game);
+        checkTypedNames(game);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- bus
+
+    constexpr size_t kRecipients = 64;
+
+    // runs body on a thread and reports whether it finished in time; one that
+    // doesn't is left running, the check has failed and the process exits soon
+    template <typename Body>
+    bool finishesWithin(std::chrono::seconds limit, Body body)
+    {
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::thread([done, body]() mutable
+                    { body(); *done = true; })
+            .detach();
+        auto deadline = std::chrono::steady_clock::now() + limit;
+        while (!*done && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return *done;
+    }
+
+    // producer p sends its i-th message to recipient (p + i) % kRecipients carrying
+    // i / kRecipients, so every recipient sees 0, 1, 2... from each producer
+    struct OrderCheck
+    {
+        explicit OrderCheck(unsigned producers) : next(kRecipients)
+        {
+            for (auto &row : next)
+                row.resize(producers, 0);
+        }
+        void see(size_t recipient, const Message &message)
+        {
+            int &expected = next[recipient][message.from];
+            if (message.data.asInt() != expected)
+                ++outOfOrder;
+            expected = message.data.asInt() + 1;
+            ++received;
+        }
+        static size_t recipientOf(unsigned producer, size_t i) { return (producer + i) % kRecipients; }
+        static int sequenceOf(size_t i) { return static_cast<int>(i / kRecipients); }
+
+        std::vector<std::vector<int>> next; // [recipient][producer], a row is only touched by its recipient's thread
+        std::atomic<size_t> outOfOrder{0};
+        std::atomic<size_t> received{0};
+    };
+
+    // every message delivered exactly once and each producer's in order, with
+    // queues small enough that producers keep waiting for room
+    void checkBusDelivery(unsigned shards)
+    {
+        constexpr size_t kPerProducer = 50000;
+        for (unsigned producers : {1u, 2u, 4u, 8u, 16u, 32u})
+        {
+            MessageBus bus(shards, 64);
+            OrderCheck order(producers);
+            std::vector<EntityId> ids;
+            for (size_t r = 0; r < kRecipients; ++r)
+                ids.push_back(bus.registerRecipient([&order, r](const Message &message)
+                                                    { order.see(r, message); }));
+            bus.start();
+            std::atomic<size_t> refused{0};
+            std::vector<std::thread> threads;
+            for (unsigned producer = 0; producer < producers; ++producer)
+            {
+                threads.emplace_back([&, producer]
+                                     {
+                    for (size_t i = 0; i < kPerProducer; ++i)
+                    {
+                        if (!bus.send({producer, ids[OrderCheck::recipientOf(producer, i)], Opcode::Heal, OrderCheck::sequenceOf(i)}))
+                            ++refused;
+                    } });
+            }
+            for (auto &thread : threads)
+                thread.join();
+            bus.stop();
+            size_t sent = kPerProducer * producers;
+            report(refused == 0 && order.outOfOrder == 0 && order.received == sent && bus.delivered() == sent,
+                   "bus, " + std::to_string(producers) + " producers over " + std::to_string(bus.shardCount()) + " shards: " +
+                       std::to_string(order.received) + " of " + std::to_string(sent) + " delivered, " +
+                       std::to_string(order.outOfOrder.load()) + " out of order, " + std::to_string(refused.load()) + " sends refused");
+        }
+    }
+
+    // senders waiting on full shards must give up once the bus stops, rather than
+    // wait for room nobody will make
+    void checkBusStop()
+    {
+        // a consumer slower than its senders keeps the shard full
+        MessageBus bus(1, 16);
+        EntityId slow = bus.registerRecipient([](const Message &)
+                                              { std::this_thread::sleep_for(std::chrono::microseconds(20)); });
+        bus.start();
+        std::atomic<unsigned> gaveUp{0};
+        std::vector<std::thread> senders;
+        for (unsigned producer = 0; producer < 4; ++producer)
+        {
+            senders.emplace_back([&, producer]
+                                 {
+                while (bus.send({producer, slow, Opcode::Heal, {}}))
+                {
+                }
+                ++gaveUp; });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        bool stopped = finishesWithin(std::chrono::seconds(5), [&]
+                                      { bus.stop(); for (auto &sender : senders) sender.join(); });
+        report(stopped && gaveUp == 4, "bus, stopping with 4 senders waiting on a full shard: " +
+                                           std::string(stopped ? "" : "hung, ") + std::to_string(gaveUp.load()) + " of 4 sends failed");
+        if (!stopped)
+            std::_Exit(1); // the threads still use the bus
+    }
+
+    // the dispatcher's Bus mode: other threads post, the owner drains and runs
+    // every handler, and the owner-only parts refuse other threads
+    void checkDispatcherBus()
+    {
+        constexpr size_t kPerProducer = 20000;
+        constexpr unsigned kProducers = 8;
+        Symbol player = Symbol::find("player"); // the table belongs to this thread
+        MessageDispatcher dispatcher;
+        dispatcher.setMode(MessageDispatcher::Mode::Bus);
+        OrderCheck order(kProducers);
+        std::thread::id handlerThread;
+        bool handlersOnOwner = true;
+        std::vector<MessageDispatcher::Registration> recipients;
+        for (size_t r = 0; r < kRecipients; ++r)
+        {
+            recipients.emplace_back(dispatcher, dispatcher.registerRecipient([&, r](const Message &message)
+                                                                             {
+                handlersOnOwner = handlersOnOwner && std::this_thread::get_id() == handlerThread;
+                order.see(r, message); }));
+        }
+        handlerThread = std::this_thread::get_id();
+
+        std::atomic<size_t> refused{0};
+        std::vector<std::thread> threads;
+        for (unsigned producer = 0; producer < kProducers; ++producer)
+        {
+            threads.emplace_back([&, producer]
+                                 {
+                for (size_t i = 0; i < kPerProducer; ++i)
+                {
+                    if (!dispatcher.postFromAnyThread({producer, recipients[OrderCheck::recipientOf(producer, i)].id(), Opcode::Heal, OrderCheck::sequenceOf(i)}))
+                        ++refused;
+                } });
+        }
+        size_t sent = kPerProducer * kProducers;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (order.received < sent && std::chrono::steady_clock::now() < deadline)
+        {
+            if (dispatcher.drain() == 0)
+                std::this_thread::yield();
+        }
+        for (auto &thread : threads)
+            thread.join();
+        report(refused == 0 && order.outOfOrder == 0 && order.received == sent && handlersOnOwner,
+               "dispatcher Bus mode, " + std::to_string(kProducers) + " threads posting: " + std::to_string(order.received) + " of " +
+                   std::to_string(sent) + " delivered on the owner thread, " + std::to_string(order.outOfOrder.load()) + " out of order");
+
+        // what other threads may and may not do
+        bool sendThrew = false, internThrew = false, findThrew = false, readWorks = false;
+        std::thread([&]
+                    {
+            try { dispatcher.sendMessage({kNoEntity, recipients[0].id(), Opcode::Heal, 0}); }
+            catch (const std::logic_error &) { sendThrew = true; }
+            try { Symbol made("made on another thread"); }
+            catch (const std::logic_error &) { internThrew = true; }
+            try { Symbol::find("player"); }
+            catch (const std::logic_error &) { findThrew = true; }
+            readWorks = player.str() == "player" && player.folded() == player; })
+            .join();
+        report(sendThrew && internThrew && findThrew && readWorks,
+               "off the owner thread: sendMessage, interning and finding symbols throw, reading a symbol works");
+
+        dispatcher.setMode(MessageDispatcher::Mode::Queued);
+        bool postedAfter = true;
+        std::thread([&]
+                    { postedAfter = dispatcher.postFromAnyThread({kNoEntity, recipients[0].id(), Opcode::Heal, 0}); })
+            .join();
+        report(!postedAfter, "posting from another thread fails once the dispatcher leaves Bus mode");
+    }
+
+    int checkBus(int argc, char *argv[])
+    {
+        unsigned shards = 4;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--shards")
+                shards = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        if (Symbol::find("player").empty())
+            Symbol("player");
+        checkBusDelivery(shards);
+        checkBusStop();
+        checkDispatcherBus();
+        return failures == 0 ? 0 : 1;
+    }
+
+    // ------------------------------------------------------------- soak
+
+    // resident set size from /proc, 0 where there isn't one
+    long residentKb()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind("VmRSS:", 0) == 0)
+                return std::stol(line.substr(6));
+        }
+        return 0;
+    }
+
+    // handlers that change the recipient table while they run
+    void checkReentrantHandlers()
+    {
+        MessageDispatcher dispatcher;
+        dispatcher.setMode(MessageDispatcher::Mode::Queued);
+
+        // registering enough recipients to move the table, then using what the handler captured;
+        // the captures are small enough to live inside the std::function, so they move with the table
+        struct Growth
+        {
+            MessageDispatcher &dispatcher;
+            std::vector<MessageDispatcher::Registration> grown;
+            int seen = 0;
+        } growth{dispatcher, {}};
+        int tag = 42;
+        MessageDispatcher::Registration grower(dispatcher, dispatcher.registerRecipient([state = &growth, tag](const Message &)
+                                                                                        {
+            for (int i = 0; i < 10000; ++i)
+                state->grown.emplace_back(state->dispatcher, state->dispatcher.registerRecipient([](const Message &) {}));
+            state->seen = tag; }));
+        dispatcher.sendMessage({kNoEntity, grower.id(), Opcode::Inspect, {}});
+        dispatcher.drain();
+        report(growth.seen == tag && growth.grown.size() == 10000, "a handler registering 10000 recipients still sees its own captures");
+
+        // unregistering itself, with a second message already queued for it
+        MessageDispatcher::Registration self;
+        int calls = 0;
+        self = MessageDispatcher::Registration(dispatcher, dispatcher.registerRecipient([&](const Message &)
+                                                                                        { ++calls; self.reset(); }));
+        EntityId id = self.id();
+        dispatcher.sendMessage({kNoEntity, id, Opcode::Inspect, {}});
+        dispatcher.sendMessage({kNoEntity, id, Opcode::Inspect, {}});
+        dispatcher.drain();
+        report(calls == 1 && !dispatcher.isRegistered(id), "a handler unregistering itself runs once and its id goes stale");
+
+        // throwing out of a drain, after unregistering itself: the next drain still runs
+        // and the slot is still released
+        MessageDispatcher::Registration thrower;
+        thrower = MessageDispatcher::Registration(dispatcher, dispatcher.registerRecipient([&](const Message &)
+                                                                                           { thrower.reset(); throw std::runtime_error("handler failed"); }));
+        int after = 0;
+        MessageDispatcher::Registration next(dispatcher, dispatcher.registerRecipient([&](const Message &)
+                                                                                      { ++after; }));
+        size_t before = dispatcher.recipientCount();
+        dispatcher.sendMessage({kNoEntity, thrower.id(), Opcode::Inspect, {}});
+        dispatcher.sendMessage({kNoEntity, next.id(), Opcode::Inspect, {}});
+        bool threw = false;
+        try
+        {
+            dispatcher.drain();
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        size_t drained = dispatcher.drain();
+        report(threw && drained == 1 && after == 1 && dispatcher.recipientCount() == before - 1,
+               "a handler throwing out of a drain leaves the dispatcher able to drain and release again");
+    }
+
+    // creates, subscribes, broadcasts to and destroys entities in rounds; the
+    // dispatcher's tables and the process's memory must come back down each time
+    void checkChurn(int rounds)
+    {
+        constexpr int kPerRound = 100000;
+        MessageDispatcher dispatcher;
+        dispatcher.setMode(MessageDispatcher::Mode::Queued);
+        NullSink nowhere;
+        OutputBuffer output(nowhere);
+        dispatcher.setOutput(&output);
+        Graph graph(dispatcher);
+        Symbol name("thing"), description("a thing");
+        Topic here = Topic::location(1);
+        size_t recipientsBefore = dispatcher.recipientCount();
+
+        std::vector<EntityHandle> live;
+        live.reserve(kPerRound);
+        size_t leftRecipients = 0, leftSubscribers = 0, delivered = 0;
+        long afterFirst = 0, afterLast = 0;
+        for (int round = 0; round < rounds; ++round)
+        {
+            for (int i = 0; i < kPerRound; ++i)
+            {
+                EntityHandle handle = graph.entities.create(name, description, dispatcher);
+                dispatcher.subscribe(here, graph.entities.get(handle)->getId());
+                live.push_back(handle);
+            }
+            dispatcher.publish(here, kNoEntity, Opcode::Inspect);
+            delivered += dispatcher.drain();
+            output.flush();
+            for (EntityHandle handle : live)
+                graph.entities.destroy(handle);
+            live.clear();
+            // the topic lets go of its departed members when it is next published to
+            dispatcher.publish(here, kNoEntity, Opcode::Inspect);
+            dispatcher.drain();
+            leftRecipients = std::max(leftRecipients, dispatcher.recipientCount() - recipientsBefore);
+            leftSubscribers = std::max(leftSubscribers, dispatcher.subscribers(here).size());
+            (round == 0 ? afterFirst : afterLast) = residentKb();
+        }
+        if (rounds == 1)
+            afterLast = afterFirst;
+
+        size_t expected = static_cast<size_t>(kPerRound) * rounds;
+        report(delivered == expected && leftRecipients == 0 && leftSubscribers == 0,
+               std::to_string(rounds) + " rounds of " + std::to_string(kPerRound) + " entities: " + std::to_string(delivered) + " of " +
+                   std::to_string(expected) + " broadcasts delivered, at most " + std::to_string(leftRecipients) +
+                   " recipients and " + std::to_string(leftSubscribers) + " subscribers left after a round");
+        // allocator slack aside, later rounds reuse what the first one grew
+        report(afterLast <= afterFirst + afterFirst / 10 + 1024,
+               "resident memory after the first round " + std::to_string(afterFirst) + " kB, after the last " + std::to_string(afterLast) + " kB");
+    }
+
+    int checkSoak(int argc, char *argv[])
+    {
+        int rounds = 20;
+        for (int i = 0; i + 1 < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--rounds")
+                rounds = std::max(1, std::atoi(argv[++i]));
+        }
+        checkReentrantHandlers();
+        checkChurn(rounds);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // ------------------------------------------------------------ serve
+
+    // a blocking client connection to a unix socket; reads give up after 10 s
+    int connectTo(const std::string &path)
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", path.c_str());
+        timeval timeout{10, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    void sendAll(int fd, const std::string &text)
+    {
+        for (size_t sent = 0; sent < text.size();)
+        {
+            ssize_t written = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0)
+                return;
+            sent += static_cast<size_t>(written);
+        }
+    }
+
+    // everything the server sends until it closes the connection, or until a read times out
+    std::string readToEnd(int fd)
+    {
+        std::string text;
+        char buffer[16 * 1024];
+        ssize_t got;
+        while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+            text.append(buffer, static_cast<size_t>(got));
+        return text;
+    }
+
+    size_t prompts(const std::string &text)
+    {
+        size_t count = 0;
+        for (size_t at = text.find("\n> "); at != std::string::npos; at = text.find("\n> ", at + 1))
+            ++count;
+        return count;
+    }
+
+    // clients that stop sending (shutdown(SHUT_WR)) but keep reading: the server
+    // must answer everything they sent before it closes, however much is still
+    // queued to go out when it sees the end of their input
+    void checkHalfClose(const std::string &path)
+    {
+        constexpr size_t kLines = 5000; // more answer than the socket holds, less than the server stops reading at
+        std::string lines;
+        for (size_t i = 0; i < kLines; ++i)
+            lines += "look\n";
+
+        int many = connectTo(path);
+        sendAll(many, lines);
+        ::shutdown(many, SHUT_WR);
+        // not reading for a moment, so the server sees the end of the input with answers still unsent
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::string answers = readToEnd(many);
+        ::close(many);
+        report(many >= 0 && prompts(answers) == kLines + 1,
+               "sending " + std::to_string(kLines) + " lines then shutting down the sending side: " +
+                   std::to_string(answers.size()) + " bytes and " + std::to_string(prompts(answers)) + " of " +
+                   std::to_string(kLines + 1) + " prompts came back before the server closed");
+
+        int unterminated = connectTo(path);
+        sendAll(unterminated, "look at rock");
+        ::shutdown(unterminated, SHUT_WR);
+        std::string answer = readToEnd(unterminated);
+        ::close(unterminated);
+        report(answer.find("The Rock is inspected") != std::string::npos,
+               "a last line with no newline before shutting down is still answered");
+    }
+
+    int checkServe(int argc, char *argv[])
+    {
+        std::string file = argc > 0 ? argv[0] : "../world/example_world.txt";
+        World world;
+        world.load(file);
+        if (world.graph.locations.empty())
+        {
+            std::cerr << "Error: could not load " << file << std::endl;
+            return 1;
+        }
+        std::string path = (std::filesystem::temp_directory_path() / ("zorkcheck_" + std::to_string(::getpid()) + ".sock")).string();
+        Server server(world);
+        if (!server.listen("unix:" + path))
+        {
+            std::cerr << "Error: " << server.error() << std::endl;
+            return 1;
+        }
+        // the server runs on this thread, which owns the world; the clients get their own
+        std::thread clients([&]
+                            { checkHalfClose(path); Server::stop(); });
+        server.run();
+        clients.join();
+        return failures == 0 ? 0 : 1;
+    }
+
+    // -------------------------------------------------------------- image
+
+    // every form each built-in property takes
+    const char *const kImageWorld =
+        "1; Vault; A room with one of everything.; north=2;\n"
+        "    Satchel: A worn satchel.; [Takeable, Container, Openable=open]\n"
+        "        Ring: A plain ring.; [Takeable]\n"
+        "    Safe: A squat safe.; [Container, Openable, Lockable=Ring]\n"
+        "        Pin: A bent pin.; [Takeable]\n"
+        "    Box: A tin box.; [Container, Openable, Lockable=Pin, Unlocked]\n"
+        "    Tonic: A fizzing tonic.; [Takeable, Usable, Health=+4]\n"
+        "    Venom: A vial of venom.; [Takeable, Usable=-2]\n"
+        "    Golem: A clay golem.; [Health=12]\n"
+        "    Lamp: A dead lamp.; [Usable]\n"
+        "\n"
+        "2; Hall; An empty hall.; south=1;\n";
+
+    // an entity and its contents, one line each, read from the components
+    // themselves rather than through the registry's writers under test; the
+    // signature catches component types added since
+    void describeEntity(std::string &out, const Graph &graph, EntityHandle handle, int depth)
+    {
+        const Entity &entity = *graph.entities.get(handle);
+        out += std::string(depth * 2, ' ') + entity.getName() + ": " + entity.getDescription() + " [";
+        if (auto openable = entity.getComponent<OpenableComponent>())
+            out += " open=" + std::to_string(openable->isOpen());
+        if (auto lockable = entity.getComponent<LockableComponent>())
+            out += " key=" + lockable->getKey() + " locked=" + std::to_string(lockable->isLocked());
+        if (auto health = entity.getComponent<HealthComponent>())
+            out += " health=" + std::to_string(health->getHealth());
+        if (auto usable = entity.getComponent<UsableComponent>())
+            out += " use=" + std::to_string(static_cast<int>(usable->getEffectType())) + "," + std::to_string(usable->getEffectValue());
+        out += " ] signature " + std::to_string(entity.getSignature()) + "\n";
+        for (EntityHandle child : entity.getContainedEntities())
+            describeEntity(out, graph, child, depth + 1);
+    }
+
+    std::string describeWorld(const Graph &graph)
+    {
+        std::vector<int> ids;
+        for (const auto &entry : graph.locations)
+            ids.push_back(entry.first);
+        std::sort(ids.begin(), ids.end());
+        std::string out;
+        for (int id : ids)
+        {
+            const Location &location = *graph.locations.at(id);
+            out += std::to_string(id) + "; " + location.name.str() + "; " + location.description.str() + "\n";
+            for (EntityHandle handle : location.getEntities())
+                describeEntity(out, graph, handle, 1);
+        }
+        return out;
+    }
+
+    // compiles the text world at path into an image and loads both
+    void checkRoundTrip(const std::string &path, const std::string &image, const std::string &label)
+    {
+        MessageDispatcher textDispatcher;
+        Graph text(textDispatcher);
+        text.loadFromFile(path);
+        bool written = !text.locations.empty() && WorldImage::write(text, image);
+
+        MessageDispatcher imageDispatcher;
+        Graph loaded(imageDispatcher);
+        if (written)
+            loaded.loadFromBinary(image);
+        std::string expected = describeWorld(text);
+        report(written && expected == describeWorld(loaded),
+               label + " survives a .zwb round trip: " + std::to_string(text.entities.size()) + " entities, " +
+                   std::to_string(loaded.entities.size()) + " loaded back");
+    }
+
+    int checkImage(int argc, char *argv[])
+    {
+        std::string file = argc > 0 ? argv[0] : "../world/example_world.txt";
+        std::filesystem::path temp = std::filesystem::temp_directory_path();
+        std::string stem = "zorkcheck_" + std::to_string(::getpid());
+        std::string textPath = (temp / (stem + ".txt")).string();
+        std::string imagePath = (temp / (stem + ".zwb")).string();
+        {
+            std::ofstream out(textPath);
+            out << kImageWorld;
+        }
+        checkRoundTrip(textPath, imagePath, "every built-in property form");
+        checkRoundTrip(file, imagePath, file);
+
+        // re-registering a property the way a component's Registrar does: the
+        // image must be built by the new factory, not by anything the loader knows
+        size_t built = 0;
+        ComponentRegistry::instance().registerProperty(
+            "Takeable", [&](Entity &entity, const Property &, const PropertyList &)
+            { ++built; entity.addComponent<TakeableComponent>(); },
+            [](const Entity &entity, std::string &)
+            { return entity.hasComponent<TakeableComponent>(); });
+        MessageDispatcher dispatcher;
+        Graph loaded(dispatcher);
+        loaded.loadFromBinary(imagePath);
+        size_t takeable = loaded.registry.count<TakeableComponent>();
+        report(built != 0 && built == takeable,
+               "a re-registered property's factory builds the image's components: " + std::to_string(built) +
+                   " calls for " + std::to_string(takeable) + " takeable entities");
+
+        std::filesystem::remove(textPath);
+        std::filesystem::remove(imagePath);
+        return failures == 0 ? 0 : 1;
+    }
+
+    void usage()
+    {
+        std::cerr << "Usage: zorkcheck allocs [WORLD]\n"
+                  << "       zorkcheck bus [--shards N]\n"
+                  << "       zorkcheck soak [--rounds N]\n"
+                  << "       zorkcheck serve [WORLD]\n"
+                  << "       zorkcheck image [WORLD]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    std::string what = argv[1];
+    if (what == "allocs")
+        return checkAllocs(argc - 2, argv + 2);
+    if (what == "bus")
+        return checkBus(argc - 2, argv + 2);
+    if (what == "soak")
+        return checkSoak(argc - 2, argv + 2);
+    if (what == "serve")
+        return checkServe(argc - 2, argv + 2);
+    if (what == "image")
+        return checkImage(argc - 2, argv + 2);
+    usage();
+    return 1;
+}
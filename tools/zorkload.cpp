@@ -0,0 +1,293 @@
+#include "../src/DispatchStats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+
+// zorkload - plays many sessions against a server started with --serve, to measure it
+//
+// every session connects, waits for its greeting, then sends one command at a
+// time and waits for the prompt that ends the answer before sending the next, so
+// the figures are round trips as a player would see them. sessions walk the
+// command list from different starting points so they don't all do the same
+// thing at once. linux only, like the server.
+//
+// To compile:
+//  Navigate to the Zorkish_Adventure/tools (directory) in your CLI terminal
+//  Run: g++ -O2 -std=c++17 zorkload.cpp -o zorkload
+//
+// Usage: zorkload [--sessions N] [--seconds S] [--commands "cmd|cmd|..."] ADDRESS
+//  ADDRESS is what the server was given: PORT (loopback), HOST:PORT or unix:PATH
+//  --sessions how many players connect at once (default 1000)
+//  --seconds how long they keep playing once connected (default 10)
+//  --commands what each player cycles through, separated by '|'; a command can be
+//   a "cmd; cmd" sequence. avoid QUIT, it ends the session
+
+namespace
+{
+    constexpr const char *kPrompt = "\n> ";
+    constexpr const char *kDefaultCommands = "look|inventory|go north|look|go south|look in mailbox|take rock|inventory|east|west";
+
+    struct Session
+    {
+        int fd = -1;
+        size_t next = 0;       // index of the next command to send
+        unsigned matched = 0;  // how much of the prompt the input ended with so far
+        bool greeted = false;  // the first prompt came
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    uint64_t nanosSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count());
+    }
+
+    // a connected, non-blocking socket, -1 with the reason in errno if it failed
+    int connectTo(const std::string &address)
+    {
+        int fd = -1;
+        if (address.compare(0, 5, "unix:") == 0)
+        {
+            sockaddr_un remote{};
+            std::string path = address.substr(5);
+            if (path.size() >= sizeof(remote.sun_path))
+                return -1;
+            remote.sun_family = AF_UNIX;
+            std::memcpy(remote.sun_path, path.c_str(), path.size() + 1);
+            fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&remote), sizeof(remote)) != 0)
+            {
+                ::close(fd);
+                return -1;
+            }
+        }
+        else
+        {
+            size_t colon = address.rfind(':');
+            std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+            std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo *found = nullptr;
+            if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found)
+                return -1;
+            fd = ::socket(found->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool connected = fd >= 0 && ::connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+            ::freeaddrinfo(found);
+            if (!connected)
+            {
+                if (fd >= 0)
+                    ::close(fd);
+                return -1;
+            }
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        // connecting blocks, so a full accept queue just waits its turn; the rest doesn't
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t sessionCount = 1000;
+    double seconds = 10;
+    std::string commandList = kDefaultCommands;
+    std::string address;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--sessions" && i + 1 < argc)
+            sessionCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--seconds" && i + 1 < argc)
+            seconds = std::strtod(argv[++i], nullptr);
+        else if (arg == "--commands" && i + 1 < argc)
+            commandList = argv[++i];
+        else
+            address = arg;
+    }
+    if (address.empty() || sessionCount == 0)
+    {
+        std::cerr << "Usage: zorkload [--sessions N] [--seconds S] [--commands \"cmd|cmd|...\"] ADDRESS" << std::endl;
+        return 1;
+    }
+
+    // each command with its newline, ready to send
+    std::vector<std::string> commands;
+    for (size_t start = 0; start <= commandList.size();)
+    {
+        size_t end = std::min(commandList.find('|', start), commandList.size());
+        if (end > start)
+            commands.push_back(commandList.substr(start, end - start) + "\n");
+        start = end + 1;
+    }
+    if (commands.empty())
+    {
+        std::cerr << "Error: no commands to send" << std::endl;
+        return 1;
+    }
+
+    rlimit files;
+    if (::getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+    {
+        files.rlim_cur = files.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    int poller = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Session> sessions(sessionCount);
+    auto connectStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        Session &session = sessions[i];
+        session.fd = connectTo(address);
+        if (session.fd < 0)
+        {
+            std::cerr << "Error: session " << i << " could not connect to " << address << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        session.next = i % commands.size();
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        ::epoll_ctl(poller, EPOLL_CTL_ADD, session.fd, &event);
+    }
+    double connectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - connectStart).count();
+
+    LatencyHistogram latency;
+    uint64_t maxNanos = 0;
+    uint64_t answered = 0;
+    uint64_t lost = 0;
+    size_t waiting = sessions.size(); // sessions with a greeting or an answer still to come
+    size_t unready = sessions.size(); // sessions still to be greeted
+    std::chrono::steady_clock::time_point playStart;
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    std::vector<char> buffer(64 * 1024);
+    epoll_event events[256];
+
+    // the clock starts once everyone is in, so the connect storm isn't counted
+    auto play = [&]
+    {
+        playStart = std::chrono::steady_clock::now();
+        deadline = playStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        for (Session &session : sessions)
+        {
+            if (session.fd < 0)
+                continue;
+            const std::string &command = commands[session.next];
+            session.sentAt = std::chrono::steady_clock::now();
+            // a failed send shows up as a hang up on the next read
+            ::send(session.fd, command.data(), command.size(), MSG_NOSIGNAL);
+        }
+    };
+
+    // once time is up nothing more is sent, and it ends when every outstanding answer is in
+    while (waiting > 0)
+    {
+        int ready = ::epoll_wait(poller, events, 256, 1000);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready == 0 && unready == 0 && std::chrono::steady_clock::now() > deadline + std::chrono::seconds(5))
+        {
+            std::cerr << "Error: " << waiting << " sessions never answered" << std::endl;
+            break;
+        }
+        bool playing = std::chrono::steady_clock::now() < deadline;
+        for (int i = 0; i < ready; ++i)
+        {
+            Session &session = sessions[events[i].data.u64];
+            ssize_t got = ::recv(session.fd, buffer.data(), buffer.size(), 0);
+            if (got < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (got <= 0)
+            {
+                // the server hung up on a session that was still waiting
+                ::close(session.fd);
+                session.fd = -1;
+                ++lost;
+                --waiting;
+                if (!session.greeted && --unready == 0)
+                    play();
+                continue;
+            }
+
+            // an answer is complete when the input so far ends with the prompt
+            for (ssize_t at = 0; at < got; ++at)
+            {
+                char c = buffer[static_cast<size_t>(at)];
+                if (c == kPrompt[session.matched])
+                    ++session.matched;
+                else
+                    session.matched = c == kPrompt[0] ? 1 : 0;
+                if (session.matched == 3 && at + 1 < got)
+                    session.matched = 0; // a prompt lookalike inside the text
+            }
+            if (session.matched != 3)
+                continue;
+            session.matched = 0;
+
+            if (!session.greeted)
+            {
+                session.greeted = true;
+                if (--unready == 0)
+                {
+                    play();
+                    playing = true;
+                }
+                continue;
+            }
+
+            uint64_t nanos = nanosSince(session.sentAt);
+            latency.add(LatencyHistogram::bucketOf(nanos), 1);
+            maxNanos = std::max(maxNanos, nanos);
+            ++answered;
+            if (!playing)
+            {
+                --waiting;
+                continue;
+            }
+            session.next = (session.next + 1) % commands.size();
+            const std::string &command = commands[session.next];
+            session.sentAt = std::chrono::steady_clock::now();
+            ::send(session.fd, command.data(), command.size(), MSG_NOSIGNAL);
+        }
+    }
+    double playSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - playStart).count();
+    for (Session &session : sessions)
+    {
+        if (session.fd >= 0)
+            ::close(session.fd);
+    }
+    ::close(poller);
+
+    // a percentile is its bucket's upper bound, never report it above the real maximum
+    auto micros = [&](double fraction)
+    { return static_cast<double>(std::min(latency.percentile(fraction), maxNanos)) / 1000.0; };
+    std::printf("zorkload: %zu sessions connected in %.3f s, %llu commands answered in %.3f s (%.0f commands/s), "
+                "round trip us p50 %.1f p90 %.1f p99 %.1f max %.1f, %llu sessions lost\n",
+                sessions.size(), connectSeconds, static_cast<unsigned long long>(answered), playSeconds,
+                playSeconds > 0 ? answered / playSeconds : 0.0,
+                micros(0.50), micros(0.90), micros(0.99), static_cast<double>(maxNanos) / 1000.0,
+                static_cast<unsigned long long>(lost));
+    return lost == 0 ? 0 : 2;
+}